@@ -3,37 +3,113 @@ Puja Chaudhury
 CPP functions for mapping 3D points in world coordinates to corresponding 2D pixel coordinates in an image.
 */
 
+#include <cstring>
+
 #include "3D_projection.h"
+#include "buffer_pool.h"
 #include "helper_csv.h"
+#include "primitives.h"
+#include "quality_controller.h"
+#include "rasterizer.h"
+#include "resolution.h"
 
 /*
-This function extracts the calibrated camera matrix and distortion coefficients from a CSV file containing calibration data.
+This function guesses the image size an untagged calibration was made at. The principal point of a calibrated camera
+lies close to the image centre, so the size is about twice it; a common camera resolution within 5% of that is taken
+as the exact size.
  */
-int loadCalibration(std::string csv_filename, cv::Mat &camera_matrix, cv::Mat &dist_coeff)
+static cv::Size guessCalibratedSize(const cv::Mat &camera_matrix)
 {
-    char *fname_char = new char[csv_filename.length() + 1];
-    strcpy(fname_char, csv_filename.c_str());
+    static const cv::Size common[] = {cv::Size(640, 480), cv::Size(800, 600), cv::Size(1024, 768), cv::Size(1280, 720),
+                                      cv::Size(1280, 960), cv::Size(1600, 1200), cv::Size(1920, 1080), cv::Size(2560, 1440), cv::Size(3840, 2160)};
+    double width = 2 * camera_matrix.at<double>(0, 2) + 1;
+    double height = 2 * camera_matrix.at<double>(1, 2) + 1;
+    for (size_t i = 0; i < sizeof(common) / sizeof(common[0]); i++)
+    {
+        if (std::abs(width / common[i].width - 1) < 0.05 && std::abs(height / common[i].height - 1) < 0.05)
+        {
+            return (common[i]);
+        }
+    }
+    return (cv::Size(cvRound(width), cvRound(height)));
+}
 
+/*
+This function extracts the calibrated camera matrix and distortion coefficients from a CSV file containing calibration data.
+Rows are found by their camera_matrix, distortion_coeff and image_size labels; when a label repeats, the last row wins.
+The intrinsics are rescaled to imageSize from the size the file records in its image_size row. Files without one
+are taken to be calibrated at the size their principal point suggests, with a warning.
+ */
+int loadCalibration(std::string csv_filename, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Size imageSize)
+{
     std::cout << "Loading the saved calibration" << std::endl;
     std::vector<char *> featureName;
     std::vector<std::vector<float>> data;
-    read_image_data_csv(fname_char, featureName, data);
-
-    camera_matrix.at<double>(0, 0) = (double)data[0][0];
-    camera_matrix.at<double>(0, 1) = (double)data[0][1];
-    camera_matrix.at<double>(0, 2) = (double)data[0][2];
-    camera_matrix.at<double>(1, 0) = (double)data[0][3];
-    camera_matrix.at<double>(1, 1) = (double)data[0][4];
-    camera_matrix.at<double>(1, 2) = (double)data[0][5];
-    camera_matrix.at<double>(2, 0) = (double)data[0][6];
-    camera_matrix.at<double>(2, 1) = (double)data[0][7];
-    camera_matrix.at<double>(2, 2) = (double)data[0][8];
+    int status = read_image_data_csv((char *)csv_filename.c_str(), featureName, data);
+
+    int cameraRow = -1;
+    int distRow = -1;
+    int sizeRow = -1;
+    for (size_t i = 0; i < featureName.size() && i < data.size(); i++)
+    {
+        if (strcmp(featureName[i], "camera_matrix") == 0)
+        {
+            cameraRow = (int)i;
+        }
+        else if (strcmp(featureName[i], "distortion_coeff") == 0)
+        {
+            distRow = (int)i;
+        }
+        else if (strcmp(featureName[i], "image_size") == 0)
+        {
+            sizeRow = (int)i;
+        }
+    }
+
+    // read_image_data_csv leaves freeing the row labels to the caller
+    for (size_t i = 0; i < featureName.size(); i++)
+    {
+        delete[] featureName[i];
+    }
+
+    if (status != 0 || cameraRow < 0 || distRow < 0 || data[cameraRow].size() < 9 || data[distRow].size() < 5)
+    {
+        printf("Unable to load a calibration from %s\n", csv_filename.c_str());
+        return (-1);
+    }
+
+    const std::vector<float> &cam = data[cameraRow];
+    camera_matrix.at<double>(0, 0) = (double)cam[0];
+    camera_matrix.at<double>(0, 1) = (double)cam[1];
+    camera_matrix.at<double>(0, 2) = (double)cam[2];
+    camera_matrix.at<double>(1, 0) = (double)cam[3];
+    camera_matrix.at<double>(1, 1) = (double)cam[4];
+    camera_matrix.at<double>(1, 2) = (double)cam[5];
+    camera_matrix.at<double>(2, 0) = (double)cam[6];
+    camera_matrix.at<double>(2, 1) = (double)cam[7];
+    camera_matrix.at<double>(2, 2) = (double)cam[8];
 
     dist_coeff = cv::Mat(1, 5, CV_32F);
 
     for (int i = 0; i < 5; i++)
     {
-        dist_coeff.at<float>(0, i) = data[1][i];
+        dist_coeff.at<float>(0, i) = data[distRow][i];
+    }
+
+    cv::Size calibratedSize;
+    if (sizeRow >= 0 && data[sizeRow].size() >= 2)
+    {
+        calibratedSize = cv::Size(cvRound(data[sizeRow][0]), cvRound(data[sizeRow][1]));
+    }
+    if (calibratedSize.width <= 0 || calibratedSize.height <= 0)
+    {
+        calibratedSize = guessCalibratedSize(camera_matrix);
+        printf("Warning: %s has no valid image_size row; assuming it was calibrated at %dx%d\n", csv_filename.c_str(), calibratedSize.width, calibratedSize.height);
+    }
+    if (imageSize.area() > 0 && calibratedSize != imageSize)
+    {
+        printf("Rescaling the calibration from %dx%d to %dx%d\n", calibratedSize.width, calibratedSize.height, imageSize.width, imageSize.height);
+        scaleCameraMatrix(camera_matrix, calibratedSize, imageSize);
     }
 
     return (0);
@@ -50,28 +126,81 @@ int calculateCameraPosition(std::vector<cv::Vec3f> &points, std::vector<cv::Poin
     return (0);
 }
 
+/*
+This function measures how well a pose fits the detected corners: the RMS distance in pixels between each corner
+and its board point projected with the pose.
+ */
+float reprojectionError(std::vector<cv::Vec3f> &points, std::vector<cv::Point2f> &corners, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans)
+{
+    if (points.empty() || points.size() != corners.size())
+    {
+        return (-1);
+    }
+
+    std::vector<cv::Point2f> projected;
+    cv::projectPoints(points, rot, trans, camera_matrix, dist_coeff, projected);
+    double sum = 0;
+    for (size_t i = 0; i < corners.size(); i++)
+    {
+        cv::Point2f d = projected[i] - corners[i];
+        sum += d.dot(d);
+    }
+
+    return ((float)std::sqrt(sum / corners.size()));
+}
+
+/*
+These functions return what is drawn on each target. The chessboard's rows run down the board, so its y axis is drawn
+towards -y; the circle grid's rows run up, so its axis is drawn towards +y. Objects stand on the printed area of each board.
+ */
+TargetScene &chessboardScene()
+{
+    static TargetScene scene;
+    if (scene.objects.empty())
+    {
+        scene.axisY = -2;
+        scene.objects.push_back(makePrimitive(PrimitivePyramid, cv::Point3f(2, -2, 0), 1, 3, cv::Vec3b(0, 255, 255)));
+        scene.objects.push_back(makePrimitive(PrimitiveCylinder, cv::Point3f(5, -5, 2), 1, 4, cv::Vec3b(255, 0, 0)));
+        scene.objects.push_back(makePrimitive(PrimitiveSphere, cv::Point3f(5, 0, 1.5), 1.5, 0, cv::Vec3b(0, 0, 255)));
+    }
+    return (scene);
+}
+
+TargetScene &circleGridScene()
+{
+    static TargetScene scene;
+    if (scene.objects.empty())
+    {
+        scene.axisY = 2;
+        scene.objects.push_back(makePrimitive(PrimitiveCylinder, cv::Point3f(5, 5, 2), 1, 4, cv::Vec3b(255, 0, 0)));
+        scene.objects.push_back(makePrimitive(PrimitiveSphere, cv::Point3f(3, 3, 1.5), 1.5, 0, cv::Vec3b(0, 0, 255)));
+    }
+    return (scene);
+}
+
 /*
 This function takes in the following parameters: an image frame in the form of a cv::Mat,
 a calibrated camera matrix, distortion coefficients, and rotation and translation data representing the current estimated camera position.
 
 The function then calculates the 3D world coordinates of the axes and projects them to image pixel coordinates on the input image frame. Finally,
-it draws lines between these points to create the 3D axes at the origin.
+it queues arrows between these points on the frame's overlay to create the 3D axes at the origin.
  */
-int draw3dAxes(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans)
+int draw3dAxes(OverlayDrawList &overlay, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, const TargetScene &scene)
 {
     std::vector<cv::Vec3f> points;
     points.push_back(cv::Vec3f({0, 0, 0}));
     points.push_back(cv::Vec3f({2, 0, 0}));
-    points.push_back(cv::Vec3f({0, -2, 0}));
+    points.push_back(cv::Vec3f({0, scene.axisY, 0}));
     points.push_back(cv::Vec3f({0, 0, 2}));
 
     std::vector<cv::Point2f> corners;
 
     cv::projectPoints(points, rot, trans, camera_matrix, dist_coeff, corners);
 
-    cv::arrowedLine(src, corners[0], corners[1], cv::Scalar(0, 0, 255), 5);
-    cv::arrowedLine(src, corners[0], corners[2], cv::Scalar(0, 255, 0), 5);
-    cv::arrowedLine(src, corners[0], corners[3], cv::Scalar(255, 0, 0), 5);
+    int thickness = qualitySettings().lineThickness(5);
+    overlay.addArrow(corners[0], corners[1], cv::Scalar(0, 0, 255), thickness);
+    overlay.addArrow(corners[0], corners[2], cv::Scalar(0, 255, 0), thickness);
+    overlay.addArrow(corners[0], corners[3], cv::Scalar(255, 0, 0), thickness);
 
     return (0);
 }
@@ -85,95 +214,69 @@ rotation and translation data for the current estimated camera position.
 
 The function projects 3D world vertices of virtual shapes to image pixel coordinates on the image frame using the camera matrix and distortion coefficients.
 It then draws lines between these points to generate 3D virtual objects on the target.
+Objects outside the current view are skipped, and round objects are tessellated according to their size on screen.
 */
-int draw3dObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans)
+int draw3dObject(OverlayDrawList &overlay, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, const TargetScene &scene)
 {
-    std::vector<cv::Vec3f> points;
-    std::vector<cv::Point2f> corners;
-
-    // Draw a triangle
-    points.push_back(cv::Vec3f({2, -2, 3})); // center
-    points.push_back(cv::Vec3f({3, -1, 0})); // tr
-    points.push_back(cv::Vec3f({3, -3, 0})); // br
-    points.push_back(cv::Vec3f({1, -3, 0})); // bl
-    points.push_back(cv::Vec3f({1, -1, 0})); // tl
-    cv::projectPoints(points, rot, trans, camera_matrix, dist_coeff, corners);
-    cv::line(src, corners[0], corners[1], cv::Scalar(0, 255, 255), 3);
-    cv::line(src, corners[0], corners[2], cv::Scalar(0, 255, 255), 3);
-    cv::line(src, corners[0], corners[3], cv::Scalar(0, 255, 255), 3);
-    cv::line(src, corners[0], corners[4], cv::Scalar(0, 255, 255), 3);
-    cv::line(src, corners[1], corners[2], cv::Scalar(0, 255, 255), 3);
-    cv::line(src, corners[2], corners[3], cv::Scalar(0, 255, 255), 3);
-    cv::line(src, corners[3], corners[4], cv::Scalar(0, 255, 255), 3);
-    cv::line(src, corners[4], corners[1], cv::Scalar(0, 255, 255), 3);
-
-    points.clear();
-    corners.clear();
-
-    // Draw a cylinder on the chessboard
-    float height = 4;
-    float radius = 1;
-    cv::Point3f center(5, -5, height / 2);
-    int num_segments = 20;
-    for (int i = 0; i < num_segments; i++)
+    ViewFrustum frustum;
+    makeFrustum(frustum, camera_matrix, rot, trans, overlay.size());
+    for (size_t i = 0; i < scene.objects.size(); i++)
     {
-        float theta1 = ((float)i / (float)num_segments) * 2 * CV_PI;
-        float theta2 = ((float)(i + 1) / (float)num_segments) * 2 * CV_PI;
-        std::vector<cv::Vec3f> circlePoints1, circlePoints2;
-        for (int j = 0; j <= num_segments; j++)
-        {
-            float x = radius * cos((float)j / (float)num_segments * 2 * CV_PI);
-            float y = radius * sin((float)j / (float)num_segments * 2 * CV_PI);
-            circlePoints1.push_back(cv::Vec3f(x + center.x, y + center.y, center.z - height / 2));
-            circlePoints2.push_back(cv::Vec3f(x + center.x, y + center.y, center.z + height / 2));
-        }
-        std::vector<cv::Point2f> corners1, corners2;
-        cv::projectPoints(circlePoints1, rot, trans, camera_matrix, dist_coeff, corners1);
-        cv::projectPoints(circlePoints2, rot, trans, camera_matrix, dist_coeff, corners2);
-        for (size_t j = 0; j < corners1.size() - 1; ++j)
-        {
-            cv::line(src, corners1[j], corners1[j + 1], cv::Scalar(255, 0, 0), 3);
-            cv::line(src, corners2[j], corners2[j + 1], cv::Scalar(255, 0, 0), 3);
-            cv::line(src, corners1[j], corners2[j], cv::Scalar(255, 0, 0), 3);
-        }
+        drawWirePrimitive(overlay, frustum, scene.objects[i], camera_matrix, dist_coeff, rot, trans);
     }
 
-    points.clear();
-    corners.clear();
+    return (0);
+}
 
-    // Draw a sphere on the chessboard
-    float radCircle = 1.5;
-    cv::Point3f centerCircle(5, 0, radCircle);
-    for (int i = 0; i < num_segments; i++)
-    {
-        float theta1 = ((float)i / (float)num_segments) * CV_PI;
-        float theta2 = ((float)(i + 1) / (float)num_segments) * CV_PI;
-        std::vector<cv::Vec3f> circlePoints1, circlePoints2;
-        for (int j = 0; j <= num_segments; j++)
-        {
-            float phi = ((float)j / (float)num_segments) * 2 * CV_PI;
-            float x = radCircle * sin(theta1) * cos(phi) + centerCircle.x;
-            float y = radCircle * sin(theta1) * sin(phi) + centerCircle.y;
-            float z = radCircle * cos(theta1) + centerCircle.z;
-            circlePoints1.push_back(cv::Vec3f(x, y, z));
-
-            x = radCircle * sin(theta2) * cos(phi) + centerCircle.x;
-            y = radCircle * sin(theta2) * sin(phi) + centerCircle.y;
-            z = radCircle * cos(theta2) + centerCircle.z;
-            circlePoints2.push_back(cv::Vec3f(x, y, z));
-        }
-        std::vector<cv::Point2f> corners1, corners2;
-        cv::projectPoints(circlePoints1, rot, trans, camera_matrix, dist_coeff, corners1);
-        cv::projectPoints(circlePoints2, rot, trans, camera_matrix, dist_coeff, corners2);
-        for (size_t j = 0; j < corners1.size() - 1; ++j)
-        {
-            cv::line(src, corners1[j], corners1[j + 1], cv::Scalar(0, 0, 255), 3);
-            cv::line(src, corners2[j], corners2[j + 1], cv::Scalar(0, 0, 255), 3);
-            cv::line(src, corners1[j], corners2[j], cv::Scalar(0, 0, 255), 3);
-        }
-    }
-    points.clear();
-    corners.clear();
+/*
+These functions draw the axes or the virtual objects straight onto a frame, for callers that do not keep a draw list of their own.
+ */
+int draw3dAxes(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, const TargetScene &scene)
+{
+    OverlayDrawList overlay;
+    overlay.begin(src);
+    draw3dAxes(overlay, camera_matrix, dist_coeff, rot, trans, scene);
+    return (overlay.end());
+}
+
+int draw3dObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, const TargetScene &scene)
+{
+    OverlayDrawList overlay;
+    overlay.begin(src);
+    draw3dObject(overlay, camera_matrix, dist_coeff, rot, trans, scene);
+    return (overlay.end());
+}
+
+/*
+This function draws the same virtual objects as draw3dObject as solid, shaded surfaces.
+Each mesh is tessellated for its size on screen and every frame is rendered by the tiled rasterizer, which handles hidden surfaces with its depth buffer.
+ */
+int drawSolidObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, TargetScene &scene)
+{
+    static Rasterizer rasterizer;
+
+    ViewFrustum frustum;
+    makeFrustum(frustum, camera_matrix, rot, trans, src.size());
+    rasterizer.begin(src);
+    drawSolidPrimitives(rasterizer, frustum, scene.objects, camera_matrix, dist_coeff, rot, trans);
+    rasterizer.end();
+
+    return (0);
+}
+
+/*
+This function draws a loaded model as a solid object. The placement positions the model in board coordinates
+and the current pose carries it into the image, exactly like the built-in objects.
+ */
+int drawModel(cv::Mat &src, const MeshView &model, const MeshPlacement &placement, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans)
+{
+    static Rasterizer rasterizer;
+
+    rasterizer.begin(src);
+    rasterizer.addMesh(model, camera_matrix, dist_coeff, rot, trans, placement);
+    rasterizer.end();
+
+    return (0);
 }
 
 /*
@@ -191,20 +294,24 @@ int detectHarrisCorners(cv::Mat &src, cv::Mat &dst)
     int apertureSize = 3;
     double k = 0.04;
 
-    dst = src.clone();
-    cv::Mat gray, tmp, tmp_norm;
-    cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
-    tmp = cv::Mat::zeros(src.size(), CV_32FC1);
+    src.copyTo(dst);
+
+    // the grey image and both response maps are borrowed from the frame pool rather than allocated every frame
+    PooledMat gray(src.size(), CV_8UC1);
+    PooledMat tmp(src.size(), CV_32FC1);
+    PooledMat tmp_norm(src.size(), CV_32FC1);
+    cv::cvtColor(src, gray.mat, cv::COLOR_BGR2GRAY);
 
-    cornerHarris(gray, tmp, blockSize, apertureSize, k);
+    cornerHarris(gray.mat, tmp.mat, blockSize, apertureSize, k);
 
-    cv::normalize(tmp, tmp_norm, 0, 255, cv::NORM_MINMAX, CV_32FC1, cv::Mat());
+    cv::normalize(tmp.mat, tmp_norm.mat, 0, 255, cv::NORM_MINMAX, CV_32FC1, cv::Mat());
 
-    for (int j = 0; j < tmp_norm.rows; j++)
+    for (int j = 0; j < tmp_norm.mat.rows; j++)
     {
-        for (int i = 0; i < tmp_norm.cols; i++)
+        const float *row = tmp_norm.mat.ptr<float>(j);
+        for (int i = 0; i < tmp_norm.mat.cols; i++)
         {
-            if ((int)tmp_norm.at<float>(j, i) > thresh)
+            if ((int)row[i] > thresh)
             {
                 cv::circle(dst, cv::Point(i, j), 2, cv::Scalar(0, 0, 255), 2, 8, 0);
             }
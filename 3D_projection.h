@@ -13,13 +13,38 @@ Puja Chaudhury
 #include <opencv2/imgproc.hpp>
 #include <opencv2/calib3d.hpp>
 
-int loadCalibration(std::string csv_filename, cv::Mat &camera_matrix, cv::Mat &dist_coeff);
+#include "mesh.h"
+#include "overlay.h"
+#include "primitives.h"
+
+int loadCalibration(std::string csv_filename, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Size imageSize = cv::Size());
 
 int calculateCameraPosition(std::vector<cv::Vec3f> &points, std::vector<cv::Point2f> &corners, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans);
 
-int draw3dAxes(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans);
+float reprojectionError(std::vector<cv::Vec3f> &points, std::vector<cv::Point2f> &corners, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans);
+
+// What is drawn on a target: the direction its y axis is shown in and the virtual objects standing on it
+struct TargetScene
+{
+    float axisY;
+    std::vector<Primitive> objects;
+};
+
+TargetScene &chessboardScene();
+
+TargetScene &circleGridScene();
+
+int draw3dAxes(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, const TargetScene &scene = chessboardScene());
+
+int draw3dAxes(OverlayDrawList &overlay, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, const TargetScene &scene = chessboardScene());
+
+int draw3dObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, const TargetScene &scene = chessboardScene());
+
+int draw3dObject(OverlayDrawList &overlay, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, const TargetScene &scene = chessboardScene());
+
+int drawSolidObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, TargetScene &scene = chessboardScene());
 
-int draw3dObject(cv::Mat &src, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans);
+int drawModel(cv::Mat &src, const MeshView &model, const MeshPlacement &placement, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans);
 
 int detectHarrisCorners(cv::Mat &src, cv::Mat &dst);
 
@@ -4,6 +4,7 @@ Modified main function to include the new functions for the extensions.
 */
 
 #include <iostream>
+#include <string>
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
@@ -11,35 +12,39 @@ Modified main function to include the new functions for the extensions.
 #include <opencv2/imgproc/imgproc.hpp>
 
 #include "extend_helper.h"
+#include "buffer_pool.h"
+#include "circle_tracker.h"
+#include "frame_loop.h"
+#include "overlay_layer.h"
+#include "yuv_source.h"
 
 int main(int argc, char *argv[])
 {
+    // The options every program shares, such as --model, --video, --publish and --trace, are described in frame_loop.h
+    // Choose the image or video clip shown on the target canvas: --texture <file>
+    std::string textureFilename = "fuji.jpeg";
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--texture" && i + 1 < argc)
+        {
+            textureFilename = argv[++i];
+        }
+    }
 
-    cv::VideoCapture *cap;
-
-    // Initialize video capture object
-    cap = new cv::VideoCapture(0);
-    if (!cap->isOpened())
+    // Capture, display, recording, snapshots and the shared memory and pose outputs
+    FrameLoop loop;
+    if (loop.open(argc, argv) != 0)
     {
-        printf("Failed to open video device");
         return (-1);
     }
+    MeshPlacement modelPlacement;
+    if (!loop.model.empty())
+    {
+        modelPlacement = fitToBoard(loop.model.view(cv::Vec3b(200, 200, 200)), cv::Point3f(5, 3.5, 0), 4);
+    }
+    cv::Mat &videoFrame = loop.videoFrame;
 
-    // Set video capture properties
-    cap->set(cv::CAP_PROP_FRAME_WIDTH, 960);
-    cap->set(cv::CAP_PROP_FRAME_HEIGHT, 540);
-    cv::Size refS((int)cap->get(cv::CAP_PROP_FRAME_WIDTH),
-                  (int)cap->get(cv::CAP_PROP_FRAME_HEIGHT));
-    printf("Expected size: %d %d\n", refS.width, refS.height);
-
-    // Create a window to display the video
-    cv::namedWindow("Video", 1); // identifies a window
-
-    // Create a cv::Mat object to hold the current video videoFrame
-    cv::Mat videoFrame;
-
-    // Initialize variables for videoFrame numbers
-    int frameNumber = 1;
+    // Initialize the number of calibration frames
     int savedFrameNumber = 1;
 
     // Create a cv::Mat object to hold the outputFrame videoFrame
@@ -51,7 +56,7 @@ int main(int argc, char *argv[])
     std::vector<std::vector<cv::Point2f>> centers_list;
 
     // Create an array for the camera matrix
-    double camMat[] = {1, 0, (double)videoFrame.cols / 2, 0, 1, (double)videoFrame.rows / 2, 0, 0, 1};
+    double camMat[] = {1, 0, (double)loop.captureSize.width / 2, 0, 1, (double)loop.captureSize.height / 2, 0, 0, 1};
 
     // Create a cv::Mat object to hold the camera matrix
     cv::Mat cameraMat(cv::Size(3, 3), CV_64FC1, &camMat);
@@ -66,78 +71,136 @@ int main(int argc, char *argv[])
     bool showAxes = false;
     bool showObject = false;
 
+    // Draw virtual objects as shaded solids instead of wireframes
+    bool solidObjects = false;
+
     // Initialize variables for displaying the canvas
     bool canvas = false;
 
-    while (true)
+    // A video texture decodes in the background and plays against the timestamps of the captured frames
+    VideoTexture videoTexture;
+    if (isVideoFile(textureFilename) && videoTexture.open(textureFilename) != 0)
     {
-        *cap >> videoFrame; // get a new videoFrame from the camera, treat as a stream
-        if (videoFrame.empty())
-        {
-            printf("EmptyFrameError\n");
-            break;
-        }
+        return (-1);
+    }
+    double playbackStart = -1;
+
+    // Axes and wireframe objects of a frame are collected here and drawn in one pass
+    OverlayDrawList overlay;
+
+    // What the overlay drew is kept and blended onto the following frames until the pose moves
+    OverlayLayer overlayLayer;
 
+    // a YUV frame is converted to BGR once, for drawing and display; detection reads its luma instead
+    while (loop.read())
+    {
         std::vector<cv::Point2f> centers;
         std::vector<cv::Vec3f> points;
 
-        //  Detect and Extract Circle grid centers
-        bool found = extractCircleCenters(videoFrame, outputFrame, centers, cornersDrawn);
-
-        // display axes
-        if (showAxes && found)
+        //  Detect and Extract Circle grid centers, following the grid from the previous frame when possible
+        bool found;
+        if (loop.format == PIXEL_BGR)
         {
-            specifyCalibration(centers, centers_list, points, points_list); // select calibration images
-
-            // Calculate current position of the camera
-            calculateCameraPosition(points, centers, cameraMat, distCoeff, rot, trans);
-            std::cout << std::endl
-                      << "rotation matrix: " << rot << std::endl;
-            std::cout << std::endl
-                      << "translation matrix: " << trans << std::endl;
-
-            // project 3D axes
-            draw3dAxes(outputFrame, cameraMat, distCoeff, rot, trans);
+            found = trackCircleCenters(videoFrame, outputFrame, centers, cornersDrawn, loop.detectionSize);
+        }
+        else
+        {
+            cv::Mat &luma = loop.luma();
+            found = trackCircleCenters(luma, luma, centers, false, loop.detectionSize);
+            videoFrame.copyTo(outputFrame);
+            if (cornersDrawn)
+            {
+                cv::drawChessboardCorners(outputFrame, CircleGridTarget::patternSize(), centers, found);
+            }
         }
 
-        // display virtual object
-        if (showObject && found)
+        // display axes and virtual objects
+        bool posed = (showAxes || showObject) && found;
+        if (posed)
         {
-            specifyCalibration(centers, centers_list, points, points_list);
+            // only the board points are needed here; calibration views are collected when 's' is pressed
+            CircleGridTarget::objectPoints(points);
 
-            // calculate current position of the camera
+            // Calculate current position of the camera
             calculateCameraPosition(points, centers, cameraMat, distCoeff, rot, trans);
             std::cout << std::endl
                       << "rotation matrix: " << rot << std::endl;
             std::cout << std::endl
                       << "translation matrix: " << trans << std::endl;
 
-            // Create a virtual object
-            draw3dObject(outputFrame, cameraMat, distCoeff, rot, trans);
+            // the axes and objects are drawn into the cached layer only when the pose or what is shown has changed
+            int scene = (showAxes ? 1 : 0) | (showObject ? 2 : 0) | (solidObjects ? 4 : 0);
+            if (overlayLayer.needsRender(cameraMat, distCoeff, rot, trans, outputFrame.size(), scene))
+            {
+                cv::Mat &layerCanvas = overlayLayer.beginRender();
+                overlay.begin(layerCanvas);
+
+                // project 3D axes
+                if (showAxes)
+                {
+                    draw3dAxes(overlay, cameraMat, distCoeff, rot, trans, circleGridScene());
+                }
+
+                // Create a virtual object
+                if (showObject)
+                {
+                    if (!loop.model.empty())
+                    {
+                        drawModel(layerCanvas, loop.model.view(cv::Vec3b(200, 200, 200)), modelPlacement, cameraMat, distCoeff, rot, trans);
+                    }
+                    else if (solidObjects)
+                    {
+                        drawSolidObject(layerCanvas, cameraMat, distCoeff, rot, trans, circleGridScene());
+                    }
+                    else
+                    {
+                        draw3dObject(overlay, cameraMat, distCoeff, rot, trans, circleGridScene());
+                    }
+                }
+
+                overlay.end();
+                overlayLayer.endRender();
+            }
+            overlayLayer.composite(outputFrame);
         }
 
         // Transform target into image canvas
         if (canvas && found)
         {
-            specifyCalibration(centers, centers_list, points, points_list);
+            CircleGridTarget::objectPoints(points);
 
             // calculate current position of the camera
             calculateCameraPosition(points, centers, cameraMat, distCoeff, rot, trans);
+            posed = true;
             std::cout << std::endl
                       << "rotation matrix: " << rot << std::endl;
             std::cout << std::endl
                       << "translation matrix: " << trans << std::endl;
 
-            std::string imageFilename = "fuji.jpeg";
-            // draw image contents on the target
-            drawOnTarget(videoFrame, outputFrame, cameraMat, distCoeff, rot, trans, imageFilename);
+            // draw image or video contents on the target
+            if (videoTexture.isOpen())
+            {
+                if (playbackStart < 0)
+                {
+                    playbackStart = loop.frameTime;
+                }
+                drawVideoOnTarget(videoFrame, outputFrame, cameraMat, distCoeff, rot, trans, videoTexture, loop.frameTime - playbackStart);
+            }
+            else
+            {
+                drawOnTarget(videoFrame, outputFrame, cameraMat, distCoeff, rot, trans, textureFilename);
+            }
         }
 
-        // display the current videoFrame
-        cv::imshow("Video", outputFrame);
+        // the pose goes out before the frame is shown, so subscribers are not held up by the display
+        loop.publishPose(points, centers, cameraMat, distCoeff, rot, trans, POSE_TARGET_CIRCLE_GRID, posed);
+
+        // display the current videoFrame, and record and publish it
+        loop.show(outputFrame, rot, trans, posed);
 
-        // see if there is a waiting keystroke
-        char key = cv::waitKey(10);
+        // see if there is a waiting keystroke; 'v' records the output to a video file and 'k' saves a snapshot of it
+        char key = loop.waitKey();
+        loop.handleKey(key, outputFrame);
 
         // press 'q' to quit
         if (key == 'q')
@@ -148,12 +211,12 @@ int main(int argc, char *argv[])
         else if (key == 's' && found && !showAxes && !showObject && cornersDrawn)
         {
             // select calibration images
-            specifyCalibration(centers, centers_list, points, points_list);
+            specifyCalibration<CircleGridTarget>(centers, centers_list, points, points_list);
 
             printf("Saving calibration image...\n");
             std::string fname = "calibration-videoFrame-";
             fname += std::to_string(savedFrameNumber) + ".jpg";
-            imwrite(fname, outputFrame);
+            loop.writer.saveImage(fname, outputFrame);
 
             // print the corner points in world coordinates with corresponding image coordinates
             std::cout << "---------------------------------------------------------------------------" << std::endl;
@@ -176,7 +239,7 @@ int main(int argc, char *argv[])
                 std::cout << "initial camera matrix:" << std::endl;
                 std::cout << cameraMat << std::endl;
 
-                float reprojErr = computeCameraParameters(points_list, centers_list, cameraMat, distCoeff);
+                float reprojErr = computeCameraParameters(points_list, centers_list, videoFrame.size(), cameraMat, distCoeff);
 
                 // print the calibration stats for the user
                 std::cout << "calibrated camera matrix:" << std::endl;
@@ -193,7 +256,7 @@ int main(int argc, char *argv[])
             // save current calibration in a csv file
             std::cout << std::endl
                       << "Saving performed calibration..." << std::endl;
-            storeCalibrationData(cameraMat, distCoeff);
+            storeCalibrationData(cameraMat, distCoeff, videoFrame.size());
         }
         // press 'x' to display 3d axes at the origin of world coordinates
         else if (key == 'x' && found)
@@ -211,7 +274,7 @@ int main(int argc, char *argv[])
 
             // read calibration to display axes
             std::string fileName = "circlegrid_intrinsics.csv";
-            loadCalibration(fileName, cameraMat, distCoeff);
+            loadCalibration(fileName, cameraMat, distCoeff, videoFrame.size());
             std::cout << std::endl
                       << "retrieved calibrated camera matrix:" << std::endl;
             std::cout << cameraMat << std::endl;
@@ -233,7 +296,7 @@ int main(int argc, char *argv[])
 
             // read calibration to display virtual object
             std::string fileName = "circlegrid_intrinsics.csv";
-            loadCalibration(fileName, cameraMat, distCoeff);
+            loadCalibration(fileName, cameraMat, distCoeff, videoFrame.size());
             std::cout << std::endl
                       << "retrieved calibrated camera matrix:" << std::endl;
             std::cout << cameraMat << std::endl;
@@ -255,24 +318,30 @@ int main(int argc, char *argv[])
 
             // read calibration to transform target
             std::string fileName = "circlegrid_intrinsics.csv";
-            loadCalibration(fileName, cameraMat, distCoeff);
+            loadCalibration(fileName, cameraMat, distCoeff, videoFrame.size());
             std::cout << std::endl
                       << "retrieved calibrated camera matrix:" << std::endl;
             std::cout << cameraMat << std::endl;
             std::cout << "distortion coefficients: " << distCoeff << std::endl;
         }
-        // Press the 'k' key to capture a snapshot of the current video videoFrame.
-        else if (key == 'k')
+        // Press the 'f' key to switch virtual objects between wireframe and solid rendering
+        else if (key == 'f')
         {
-            printf("Saving the Images\n");
-            std::string fname = "videoFrame-";
-            fname += std::to_string(frameNumber) + ".jpg";
-            imwrite(fname, outputFrame);
-            frameNumber++;
+            solidObjects = !solidObjects;
         }
     }
 
-    delete cap;
+    if (videoTexture.isOpen())
+    {
+        printf("Video texture: %d clip frames dropped, %d repeated\n", videoTexture.droppedFrames, videoTexture.repeatedFrames);
+    }
+
+    circleGridTracker().printStats();
+
+    overlayLayer.printStats();
+
+    // stop capturing, finish writing queued snapshots and close any recording
+    loop.close();
 
     return (0);
 }
@@ -0,0 +1,213 @@
+/*
+Puja Chaudhury
+
+This is a CPP program that measures how accurately, and how quickly, the board detectors and pose estimation work.
+The 9x6 chessboard and the 4x11 circle grid are rendered from random poses under known intrinsics, with blur, noise,
+uneven lighting and lens distortion, and the detected corners and poses are compared with the exact ground truth.
+Usage: accuracy_eval [frames] [seed] [processing height]
+With a processing height, detection runs on a downscaled copy of each frame, as in the live programs.
+At full resolution the program fails when the circle grid is not found almost exactly on clean frames.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/calib3d.hpp>
+
+#include "board.h"
+#include "calibration.h"
+#include "3D_projection.h"
+#include "resolution.h"
+#include "synthetic_board.h"
+
+// mean corner error the circle grid may show on clean frames; blob centroids of a sharp render are unbiased
+static const double maxCleanRms = 0.1;
+
+typedef bool (*BoardDetector)(cv::Mat &src, cv::Mat &dst, std::vector<cv::Point2f> &corners, bool draw, cv::Size processing);
+
+// One set of imaging conditions to evaluate
+struct EvalCondition
+{
+    std::string name;
+    ImagingConditions imaging;
+    bool distorted = false;
+};
+
+// Totals over the frames of one target under one condition
+struct EvalResult
+{
+    int frames = 0;
+    int detected = 0;
+    int flipped = 0;
+    double cornerRmsSum = 0;
+    double cornerRmsMax = 0;
+    double rotationErrorSum = 0;
+    double translationErrorSum = 0;
+    double detectMs = 0;
+    double poseMs = 0;
+};
+
+static double elapsedMs(int64 start)
+{
+    return (((double)cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency());
+}
+
+/*
+This function returns the RMS distance in pixels between detected and true feature points.
+ */
+static double cornerRms(const std::vector<cv::Point2f> &detected, const std::vector<cv::Point2f> &truth)
+{
+    double sum = 0;
+    for (size_t i = 0; i < truth.size(); i++)
+    {
+        cv::Point2f d = detected[i] - truth[i];
+        sum += d.dot(d);
+    }
+    return (std::sqrt(sum / truth.size()));
+}
+
+/*
+This function renders frames of the target described by Board from random poses, runs the detector and pose estimation on them
+and adds up the errors. Detections that report the points in reverse order are counted as flipped and left out of the error totals.
+ */
+template <typename Board>
+static EvalResult evaluate(BoardDetector detect, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Size imageSize, cv::Size processing,
+                           const ImagingConditions &conditions, int frames, cv::RNG &rng)
+{
+    EvalResult result;
+    std::vector<cv::Vec3f> points;
+    Board::objectPoints(points);
+
+    cv::Mat image, unused;
+    std::vector<cv::Point2f> truth, corners;
+    for (int i = 0; i < frames; i++)
+    {
+        cv::Mat trueRot, trueTrans;
+        if (randomBoardPose(points, camera_matrix, dist_coeff, imageSize, rng, trueRot, trueTrans) != 0)
+        {
+            continue;
+        }
+        renderSyntheticBoard<Board>(camera_matrix, dist_coeff, trueRot, trueTrans, imageSize, conditions, rng, image, truth);
+        result.frames++;
+
+        int64 start = cv::getTickCount();
+        bool found = detect(image, unused, corners, false, processing);
+        result.detectMs += elapsedMs(start);
+        if (!found || corners.size() != truth.size())
+        {
+            continue;
+        }
+        result.detected++;
+
+        double rms = cornerRms(corners, truth);
+        std::vector<cv::Point2f> reversed(corners.rbegin(), corners.rend());
+        if (cornerRms(reversed, truth) < rms)
+        {
+            result.flipped++;
+            continue;
+        }
+
+        cv::Mat rot, trans;
+        start = cv::getTickCount();
+        calculateCameraPosition(points, corners, camera_matrix, dist_coeff, rot, trans);
+        result.poseMs += elapsedMs(start);
+
+        // angle of the rotation taking the estimated orientation to the true one
+        cv::Mat R, trueR, delta;
+        cv::Rodrigues(rot, R);
+        cv::Rodrigues(trueRot, trueR);
+        cv::Rodrigues(trueR * R.t(), delta);
+
+        result.cornerRmsSum += rms;
+        result.cornerRmsMax = std::max(result.cornerRmsMax, rms);
+        result.rotationErrorSum += cv::norm(delta) * 180 / CV_PI;
+        result.translationErrorSum += cv::norm(trans, trueTrans) * Board::squareSize * 1000;
+    }
+
+    return (result);
+}
+
+static void printResult(const char *target, const std::string &condition, const EvalResult &r)
+{
+    int good = r.detected - r.flipped;
+    printf("%-12s %-10s %5.1f%% %7d %9.3f %9.3f %9.3f %9.2f %9.2f %8.2f\n",
+           target,
+           condition.c_str(),
+           r.frames > 0 ? 100.0 * r.detected / r.frames : 0.0,
+           r.flipped,
+           good > 0 ? r.cornerRmsSum / good : 0.0,
+           r.cornerRmsMax,
+           good > 0 ? r.rotationErrorSum / good : 0.0,
+           good > 0 ? r.translationErrorSum / good : 0.0,
+           r.frames > 0 ? r.detectMs / r.frames : 0.0,
+           good > 0 ? r.poseMs / good : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+    int frames = argc > 1 ? std::stoi(argv[1]) : 100;
+    int seed = argc > 2 ? std::stoi(argv[2]) : 1;
+    int processingHeight = argc > 3 ? std::stoi(argv[3]) : 0;
+
+    // a VGA webcam, the resolution the live loop usually runs at
+    cv::Size imageSize(640, 480);
+    cv::Mat cameraMat = (cv::Mat_<double>(3, 3) << 600, 0, 320, 0, 600, 240, 0, 0, 1);
+    cv::Mat noDistortion = cv::Mat::zeros(1, 5, CV_64F);
+    cv::Mat barrel = (cv::Mat_<double>(1, 5) << -0.1, 0.02, 0, 0, 0);
+
+    std::vector<EvalCondition> conditions(6);
+    conditions[0].name = "clean";
+    conditions[1].name = "blur";
+    conditions[1].imaging.blurSigma = 1.5;
+    conditions[2].name = "noise";
+    conditions[2].imaging.noiseSigma = 8;
+    conditions[3].name = "lighting";
+    conditions[3].imaging.contrast = 0.5;
+    conditions[3].imaging.brightness = -30;
+    conditions[3].imaging.gradient = 80;
+    conditions[4].name = "distortion";
+    conditions[4].distorted = true;
+    conditions[5].name = "combined";
+    conditions[5].imaging.blurSigma = 1;
+    conditions[5].imaging.noiseSigma = 5;
+    conditions[5].imaging.contrast = 0.7;
+    conditions[5].imaging.gradient = 40;
+    conditions[5].distorted = true;
+
+    cv::Size processing = processingSize(imageSize, processingHeight);
+    int status = 0;
+
+    printf("%d frames per row at %dx%d, detected at %dx%d, seed %d\n", frames, imageSize.width, imageSize.height, processing.width, processing.height, seed);
+    printf("corner error in pixels, rotation error in degrees, translation error in mm; flipped detections are excluded from the errors\n\n");
+    printf("%-12s %-10s %6s %7s %9s %9s %9s %9s %9s %8s\n",
+           "target", "condition", "found", "flipped", "rms px", "max px", "rot deg", "trans mm", "detect ms", "pose ms");
+
+    for (size_t i = 0; i < conditions.size(); i++)
+    {
+        cv::Mat &distCoeff = conditions[i].distorted ? barrel : noDistortion;
+
+        // both targets see the same random sequence for a given condition
+        cv::RNG chessRng(seed + (int)i);
+        EvalResult chess = evaluate<ChessboardTarget>(GetChessboardCorners, cameraMat, distCoeff, imageSize, processing, conditions[i].imaging, frames, chessRng);
+        printResult("chessboard", conditions[i].name, chess);
+
+        cv::RNG circleRng(seed + (int)i);
+        EvalResult circles = evaluate<CircleGridTarget>(extractCircleCenters, cameraMat, distCoeff, imageSize, processing, conditions[i].imaging, frames, circleRng);
+        printResult("circle grid", conditions[i].name, circles);
+
+        // on clean frames the rendered circles sit exactly on their ground truth, so any real error points at the renderer
+        int good = circles.detected - circles.flipped;
+        if (i == 0 && processing == imageSize && good > 0 && circles.cornerRmsSum / good > maxCleanRms)
+        {
+            printf("\nFAIL: clean circle grid RMS %.3f px is above %.2f px; the synthetic target is biased\n", circles.cornerRmsSum / good, maxCleanRms);
+            status = -1;
+        }
+    }
+
+    return (status);
+}
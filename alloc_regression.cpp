@@ -0,0 +1,148 @@
+/*
+Puja Chaudhury
+
+This is a CPP program that checks the frame loop for memory growth and counts its heap allocations per stage.
+Synthetic chessboard frames are rendered up front and replayed through detection, pose estimation, drawing and
+compositing, as in the live loop. After the warm-up frames, the blocks still allocated and the resident set size must
+stay flat, and compositing must not allocate at all; the program returns nonzero when either fails, so it can run
+after every change.
+Usage: alloc_regression [frames] [warm-up frames] [max resident growth in KB]
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/calib3d.hpp>
+
+#include "alloc_tracker.h"
+#include "board.h"
+#include "calibration.h"
+#include "3D_projection.h"
+#include "overlay.h"
+#include "overlay_layer.h"
+#include "synthetic_board.h"
+
+// blocks a steady loop may still gain after warm-up, for caches OpenCV fills on first use of a code path
+static const int64_t maxLiveGrowth = 16;
+
+int main(int argc, char *argv[])
+{
+    int frames = argc > 1 ? std::stoi(argv[1]) : 500;
+    int warmup = argc > 2 ? std::stoi(argv[2]) : 50;
+    int maxResidentKB = argc > 3 ? std::stoi(argv[3]) : 1024;
+
+    cv::Size imageSize(640, 480);
+    cv::Mat cameraMat = (cv::Mat_<double>(3, 3) << 600, 0, 320, 0, 600, 240, 0, 0, 1);
+    cv::Mat distCoeff = cv::Mat::zeros(1, 5, CV_64F);
+
+    // a fixed set of views is replayed, so every frame after warm-up repeats work the loop has already done
+    std::vector<cv::Vec3f> points;
+    ChessboardTarget::objectPoints(points);
+    std::vector<cv::Mat> views;
+    cv::RNG rng(1);
+    ImagingConditions conditions;
+    conditions.noiseSigma = 3;
+    while (views.size() < 32)
+    {
+        cv::Mat rot, trans, image;
+        std::vector<cv::Point2f> truth;
+        if (randomBoardPose(points, cameraMat, distCoeff, imageSize, rng, rot, trans) != 0)
+        {
+            continue;
+        }
+        renderSyntheticBoard<ChessboardTarget>(cameraMat, distCoeff, rot, trans, imageSize, conditions, rng, image, truth);
+        views.push_back(image);
+    }
+
+    cv::Mat outputFrame(imageSize, CV_8UC3);
+    std::vector<cv::Point2f> corners;
+    cv::Mat rot, trans;
+    OverlayDrawList overlay;
+    OverlayLayer overlayLayer;
+    int detected = 0;
+
+    AllocSnapshot start, finish;
+    allocTrackingStart();
+    for (int i = 0; i < warmup + frames; i++)
+    {
+        if (i == warmup)
+        {
+            allocResetFrameStats();
+            allocSnapshot(start);
+        }
+
+        allocStage(ALLOC_DETECT);
+        cv::Mat &frame = views[i % views.size()];
+        bool found = GetChessboardCorners(frame, outputFrame, corners, false, imageSize);
+        frame.copyTo(outputFrame);
+
+        if (found)
+        {
+            detected++;
+            allocStage(ALLOC_POSE);
+            calculateCameraPosition(points, corners, cameraMat, distCoeff, rot, trans);
+
+            allocStage(ALLOC_RENDER);
+            if (overlayLayer.needsRender(cameraMat, distCoeff, rot, trans, outputFrame.size(), 3))
+            {
+                cv::Mat &canvas = overlayLayer.beginRender();
+                overlay.begin(canvas);
+                draw3dAxes(overlay, cameraMat, distCoeff, rot, trans);
+                draw3dObject(overlay, cameraMat, distCoeff, rot, trans);
+                overlay.end();
+                overlayLayer.endRender();
+            }
+
+            allocStage(ALLOC_COMPOSITE);
+            overlayLayer.composite(outputFrame);
+        }
+        allocFrameEnd();
+    }
+    allocSnapshot(finish);
+    allocTrackingStop();
+
+    const AllocFrameStats &f = allocFrameStats();
+    int64_t liveGrowth = allocLiveGrowth(start, finish);
+    double residentGrowthKB = ((double)finish.residentBytes - (double)start.residentBytes) / 1024.0;
+
+    printf("%d frames after %d warm-up frames, board found in %d\n", frames, warmup, detected);
+    printf("%-9s %12s %12s %10s\n", "stage", "allocations", "per frame", "max frame");
+    for (int s = 0; s < ALLOC_STAGES; s++)
+    {
+        printf("%-9s %12llu %12.2f %10llu\n", allocStageName(s), (unsigned long long)f.total[s],
+               f.frames > 0 ? (double)f.total[s] / f.frames : 0.0, (unsigned long long)f.maxPerFrame[s]);
+    }
+    printf("frames that allocated: %d of %d\n", f.allocatingFrames, f.frames);
+    printf("blocks still allocated: %+lld, resident set: %+.0f KB\n", (long long)liveGrowth, residentGrowthKB);
+
+    int status = 0;
+    if (detected == 0)
+    {
+        printf("FAIL: the board was never found, so nothing past detection was measured\n");
+        status = -1;
+    }
+    if (liveGrowth > maxLiveGrowth)
+    {
+        printf("FAIL: %lld blocks were allocated and never freed\n", (long long)liveGrowth);
+        status = -1;
+    }
+    if (finish.residentBytes > 0 && residentGrowthKB > maxResidentKB)
+    {
+        printf("FAIL: the resident set grew by %.0f KB, more than %d KB\n", residentGrowthKB, maxResidentKB);
+        status = -1;
+    }
+    if (f.total[ALLOC_COMPOSITE] > 0)
+    {
+        printf("FAIL: compositing allocated %llu times\n", (unsigned long long)f.total[ALLOC_COMPOSITE]);
+        status = -1;
+    }
+    if (status == 0)
+    {
+        printf("PASS\n");
+    }
+
+    return (status);
+}
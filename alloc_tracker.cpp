@@ -0,0 +1,272 @@
+/*
+Puja Chaudhury
+alloc_tracker.cpp
+Function implementations for counting heap allocations, including the replaced global operator new and delete.
+*/
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <unistd.h>
+
+#include "alloc_tracker.h"
+
+static std::atomic<bool> tracking(false);
+static std::atomic<int> frameStage(ALLOC_OTHER);
+static thread_local int threadStage = -1;
+
+static std::atomic<uint64_t> allocations[ALLOC_STAGES];
+static std::atomic<uint64_t> allocatedBytes[ALLOC_STAGES];
+static std::atomic<uint64_t> frees(0);
+
+// counters at the end of the previous frame, and what the closed frames added up to; only the frame loop touches these
+static uint64_t frameStart[ALLOC_STAGES];
+static AllocFrameStats frameStats;
+
+static const char *stageNames[ALLOC_STAGES] = {"other", "capture", "detect", "pose", "render", "composite", "output"};
+
+/*
+This function allocates for operator new and counts the allocation when tracking is on. When tracking is off it costs
+one relaxed load. The counters are plain atomics, so counting never allocates or takes a lock.
+ */
+static void *trackedAlloc(size_t size)
+{
+    void *p = malloc(size > 0 ? size : 1);
+    if (p != NULL && tracking.load(std::memory_order_relaxed))
+    {
+        int stage = threadStage >= 0 ? threadStage : frameStage.load(std::memory_order_relaxed);
+        allocations[stage].fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes[stage].fetch_add(size, std::memory_order_relaxed);
+    }
+    return (p);
+}
+
+static void trackedFree(void *p)
+{
+    if (p != NULL && tracking.load(std::memory_order_relaxed))
+    {
+        frees.fetch_add(1, std::memory_order_relaxed);
+    }
+    free(p);
+}
+
+void *operator new(size_t size)
+{
+    void *p = trackedAlloc(size);
+    if (p == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return (p);
+}
+
+void *operator new[](size_t size)
+{
+    void *p = trackedAlloc(size);
+    if (p == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return (p);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return (trackedAlloc(size));
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return (trackedAlloc(size));
+}
+
+void operator delete(void *p) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    trackedFree(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+    trackedFree(p);
+}
+
+/*
+This function clears the counters and starts counting.
+ */
+void allocTrackingStart()
+{
+    for (int s = 0; s < ALLOC_STAGES; s++)
+    {
+        allocations[s].store(0);
+        allocatedBytes[s].store(0);
+        frameStart[s] = 0;
+    }
+    frees.store(0);
+    allocResetFrameStats();
+    tracking.store(true);
+}
+
+void allocTrackingStop()
+{
+    tracking.store(false);
+}
+
+bool allocTrackingEnabled()
+{
+    return (tracking.load(std::memory_order_relaxed));
+}
+
+/*
+This function sets the stage the frame loop is in and returns the one it was in. Allocations on threads that were not
+tagged with allocThreadStage(), such as OpenCV's worker threads, count against it as well.
+ */
+int allocStage(int stage)
+{
+    return (frameStage.exchange(stage >= 0 && stage < ALLOC_STAGES ? stage : ALLOC_OTHER, std::memory_order_relaxed));
+}
+
+/*
+This function tags the calling thread, so its allocations count against the given stage whatever the frame loop does.
+ */
+void allocThreadStage(int stage)
+{
+    threadStage = stage >= 0 && stage < ALLOC_STAGES ? stage : -1;
+}
+
+const char *allocStageName(int stage)
+{
+    return (stage >= 0 && stage < ALLOC_STAGES ? stageNames[stage] : "unknown");
+}
+
+/*
+This function closes a frame: what each stage allocated since the last call is added to the frame statistics,
+and the frame loop goes back to ALLOC_OTHER.
+ */
+void allocFrameEnd()
+{
+    allocStage(ALLOC_OTHER);
+    if (!allocTrackingEnabled())
+    {
+        return;
+    }
+
+    bool allocating = false;
+    for (int s = 0; s < ALLOC_STAGES; s++)
+    {
+        uint64_t now = allocations[s].load(std::memory_order_relaxed);
+        uint64_t count = now - frameStart[s];
+        frameStart[s] = now;
+        frameStats.lastFrame[s] = count;
+        frameStats.total[s] += count;
+        if (count > frameStats.maxPerFrame[s])
+        {
+            frameStats.maxPerFrame[s] = count;
+        }
+        allocating = allocating || (s != ALLOC_OTHER && count > 0);
+    }
+    frameStats.frames++;
+    frameStats.allocatingFrames += allocating ? 1 : 0;
+}
+
+const AllocFrameStats &allocFrameStats()
+{
+    return (frameStats);
+}
+
+/*
+This function starts the frame statistics over, for example once the pipeline has warmed up.
+ */
+void allocResetFrameStats()
+{
+    memset(&frameStats, 0, sizeof(frameStats));
+    for (int s = 0; s < ALLOC_STAGES; s++)
+    {
+        frameStart[s] = allocations[s].load(std::memory_order_relaxed);
+    }
+}
+
+void allocSnapshot(AllocSnapshot &snapshot)
+{
+    for (int s = 0; s < ALLOC_STAGES; s++)
+    {
+        snapshot.allocations[s] = allocations[s].load(std::memory_order_relaxed);
+        snapshot.bytes[s] = allocatedBytes[s].load(std::memory_order_relaxed);
+    }
+    snapshot.frees = frees.load(std::memory_order_relaxed);
+    snapshot.residentBytes = residentBytes();
+}
+
+/*
+This function returns how many more blocks were outstanding at the second snapshot than at the first.
+A pipeline in steady state frees everything it allocates within a frame, so this stays near zero.
+ */
+int64_t allocLiveGrowth(const AllocSnapshot &from, const AllocSnapshot &to)
+{
+    int64_t allocated = 0;
+    for (int s = 0; s < ALLOC_STAGES; s++)
+    {
+        allocated += (int64_t)(to.allocations[s] - from.allocations[s]);
+    }
+    return (allocated - (int64_t)(to.frees - from.frees));
+}
+
+/*
+This function returns the resident set size of the process, from /proc/self/statm, or 0 where that is not available.
+ */
+size_t residentBytes()
+{
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if (fp == NULL)
+    {
+        return (0);
+    }
+    unsigned long size = 0, resident = 0;
+    int read = fscanf(fp, "%lu %lu", &size, &resident);
+    fclose(fp);
+    return (read == 2 ? (size_t)resident * (size_t)sysconf(_SC_PAGESIZE) : 0);
+}
+
+void allocPrintStats()
+{
+    if (!allocTrackingEnabled())
+    {
+        return;
+    }
+
+    const AllocFrameStats &f = allocFrameStats();
+    printf("Allocations: %d of %d frames allocated, resident set %.1f MB\n", f.allocatingFrames, f.frames, residentBytes() / 1048576.0);
+    for (int s = 0; s < ALLOC_STAGES; s++)
+    {
+        uint64_t count = allocations[s].load(std::memory_order_relaxed);
+        if (count == 0)
+        {
+            continue;
+        }
+        printf("  %-9s %10llu allocations, %10.1f MB, %.2f per frame, at most %llu in one frame\n", stageNames[s],
+               (unsigned long long)count, allocatedBytes[s].load(std::memory_order_relaxed) / 1048576.0,
+               f.frames > 0 ? (double)f.total[s] / f.frames : 0.0, (unsigned long long)f.maxPerFrame[s]);
+    }
+}
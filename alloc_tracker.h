@@ -0,0 +1,66 @@
+/*
+Puja Chaudhury
+alloc_tracker.h
+Counting heap allocations by pipeline stage and by frame. The global operator new and delete are replaced; while
+tracking is on, every allocation is counted against the stage the frame loop is in, or against the stage a background
+thread was tagged with. cv::Mat buffers come from OpenCV's own allocator, but each one also allocates its header with
+operator new, so every new buffer is still counted once. The resident set size is read alongside, for growth that
+the counts cannot see.
+*/
+
+#ifndef alloc_tracker_hpp
+#define alloc_tracker_hpp
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum AllocStage
+{
+    ALLOC_OTHER,     // outside the stages below, such as key handling and startup
+    ALLOC_CAPTURE,   // reading and decoding frames
+    ALLOC_DETECT,    // format conversion and target detection
+    ALLOC_POSE,      // pose estimation
+    ALLOC_RENDER,    // drawing axes and objects
+    ALLOC_COMPOSITE, // blending the drawn layer onto the frame
+    ALLOC_OUTPUT,    // display, encoding and publishing
+    ALLOC_STAGES
+};
+
+// Counters since tracking started
+struct AllocSnapshot
+{
+    uint64_t allocations[ALLOC_STAGES];
+    uint64_t bytes[ALLOC_STAGES];
+    uint64_t frees;
+    size_t residentBytes;
+};
+
+// Allocations per stage in the frames closed with allocFrameEnd()
+struct AllocFrameStats
+{
+    int frames;
+    int allocatingFrames; // frames with any allocation in a stage other than ALLOC_OTHER
+    uint64_t total[ALLOC_STAGES];
+    uint64_t maxPerFrame[ALLOC_STAGES];
+    uint64_t lastFrame[ALLOC_STAGES];
+};
+
+void allocTrackingStart();
+void allocTrackingStop();
+bool allocTrackingEnabled();
+
+int allocStage(int stage);
+void allocThreadStage(int stage);
+const char *allocStageName(int stage);
+
+void allocFrameEnd();
+const AllocFrameStats &allocFrameStats();
+void allocResetFrameStats();
+
+void allocSnapshot(AllocSnapshot &snapshot);
+int64_t allocLiveGrowth(const AllocSnapshot &from, const AllocSnapshot &to);
+size_t residentBytes();
+
+void allocPrintStats();
+
+#endif
@@ -0,0 +1,150 @@
+/*
+Puja Chaudhury
+board.h
+Compile-time descriptors for the calibration targets.
+Each descriptor knows its pattern size, the physical size of one board unit and the board coordinates of every feature point,
+so detection, drawing and calibration all agree on the same geometry. Switching targets is a change of template argument.
+*/
+
+#ifndef board_hpp
+#define board_hpp
+
+#include <array>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/calib3d.hpp>
+
+#include "buffer_pool.h"
+#include "quality_controller.h"
+
+enum class BoardPattern
+{
+    Chessboard,
+    SymmetricCircles,
+    AsymmetricCircles
+};
+
+// A single feature point in board units, laid out like cv::Vec3f so a table can be read as cv::Vec3f points
+struct BoardPoint
+{
+    float x, y, z;
+};
+
+/*
+This function returns the board coordinates of the k-th feature point in the order the OpenCV detectors report them.
+Chessboard corners and symmetric circles run row by row with x along the row and y decreasing down the board.
+Asymmetric circles run column by column across the 11 rows, with every other row offset by one unit.
+ */
+constexpr BoardPoint boardPointAt(BoardPattern pattern, int cols, int rows, int k)
+{
+    int r = k / cols;
+    int c = k % cols;
+    if (pattern == BoardPattern::AsymmetricCircles)
+    {
+        return BoardPoint{(float)(rows - 1 - r), (float)(2 * (cols - 1 - c) + (r % 2 == 0 ? 1 : 0)), 0.0f};
+    }
+    return BoardPoint{(float)c, (float)-r, 0.0f};
+}
+
+template <BoardPattern Pattern, int Cols, int Rows>
+constexpr std::array<BoardPoint, Cols * Rows> makeBoardPoints()
+{
+    std::array<BoardPoint, Cols * Rows> table{};
+    for (int k = 0; k < Cols * Rows; k++)
+    {
+        table[k] = boardPointAt(Pattern, Cols, Rows, k);
+    }
+    return table;
+}
+
+/*
+A calibration target described entirely at compile time.
+Cols and Rows are the pattern size as passed to the OpenCV detectors and SquareMicrons is the printed edge length of one board unit.
+ */
+template <BoardPattern Pattern, int Cols, int Rows, int SquareMicrons>
+struct BoardTarget
+{
+    static constexpr BoardPattern pattern = Pattern;
+    static constexpr int cols = Cols;
+    static constexpr int rows = Rows;
+    static constexpr int count = Cols * Rows;
+
+    // length of one board unit in metres, used to turn a pose translation into real units
+    static constexpr double squareSize = SquareMicrons * 1e-6;
+
+    // board coordinates of every feature point, generated by the compiler
+    static constexpr std::array<BoardPoint, Cols * Rows> points = makeBoardPoints<Pattern, Cols, Rows>();
+
+    static cv::Size patternSize()
+    {
+        return cv::Size(Cols, Rows);
+    }
+
+    static void objectPoints(std::vector<cv::Vec3f> &dst)
+    {
+        const cv::Vec3f *first = reinterpret_cast<const cv::Vec3f *>(points.data());
+        dst.assign(first, first + count);
+    }
+
+    /*
+    This function refines chessboard corners to sub-pixel accuracy in the given BGR or grayscale image, which may be larger than the one they were found in.
+    Circle centres are blob centroids already and are left as they are. The search window and iterations follow the quality settings.
+     */
+    static void refine(cv::Mat &src, std::vector<cv::Point2f> &corners)
+    {
+        if constexpr (Pattern == BoardPattern::Chessboard)
+        {
+            const QualitySettings &quality = qualitySettings();
+            cv::TermCriteria criteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, quality.subPixIterations, 0.1);
+            cv::Size window(quality.subPixWindow, quality.subPixWindow);
+            if (src.channels() == 3)
+            {
+                PooledMat gray(src.size(), CV_8UC1);
+                cv::cvtColor(src, gray.mat, cv::COLOR_BGR2GRAY);
+                cv::cornerSubPix(gray.mat, corners, window, cv::Size(-1, -1), criteria);
+            }
+            else
+            {
+                cv::cornerSubPix(src, corners, window, cv::Size(-1, -1), criteria);
+            }
+        }
+    }
+
+    /*
+    This function runs the detector matching the pattern on the BGR or grayscale image and fills corners with the feature points in table order.
+    Chessboard corners are refined to sub-pixel accuracy; the circle grids already return blob centres.
+     */
+    static bool find(cv::Mat &src, std::vector<cv::Point2f> &corners)
+    {
+        if constexpr (Pattern == BoardPattern::Chessboard)
+        {
+            bool found = cv::findChessboardCorners(src, patternSize(), corners);
+            if (found)
+            {
+                refine(src, corners);
+            }
+            return (found);
+        }
+        else if constexpr (Pattern == BoardPattern::SymmetricCircles)
+        {
+            return (cv::findCirclesGrid(src, patternSize(), corners, cv::CALIB_CB_SYMMETRIC_GRID));
+        }
+        else
+        {
+            return (cv::findCirclesGrid(src, patternSize(), corners, cv::CALIB_CB_ASYMMETRIC_GRID + cv::CALIB_CB_CLUSTERING));
+        }
+    }
+};
+
+// 9x6 inner-corner chessboard used by main.cpp
+typedef BoardTarget<BoardPattern::Chessboard, 9, 6, 25000> ChessboardTarget;
+
+// 4x11 asymmetric circle grid used by the extensions
+typedef BoardTarget<BoardPattern::AsymmetricCircles, 4, 11, 20000> CircleGridTarget;
+
+static_assert(CircleGridTarget::points[0].x == 10 && CircleGridTarget::points[0].y == 7, "circle grid table out of order");
+static_assert(ChessboardTarget::points[10].x == 1 && ChessboardTarget::points[10].y == -1, "chessboard table out of order");
+
+#endif
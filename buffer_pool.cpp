@@ -0,0 +1,119 @@
+/*
+Puja Chaudhury
+buffer_pool.cpp
+Function implementations for the frame buffer pool.
+*/
+
+#include <cstdio>
+
+#include "buffer_pool.h"
+
+BufferPool::BufferPool(int maxPerKey)
+    : acquired(0),
+      allocated(0),
+      discarded(0),
+      maxPerKey(maxPerKey > 0 ? maxPerKey : 1)
+{
+}
+
+/*
+This function hands out a buffer of the given size and type, reusing a returned one when there is one.
+The contents are whatever the previous user left, so callers overwrite the whole buffer.
+ */
+cv::Mat BufferPool::acquire(cv::Size size, int type)
+{
+    acquired++;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::vector<cv::Mat> &free = buffers[std::make_tuple(size.height, size.width, type)];
+        if (!free.empty())
+        {
+            cv::Mat buffer = free.back();
+            free.pop_back();
+            return (buffer);
+        }
+    }
+
+    allocated++;
+    return (cv::Mat(size, type));
+}
+
+/*
+This function takes a buffer back and empties the caller's header. A buffer is only kept for reuse when it is a whole
+allocation that no other cv::Mat still refers to; a frame that was handed on elsewhere is simply released.
+ */
+void BufferPool::release(cv::Mat &buffer)
+{
+    if (buffer.empty())
+    {
+        return;
+    }
+    if (buffer.u == NULL || buffer.u->refcount != 1 || buffer.isSubmatrix() || !buffer.isContinuous())
+    {
+        discarded++;
+        buffer.release();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::vector<cv::Mat> &free = buffers[std::make_tuple(buffer.rows, buffer.cols, buffer.type())];
+        if ((int)free.size() < maxPerKey)
+        {
+            free.push_back(buffer);
+        }
+        else
+        {
+            discarded++;
+        }
+    }
+    buffer.release();
+}
+
+/*
+This function frees every buffer the pool holds, for example after the capture resolution changed.
+ */
+void BufferPool::clear()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    buffers.clear();
+}
+
+void BufferPool::printStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    size_t held = 0;
+    double megabytes = 0;
+    for (std::map<std::tuple<int, int, int>, std::vector<cv::Mat>>::iterator it = buffers.begin(); it != buffers.end(); ++it)
+    {
+        for (size_t i = 0; i < it->second.size(); i++)
+        {
+            held++;
+            megabytes += it->second[i].total() * it->second[i].elemSize() / (1024.0 * 1024.0);
+        }
+    }
+    int a = acquired;
+    int n = allocated;
+    printf("Buffer pool: %d buffers handed out, %d allocated (%.1f%% reused), %d discarded, %d held (%.1f MB)\n",
+           a, n, a > 0 ? 100.0 * (a - n) / a : 0.0, (int)discarded, (int)held, megabytes);
+}
+
+/*
+This function returns the pool shared by the frame loop's stages.
+ */
+BufferPool &framePool()
+{
+    static BufferPool pool;
+    return (pool);
+}
+
+PooledMat::PooledMat(cv::Size size, int type, BufferPool &pool)
+    : mat(pool.acquire(size, type)),
+      pool(pool)
+{
+}
+
+PooledMat::~PooledMat()
+{
+    pool.release(mat);
+}
@@ -0,0 +1,64 @@
+/*
+Puja Chaudhury
+buffer_pool.h
+A pool of frame-sized image buffers keyed by size and type. Per-frame stages borrow a buffer instead of allocating
+a new cv::Mat and hand it back when they are done, so steady-state processing keeps reusing the same pages.
+*/
+
+#ifndef buffer_pool_hpp
+#define buffer_pool_hpp
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+class BufferPool
+{
+public:
+    BufferPool(int maxPerKey = 4);
+
+    cv::Mat acquire(cv::Size size, int type);
+    void release(cv::Mat &buffer);
+    void clear();
+    void printStats();
+
+    // buffers handed out, and how many of them were new allocations
+    std::atomic<int> acquired;
+    std::atomic<int> allocated;
+
+    // buffers returned but not kept, because another header still referred to them or their key was full
+    std::atomic<int> discarded;
+
+private:
+    BufferPool(const BufferPool &);
+    BufferPool &operator=(const BufferPool &);
+
+    // free buffers for each (rows, cols, type) of frame
+    std::map<std::tuple<int, int, int>, std::vector<cv::Mat>> buffers;
+    std::mutex lock;
+    int maxPerKey;
+};
+
+BufferPool &framePool();
+
+// A buffer borrowed from a pool for as long as the object lives
+class PooledMat
+{
+public:
+    PooledMat(cv::Size size, int type, BufferPool &pool = framePool());
+    ~PooledMat();
+
+    cv::Mat mat;
+
+private:
+    PooledMat(const PooledMat &);
+    PooledMat &operator=(const PooledMat &);
+
+    BufferPool &pool;
+};
+
+#endif
@@ -0,0 +1,81 @@
+/*
+Puja Chaudhury
+
+This is a CPP program that builds the target index the trackers recognise a catalogue of pictures with.
+Every image in the directory becomes one target; its ORB features are computed as they are for --image-target.
+Usage: build_target_index <image directory> <index file> [width in board units] [tables] [key bits, 0 for automatic]
+*/
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+#include "image_target.h"
+#include "target_index.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printf("Usage: build_target_index <image directory> <index file> [width in board units] [tables] [key bits, 0 for automatic]\n");
+        return (-1);
+    }
+    std::string directory = argv[1];
+    std::string indexName = argv[2];
+    float width = argc > 3 ? std::stof(argv[3]) : 8;
+    int numTables = argc > 4 ? std::stoi(argv[4]) : 8;
+    int keyBits = argc > 5 ? std::stoi(argv[5]) : 0;
+
+    // the images are indexed in name order, so the same directory always gives the same index
+    std::vector<std::string> files;
+    std::error_code error;
+    for (const auto &file : std::filesystem::directory_iterator(directory, error))
+    {
+        std::string extension = file.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (file.is_regular_file() && (extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".bmp"))
+        {
+            files.push_back(file.path().string());
+        }
+    }
+    if (error)
+    {
+        printf("Unable to read the directory %s\n", directory.c_str());
+        return (-1);
+    }
+    std::sort(files.begin(), files.end());
+
+    double start = (double)cv::getTickCount();
+    std::vector<ImageTarget> targets;
+    size_t features = 0;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        ImageTarget target;
+        if (loadImageTarget(files[i], target, width) != 0)
+        {
+            printf("Skipping %s\n", files[i].c_str());
+            continue;
+        }
+        features += target.keypoints.size();
+        targets.push_back(target);
+    }
+    if (targets.empty())
+    {
+        printf("No usable images in %s\n", directory.c_str());
+        return (-1);
+    }
+
+    if (buildTargetIndex(targets, indexName, numTables, keyBits) != 0)
+    {
+        return (-1);
+    }
+    double seconds = ((double)cv::getTickCount() - start) / cv::getTickFrequency();
+
+    printf("Indexed %d targets with %d features in %s (%d tables), %.1f s\n",
+           (int)targets.size(), (int)features, indexName.c_str(), numTables, seconds);
+
+    return (0);
+}
@@ -5,6 +5,7 @@ Function implementations for various steps used during the calibration of camera
 */
 
 #include "calibration.h"
+#include "circle_tracker.h"
 #include "helper_csv.h"
 
 /*
@@ -14,59 +15,46 @@ another cv::Mat object for the output,
 and a vector of points.
 The function first identifies the corners present in the checkerboard grid in the input image, then draws them on the output image.
 Additionally, the function populates the input vector with the pixel coordinates of the detected corners in the image.
+If a processing size is given, the corners are found in a copy of that size and returned in input image pixels.
  */
-bool GetChessboardCorners(cv::Mat &inputImage, cv::Mat &outputImage, std::vector<cv::Point2f> &corners, bool shouldDrawCorners)
+bool GetChessboardCorners(cv::Mat &inputImage, cv::Mat &outputImage, std::vector<cv::Point2f> &corners, bool shouldDrawCorners, cv::Size processing)
 {
-    outputImage = inputImage.clone();
-    bool found = cv::findChessboardCorners(inputImage, cv::Size(9, 6), corners);
-    cv::Mat gray;
-    cv::cvtColor(inputImage, gray, cv::COLOR_BGR2GRAY);
-    if (found == true)
-    {
-        cv::cornerSubPix(gray, corners, cv::Size(5, 5), cv::Size(-1, -1), cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.1));
-    }
-    if (shouldDrawCorners)
-    {
-        cv::drawChessboardCorners(outputImage, cv::Size(6, 9), corners, found);
-    }
-    return (found);
+    return (detectBoard<ChessboardTarget>(inputImage, outputImage, corners, shouldDrawCorners, processing));
 }
 
 /*
-This function takes a vector of points that represent the pixel coordinates of detected corners in an image.
-It then calculates the corresponding world coordinates for these points on a checkerboard target,
-and populates a vector of points with these world coordinates.
-Additionally, the function populates vectors for storing multiple sets of pixel and world coordinates,
-which can be used for calibration purposes.
+The function takes in an image frame as a cv::Mat,
+an output frame as another cv::Mat, and a vector of points.
+It detects the centers of the circles present in the circle grid using a specific method and draws them on the output frame.
+Additionally, this function fills the given vector with the pixel coordinates of the detected circle centers in the image.
+If a processing size is given, the centers are found in a copy of that size and returned in input image pixels.
  */
-int specifyCalibration(std::vector<cv::Point2f> &corners, std::vector<std::vector<cv::Point2f>> &corners_list, std::vector<cv::Vec3f> &points, std::vector<std::vector<cv::Vec3f>> &points_list)
+bool extractCircleCenters(cv::Mat &src, cv::Mat &dst, std::vector<cv::Point2f> &centers, bool drawCenters, cv::Size processing)
+{
+    return (detectBoard<CircleGridTarget>(src, dst, centers, drawCenters, processing));
+}
 
+/*
+This function does the same as extractCircleCenters for consecutive frames of one video stream. Once the grid has been found,
+the circles are followed from frame to frame in small windows, and the full search only runs again when tracking fails.
+ */
+bool trackCircleCenters(cv::Mat &src, cv::Mat &dst, std::vector<cv::Point2f> &centers, bool drawCenters, cv::Size processing)
 {
-    int cols = 9;
-    for (int k = 0; k < corners.size(); k++)
-    {
-        float i = (float)(k % cols);
-        float j = (float)(-1 * k / cols);
-        cv::Vec3f point(i, j, 0);
-        points.push_back(point);
-    }
-    corners_list.push_back(corners);
-    points_list.push_back(points);
-    return (0);
+    return (detectBoard<CircleGridTarget>(src, dst, centers, drawCenters, processing, &findCircleGridTracked));
 }
 
 /*
 This function takes as input a vector of point sets and a vector of corner sets,
-as well as an initial camera matrix.
+as well as an initial camera matrix and the size of the frames the corners were detected in.
 Using this data, the function generates a calibration and computes the calibrated camera matrix and distortion coefficients.
  */
-float computeCameraParameters(std::vector<std::vector<cv::Vec3f>> &points_list, std::vector<std::vector<cv::Point2f>> &corners_list, cv::Mat &camera_matrix, cv::Mat &dist_coeff)
+float computeCameraParameters(std::vector<std::vector<cv::Vec3f>> &points_list, std::vector<std::vector<cv::Point2f>> &corners_list, cv::Size imageSize, cv::Mat &camera_matrix, cv::Mat &dist_coeff)
 {
     std::vector<cv::Mat> rot, trans;
 
     float error = cv::calibrateCamera(points_list,
                                       corners_list,
-                                      cv::Size(1280, 720),
+                                      imageSize,
                                       camera_matrix,
                                       dist_coeff,
                                       rot,
@@ -80,17 +68,13 @@ float computeCameraParameters(std::vector<std::vector<cv::Vec3f>> &points_list,
 /*
 This function saves the current calibration data,
  including the camera matrix and distance coefficients,
- to a CSV file. This file can be later retrieved to calculate the camera pose.
+ to the given CSV file, replacing what the file held before. This file can be later retrieved to calculate the camera pose.
+ The image size the calibration was made at is saved with it so it can be rescaled to other resolutions.
  */
-int storeCalibrationData(cv::Mat &camera_matrix, cv::Mat &dist_coeff)
+int storeCalibrationData(cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Size imageSize, std::string csv_filename)
 {
-    std::string fileName = "intrinsics.csv";
-    char *fileName_char = new char[fileName.length() + 1];
-    strcpy(fileName_char, fileName.c_str());
-
+    std::string fileName = csv_filename;
     std::string columnName = "camera_matrix";
-    char *labelName_char = new char[columnName.length() + 1];
-    strcpy(labelName_char, columnName.c_str());
 
     std::vector<float> camVector;
     for (int i = 0; i < camera_matrix.rows; i++)
@@ -101,11 +85,9 @@ int storeCalibrationData(cv::Mat &camera_matrix, cv::Mat &dist_coeff)
             camVector.push_back(f_val);
         }
     }
-    append_image_data_csv(fileName_char, labelName_char, camVector);
+    append_image_data_csv((char *)fileName.c_str(), (char *)columnName.c_str(), camVector, 1);
 
     columnName = "distortion_coeff";
-    char *label_char = new char[columnName.length() + 1];
-    strcpy(label_char, columnName.c_str());
 
     std::vector<float> distVector;
     for (int i = 0; i < dist_coeff.rows; i++)
@@ -116,7 +98,13 @@ int storeCalibrationData(cv::Mat &camera_matrix, cv::Mat &dist_coeff)
             distVector.push_back(f_val);
         }
     }
-    append_image_data_csv(fileName_char, label_char, distVector);
+    append_image_data_csv((char *)fileName.c_str(), (char *)columnName.c_str(), distVector);
+
+    std::vector<float> sizeVector;
+    sizeVector.push_back((float)imageSize.width);
+    sizeVector.push_back((float)imageSize.height);
+    std::string sizeLabel = "image_size";
+    append_image_data_csv((char *)fileName.c_str(), (char *)sizeLabel.c_str(), sizeVector);
 
     return (0);
 }
@@ -14,9 +14,64 @@ The calibration process for the camera and AR system is split into several funct
 #include <opencv2/imgproc.hpp>
 #include <opencv2/calib3d.hpp>
 
-bool GetChessboardCorners(cv::Mat &src, cv::Mat &dst, std::vector<cv::Point2f> &corners, bool drawCorners);
-int specifyCalibration(std::vector<cv::Point2f> &corners, std::vector<std::vector<cv::Point2f>> &corners_list, std::vector<cv::Vec3f> &points, std::vector<std::vector<cv::Vec3f>> &points_list);
-float computeCameraParameters(std::vector<std::vector<cv::Vec3f>> &points_list, std::vector<std::vector<cv::Point2f>> &corners_list, cv::Mat &camera_matrix, cv::Mat &dist_coeff);
-int storeCalibrationData(cv::Mat &camera_matrix, cv::Mat &dist_coeff);
+#include "board.h"
+#include "resolution.h"
+
+bool GetChessboardCorners(cv::Mat &src, cv::Mat &dst, std::vector<cv::Point2f> &corners, bool drawCorners, cv::Size processing = cv::Size());
+bool extractCircleCenters(cv::Mat &src, cv::Mat &dst, std::vector<cv::Point2f> &centers, bool drawCenters, cv::Size processing = cv::Size());
+bool trackCircleCenters(cv::Mat &src, cv::Mat &dst, std::vector<cv::Point2f> &centers, bool drawCenters, cv::Size processing = cv::Size());
+float computeCameraParameters(std::vector<std::vector<cv::Vec3f>> &points_list, std::vector<std::vector<cv::Point2f>> &corners_list, cv::Size imageSize, cv::Mat &camera_matrix, cv::Mat &dist_coeff);
+int storeCalibrationData(cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Size imageSize, std::string csv_filename = "intrinsics.csv");
+
+/*
+This function copies the input frame to the output, reusing the output's buffer (nothing is copied when both are the same cv::Mat), detects the target described by Board and optionally draws the detected points.
+The pattern size used for detection and drawing both come from the same descriptor.
+With a processing size smaller than the frame, detection runs on a downscaled copy and the points are mapped back to
+frame pixels; chessboard corners are then refined again at full resolution so the smaller image costs no accuracy.
+find replaces the descriptor's detector, for example with a tracking one.
+ */
+template <typename Board>
+bool detectBoard(cv::Mat &src, cv::Mat &dst, std::vector<cv::Point2f> &corners, bool drawCorners, cv::Size processing = cv::Size(),
+                 bool (*find)(cv::Mat &, std::vector<cv::Point2f> &) = &Board::find)
+{
+    if (&dst != &src)
+    {
+        src.copyTo(dst);
+    }
+    bool found;
+    if (processing.area() == 0 || processing == src.size())
+    {
+        found = find(src, corners);
+    }
+    else
+    {
+        PooledMat small(processing, src.type());
+        resizeForProcessing(src, processing, small.mat);
+        found = find(small.mat, corners);
+        scalePoints(corners, processing, src.size());
+        if (found)
+        {
+            Board::refine(src, corners);
+        }
+    }
+    if (drawCorners)
+    {
+        cv::drawChessboardCorners(dst, Board::patternSize(), corners, found);
+    }
+    return (found);
+}
+
+/*
+This function fills points with the world coordinates of the detected feature points, taken from the board's compile-time table,
+and appends the current pixel and world coordinate sets to the lists used for calibration.
+ */
+template <typename Board>
+int specifyCalibration(std::vector<cv::Point2f> &corners, std::vector<std::vector<cv::Point2f>> &corners_list, std::vector<cv::Vec3f> &points, std::vector<std::vector<cv::Vec3f>> &points_list)
+{
+    Board::objectPoints(points);
+    corners_list.push_back(corners);
+    points_list.push_back(points);
+    return (0);
+}
 
 #endif
@@ -0,0 +1,166 @@
+/*
+Puja Chaudhury
+capture.cpp
+Function implementations for the latest-frame capture thread.
+*/
+
+#include <chrono>
+
+#include "capture.h"
+#include "alloc_tracker.h"
+#include "trace.h"
+
+CaptureThread::CaptureThread()
+    : fps(0),
+      capturedFrames(0),
+      droppedFrames(0),
+      capture(NULL),
+      realTime(false),
+      latestTime(0),
+      latestSequence(0),
+      unread(false),
+      ended(false),
+      running(false)
+{
+}
+
+CaptureThread::~CaptureThread()
+{
+    stop();
+}
+
+/*
+This function starts capturing from an opened source. From then on only the capture thread may use it.
+With realTime set, frames are paced at the source's frame rate, which makes a video file behave like a live camera.
+ */
+int CaptureThread::start(cv::VideoCapture *capture, bool realTime)
+{
+    stop();
+    if (capture == NULL || !capture->isOpened())
+    {
+        return (-1);
+    }
+
+    this->capture = capture;
+    this->realTime = realTime;
+    fps = capture->get(cv::CAP_PROP_FPS);
+    capturedFrames = 0;
+    droppedFrames = 0;
+    latestSequence = 0;
+    unread = false;
+    ended = false;
+
+    running = true;
+    thread = std::thread(&CaptureThread::run, this);
+
+    return (0);
+}
+
+/*
+This function stops the capture thread. The source can be used directly again afterwards.
+ */
+void CaptureThread::stop()
+{
+    running = false;
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+    frameReady.notify_all();
+}
+
+/*
+This function waits for a frame that has not been read yet and copies it out with its capture time in seconds
+on the captureClock. Frames that arrived while the caller was busy have already been replaced by newer ones.
+It returns false once the source has ended and its last frame was read.
+ */
+bool CaptureThread::read(cv::Mat &frame, double &timestamp)
+{
+    int64_t sequence;
+    return (read(frame, timestamp, sequence));
+}
+
+/*
+Like read above, but it also gives the frame's capture sequence number, counted from 1 by the capture thread. It is the
+frame id the capture thread traced the frame under, so the frame loop can trace its work on the frame under the same id;
+gaps in the sequence are the frames dropped in between.
+ */
+bool CaptureThread::read(cv::Mat &frame, double &timestamp, int64_t &sequence)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    frameReady.wait(guard, [this]
+                    { return unread || ended || !running; });
+    if (!unread)
+    {
+        return (false);
+    }
+
+    latest.copyTo(frame);
+    timestamp = latestTime;
+    sequence = latestSequence;
+    unread = false;
+
+    return (true);
+}
+
+/*
+This function runs on the capture thread. Each frame is decoded into a back buffer that is then swapped
+with the published one, so the reader never sees a half-written image and no buffer is reallocated.
+ */
+void CaptureThread::run()
+{
+    allocThreadStage(ALLOC_CAPTURE);
+    traceThreadName("capture");
+    cv::Mat back;
+    double interval = fps > 0 ? 1.0 / fps : 1.0 / 30;
+    double start = captureClock();
+    int64_t frameIndex = 0;
+
+    while (running)
+    {
+        if (realTime)
+        {
+            double due = start + frameIndex * interval;
+            double wait = due - captureClock();
+            if (wait > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+            }
+        }
+
+        // frames are numbered here, and read() hands the number on with the frame, so the frame loop traces under the same id
+        traceBegin("capture", frameIndex + 1);
+        bool grabbed = capture->grab() && capture->retrieve(back) && !back.empty();
+        traceEnd("capture", frameIndex + 1);
+        if (!grabbed)
+        {
+            break;
+        }
+        double timestamp = captureClock();
+        frameIndex++;
+        capturedFrames++;
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (unread)
+        {
+            droppedFrames++;
+        }
+        cv::swap(latest, back);
+        latestTime = timestamp;
+        latestSequence = frameIndex;
+        unread = true;
+        frameReady.notify_one();
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    ended = true;
+    frameReady.notify_all();
+}
+
+/*
+This function returns a monotonic time in seconds, the clock capture timestamps are given on.
+ */
+double captureClock()
+{
+    return (std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
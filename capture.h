@@ -0,0 +1,62 @@
+/*
+Puja Chaudhury
+capture.h
+Reading the camera on its own thread. Frames are grabbed as fast as the source delivers them and only the newest
+is kept, stamped with the time it was captured, so processing always starts from the freshest image.
+*/
+
+#ifndef capture_hpp
+#define capture_hpp
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+class CaptureThread
+{
+public:
+    CaptureThread();
+    ~CaptureThread();
+
+    int start(cv::VideoCapture *capture, bool realTime);
+    void stop();
+
+    bool read(cv::Mat &frame, double &timestamp);
+    bool read(cv::Mat &frame, double &timestamp, int64_t &sequence);
+
+    // frame rate reported by the source when capture started, 0 if unknown
+    double fps;
+
+    // frames captured, and frames replaced by a newer one before they were read
+    std::atomic<int> capturedFrames;
+    std::atomic<int> droppedFrames;
+
+private:
+    CaptureThread(const CaptureThread &);
+    CaptureThread &operator=(const CaptureThread &);
+
+    void run();
+
+    cv::VideoCapture *capture;
+    bool realTime;
+
+    std::mutex lock;
+    std::condition_variable frameReady;
+    cv::Mat latest;
+    double latestTime;
+    int64_t latestSequence;
+    bool unread;
+    bool ended;
+
+    std::thread thread;
+    std::atomic<bool> running;
+};
+
+double captureClock();
+
+#endif
@@ -0,0 +1,247 @@
+/*
+Puja Chaudhury
+circle_tracker.cpp
+Function implementations for tracking the circle grid between frames.
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+
+#include "circle_tracker.h"
+
+CircleGridTracker::CircleGridTracker()
+    : windowScale(0.6f),
+      maxGridError(0.2f),
+      trackedFrames(0),
+      searchedFrames(0),
+      trackMs(0),
+      searchMs(0),
+      spacing(0)
+{
+    std::vector<cv::Vec3f> points;
+    CircleGridTarget::objectPoints(points);
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        boardPoints.push_back(cv::Point2f(points[i][0], points[i][1]));
+    }
+}
+
+/*
+This function finds the grid in a BGR or grayscale frame and fills centers in the detector's order.
+It tracks from the previous frame when it can and falls back to the full search when tracking is lost.
+ */
+bool CircleGridTracker::find(cv::Mat &src, std::vector<cv::Point2f> &centers)
+{
+    if (src.size() != imageSize)
+    {
+        reset();
+        imageSize = src.size();
+    }
+
+    if (!previous.empty())
+    {
+        double start = (double)cv::getTickCount();
+        if (src.channels() == 3)
+        {
+            cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
+        }
+        else
+        {
+            gray = src;
+        }
+
+        std::vector<double> areas;
+        bool tracked = track(gray, centers, areas) && verify(centers);
+        trackMs += ((double)cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+        if (tracked)
+        {
+            trackedFrames++;
+            remember(centers, areas);
+            return (true);
+        }
+        reset();
+    }
+
+    double start = (double)cv::getTickCount();
+    bool found = CircleGridTarget::find(src, centers);
+    searchMs += ((double)cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+    searchedFrames++;
+    if (found && verify(centers))
+    {
+        remember(centers, std::vector<double>());
+    }
+
+    return (found);
+}
+
+/*
+This function forgets the grid, so the next frame runs the full search.
+ */
+void CircleGridTracker::reset()
+{
+    previous.clear();
+    velocity.clear();
+    previousAreas.clear();
+    spacing = 0;
+}
+
+void CircleGridTracker::printStats()
+{
+    int frames = trackedFrames + searchedFrames;
+    if (frames == 0)
+    {
+        return;
+    }
+    printf("Circle grid: %d frames tracked (%.2f ms each), %d full searches (%.2f ms each)\n",
+           trackedFrames, trackedFrames > 0 ? trackMs / trackedFrames : 0.0, searchedFrames, searchedFrames > 0 ? searchMs / searchedFrames : 0.0);
+}
+
+/*
+This function re-locates every circle near its predicted position. In each window the circle is separated from the
+paper with Otsu's threshold, and the dark region nearest the prediction that does not touch the window's edge is taken;
+its area centroid is the new centre, the same measure the blob detector uses. A circle whose area changed by more than
+a factor of two and a half since the last frame, or that could not be found, loses the track.
+ */
+bool CircleGridTracker::track(const cv::Mat &gray, std::vector<cv::Point2f> &centers, std::vector<double> &areas)
+{
+    int half = std::max(4, cvRound(spacing * windowScale));
+    cv::Rect bounds(0, 0, gray.cols, gray.rows);
+    centers.resize(previous.size());
+    areas.resize(previous.size());
+
+    cv::Mat mask;
+    std::vector<std::vector<cv::Point>> contours;
+    for (size_t i = 0; i < previous.size(); i++)
+    {
+        cv::Point2f predicted = previous[i] + velocity[i];
+        cv::Rect window(cvRound(predicted.x) - half, cvRound(predicted.y) - half, 2 * half + 1, 2 * half + 1);
+        if ((window & bounds) != window)
+        {
+            return (false);
+        }
+
+        cv::threshold(gray(window), mask, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+        cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
+
+        cv::Point2f local = predicted - cv::Point2f((float)window.x, (float)window.y);
+        double bestDistance = DBL_MAX;
+        for (size_t c = 0; c < contours.size(); c++)
+        {
+            cv::Rect box = cv::boundingRect(contours[c]);
+            if (box.x == 0 || box.y == 0 || box.br().x == mask.cols || box.br().y == mask.rows)
+            {
+                continue;
+            }
+            cv::Moments m = cv::moments(contours[c]);
+            if (m.m00 < 4)
+            {
+                continue;
+            }
+            cv::Point2f centroid((float)(m.m10 / m.m00), (float)(m.m01 / m.m00));
+            double distance = cv::norm(centroid - local);
+            if (distance < bestDistance)
+            {
+                bestDistance = distance;
+                centers[i] = centroid + cv::Point2f((float)window.x, (float)window.y);
+                areas[i] = m.m00;
+            }
+        }
+
+        if (bestDistance == DBL_MAX)
+        {
+            return (false);
+        }
+        if (!previousAreas.empty() && (areas[i] > previousAreas[i] * 2.5 || areas[i] < previousAreas[i] / 2.5))
+        {
+            return (false);
+        }
+    }
+
+    return (true);
+}
+
+/*
+This function checks the grid's topology: the board is flat, so a single homography must carry every board point
+to its centre. Swapped, missing or stray circles break the fit. It also measures the neighbour distance the next frame's windows use.
+ */
+bool CircleGridTracker::verify(const std::vector<cv::Point2f> &centers)
+{
+    if (centers.size() != boardPoints.size())
+    {
+        return (false);
+    }
+
+    std::vector<float> nearest(centers.size(), FLT_MAX);
+    for (size_t i = 0; i < centers.size(); i++)
+    {
+        for (size_t j = i + 1; j < centers.size(); j++)
+        {
+            float d = (float)cv::norm(centers[i] - centers[j]);
+            nearest[i] = std::min(nearest[i], d);
+            nearest[j] = std::min(nearest[j], d);
+        }
+    }
+    std::nth_element(nearest.begin(), nearest.begin() + nearest.size() / 2, nearest.end());
+    float neighbour = nearest[nearest.size() / 2];
+    if (neighbour < 2)
+    {
+        return (false);
+    }
+
+    cv::Mat H = cv::findHomography(boardPoints, centers, 0);
+    if (H.empty())
+    {
+        return (false);
+    }
+    std::vector<cv::Point2f> fitted;
+    cv::perspectiveTransform(boardPoints, fitted, H);
+    for (size_t i = 0; i < centers.size(); i++)
+    {
+        if (cv::norm(fitted[i] - centers[i]) > maxGridError * neighbour)
+        {
+            return (false);
+        }
+    }
+
+    spacing = neighbour;
+    return (true);
+}
+
+/*
+This function keeps the accepted grid for the next prediction, moving each circle on by its last displacement.
+ */
+void CircleGridTracker::remember(const std::vector<cv::Point2f> &centers, const std::vector<double> &areas)
+{
+    if (previous.size() == centers.size())
+    {
+        velocity.resize(centers.size());
+        for (size_t i = 0; i < centers.size(); i++)
+        {
+            velocity[i] = centers[i] - previous[i];
+        }
+    }
+    else
+    {
+        velocity.assign(centers.size(), cv::Point2f(0, 0));
+    }
+    previous = centers;
+    previousAreas = areas;
+}
+
+/*
+This function returns the tracker behind findCircleGridTracked.
+ */
+CircleGridTracker &circleGridTracker()
+{
+    static CircleGridTracker tracker;
+    return (tracker);
+}
+
+/*
+This function has the same form as CircleGridTarget::find, so it can stand in for the full search wherever one video stream is processed.
+ */
+bool findCircleGridTracked(cv::Mat &src, std::vector<cv::Point2f> &centers)
+{
+    return (circleGridTracker().find(src, centers));
+}
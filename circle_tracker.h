@@ -0,0 +1,61 @@
+/*
+Puja Chaudhury
+circle_tracker.h
+Frame-to-frame tracking of the asymmetric circle grid. Once the grid has been found, each circle is predicted from its
+last two positions and re-located as a dark blob inside a small window around the prediction. The result is accepted only
+if the grid still fits a plane-to-image homography; otherwise the full cv::findCirclesGrid search runs again.
+*/
+
+#ifndef circle_tracker_hpp
+#define circle_tracker_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/calib3d.hpp>
+
+#include "board.h"
+
+class CircleGridTracker
+{
+public:
+    CircleGridTracker();
+
+    bool find(cv::Mat &src, std::vector<cv::Point2f> &centers);
+    void reset();
+    void printStats();
+
+    // half the search window as a fraction of the distance between neighbouring circles
+    float windowScale;
+
+    // largest distance of a circle from the grid's homography fit, as a fraction of the neighbour distance
+    float maxGridError;
+
+    // frames the grid was tracked in, and frames that needed the full search
+    int trackedFrames;
+    int searchedFrames;
+    double trackMs;
+    double searchMs;
+
+private:
+    bool track(const cv::Mat &gray, std::vector<cv::Point2f> &centers, std::vector<double> &areas);
+    bool verify(const std::vector<cv::Point2f> &centers);
+    void remember(const std::vector<cv::Point2f> &centers, const std::vector<double> &areas);
+
+    // grey copy of the frame, kept so its buffer is reused
+    cv::Mat gray;
+
+    std::vector<cv::Point2f> previous;
+    std::vector<cv::Point2f> velocity;
+    std::vector<double> previousAreas;
+    std::vector<cv::Point2f> boardPoints;
+    cv::Size imageSize;
+    float spacing;
+};
+
+CircleGridTracker &circleGridTracker();
+
+bool findCircleGridTracked(cv::Mat &src, std::vector<cv::Point2f> &centers);
+
+#endif
@@ -0,0 +1,254 @@
+/*
+Puja Chaudhury
+compositor.cpp
+Function implementations for warping an image onto the target and blending it into the frame.
+*/
+
+#include <cmath>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "compositor.h"
+
+// x / 255 rounded, for x up to 255 * 255
+static inline int div255(int x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+#if CV_SIMD128
+static inline cv::v_uint16x8 div255(const cv::v_uint16x8 &x)
+{
+    cv::v_uint16x8 t = x + cv::v_setall_u16(128);
+    return cv::v_shr<8>(t + cv::v_shr<8>(t));
+}
+
+// a * b / 255 for 16 values at once
+static inline cv::v_uint8x16 scale8(const cv::v_uint8x16 &a, const cv::v_uint8x16 &b)
+{
+    cv::v_uint16x8 al, ah, bl, bh;
+    cv::v_expand(a, al, ah);
+    cv::v_expand(b, bl, bh);
+    return cv::v_pack(div255(cv::v_mul_wrap(al, bl)), div255(cv::v_mul_wrap(ah, bh)));
+}
+
+// d * (255 - a) / 255 + s for 16 values at once, s being premultiplied by a
+static inline cv::v_uint8x16 over8(const cv::v_uint8x16 &d, const cv::v_uint8x16 &s, const cv::v_uint8x16 &a)
+{
+    return scale8(d, cv::v_setall_u8(255) - a) + s;
+}
+#endif
+
+/*
+This function blends one row of premultiplied BGRA pixels onto a row of BGR pixels. When a mask is given,
+each source pixel is first scaled by it. The main loop handles 16 pixels at a time with OpenCV's universal intrinsics.
+ */
+void compositeRow(uchar *dst, const uchar *src, const uchar *mask, int width)
+{
+    int x = 0;
+#if CV_SIMD128
+    for (; x <= width - 16; x += 16)
+    {
+        cv::v_uint8x16 sb, sg, sr, sa, db, dg, dr;
+        cv::v_load_deinterleave(src + 4 * x, sb, sg, sr, sa);
+        if (mask != NULL)
+        {
+            cv::v_uint8x16 m = cv::v_load(mask + x);
+            sb = scale8(sb, m);
+            sg = scale8(sg, m);
+            sr = scale8(sr, m);
+            sa = scale8(sa, m);
+        }
+        cv::v_load_deinterleave(dst + 3 * x, db, dg, dr);
+        cv::v_store_interleave(dst + 3 * x, over8(db, sb, sa), over8(dg, sg, sa), over8(dr, sr, sa));
+    }
+#endif
+    for (; x < width; x++)
+    {
+        const uchar *s = src + 4 * x;
+        uchar *d = dst + 3 * x;
+        int m = mask != NULL ? mask[x] : 255;
+        int a = div255(s[3] * m);
+        for (int c = 0; c < 3; c++)
+        {
+            d[c] = cv::saturate_cast<uchar>(div255(d[c] * (255 - a)) + div255(s[c] * m));
+        }
+    }
+}
+
+Compositor::Compositor(float feather)
+    : feather(feather),
+      reuseDistance(0.25f),
+      warpValid(false),
+      warpFeather(0)
+{
+}
+
+/*
+This function reads the image to place on the target, keeping its alpha channel if it has one.
+Loading the same file again does nothing.
+ */
+int Compositor::load(std::string filename)
+{
+    if (filename == this->filename && !image.empty())
+    {
+        return (0);
+    }
+
+    cv::Mat file = cv::imread(filename, cv::IMREAD_UNCHANGED);
+    if (file.empty())
+    {
+        printf("Unable to read image %s\n", filename.c_str());
+        return (-1);
+    }
+    if (file.depth() != CV_8U)
+    {
+        file.convertTo(file, CV_8U, file.depth() == CV_16U ? 1.0 / 256 : 255.0);
+    }
+
+    if (setImage(file) != 0)
+    {
+        return (-1);
+    }
+
+    this->filename = filename;
+
+    return (0);
+}
+
+/*
+This function replaces the image with an 8-bit grey, BGR or BGRA one, such as a decoded video frame.
+It is converted to premultiplied BGRA in the existing buffer, which is only reallocated when the size changes.
+ */
+int Compositor::setImage(const cv::Mat &src)
+{
+    warpValid = false;
+    switch (src.channels())
+    {
+    case 1:
+        cv::cvtColor(src, image, cv::COLOR_GRAY2BGRA);
+        break;
+    case 3:
+        cv::cvtColor(src, image, cv::COLOR_BGR2BGRA);
+        break;
+    case 4:
+        src.copyTo(image);
+        break;
+    default:
+        return (-1);
+    }
+
+    // opaque images are premultiplied as they are
+    if (src.channels() == 4)
+    {
+        for (int y = 0; y < image.rows; y++)
+        {
+            cv::Vec4b *p = image.ptr<cv::Vec4b>(y);
+            for (int x = 0; x < image.cols; x++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    p[x][c] = (uchar)div255(p[x][c] * p[x][3]);
+                }
+            }
+        }
+    }
+
+    // the image no longer comes from the loaded file, so loading that file again has to read it
+    filename.clear();
+
+    return (0);
+}
+
+/*
+This function places the loaded image on the quad given in frame coordinates, corners in the image's
+top-left, top-right, bottom-right, bottom-left order. Everything happens inside the quad's bounding rectangle,
+so the cost follows the target's size on screen rather than the frame size.
+ */
+int Compositor::draw(cv::Mat &frame, const cv::Point2f quad[4])
+{
+    if (image.empty() || frame.type() != CV_8UC3)
+    {
+        return (-1);
+    }
+
+    // a quad that has not moved since the last warp is blended again from the scratch buffers
+    bool still = warpValid && frame.size() == warpBuffer.size() && feather == warpFeather;
+    for (int i = 0; i < 4 && still; i++)
+    {
+        still = cv::norm(quad[i] - warpQuad[i]) <= reuseDistance;
+    }
+    if (still)
+    {
+        return (blend(frame));
+    }
+
+    std::vector<cv::Point2f> corners(quad, quad + 4);
+    cv::Rect roi = cv::boundingRect(corners) & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (roi.empty())
+    {
+        return (0);
+    }
+
+    // warp straight into the region, with the quad moved into its coordinates
+    cv::Point2f imageQuad[4] = {cv::Point2f(0, 0), cv::Point2f(image.cols, 0), cv::Point2f(image.cols, image.rows), cv::Point2f(0, image.rows)};
+    cv::Point2f localQuad[4];
+    for (int i = 0; i < 4; i++)
+    {
+        localQuad[i] = quad[i] - cv::Point2f(roi.x, roi.y);
+    }
+
+    // the scratch buffers are kept at frame size and each frame uses their top-left corner, so nothing is reallocated
+    warpBuffer.create(frame.size(), CV_8UC4);
+    maskBuffer.create(frame.size(), CV_8UC1);
+    cv::Mat warped = warpBuffer(cv::Rect(0, 0, roi.width, roi.height));
+    cv::Mat mask = maskBuffer(cv::Rect(0, 0, roi.width, roi.height));
+
+    cv::Mat transform = cv::getPerspectiveTransform(imageQuad, localQuad);
+    cv::warpPerspective(image, warped, transform, roi.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar::all(0));
+
+    // a blurred copy of the quad fades the image in over the feather width inside its edges;
+    // the blur must not read the stale buffer around the region
+    bool feathered = feather > 0;
+    if (feathered)
+    {
+        cv::Point polygon[4];
+        for (int i = 0; i < 4; i++)
+        {
+            polygon[i] = cv::Point(cvRound(localQuad[i].x), cvRound(localQuad[i].y));
+        }
+        mask.setTo(cv::Scalar::all(0));
+        cv::fillConvexPoly(mask, polygon, 4, cv::Scalar(255), cv::LINE_AA);
+        int k = 2 * cvRound(feather) + 1;
+        cv::blur(mask, mask, cv::Size(k, k), cv::Point(-1, -1), cv::BORDER_REFLECT_101 | cv::BORDER_ISOLATED);
+    }
+
+    warpValid = true;
+    warpRoi = roi;
+    warpFeather = feather;
+    for (int i = 0; i < 4; i++)
+    {
+        warpQuad[i] = quad[i];
+    }
+
+    return (blend(frame));
+}
+
+/*
+This function blends the warped image held in the scratch buffers onto the frame, inside the quad's bounding rectangle.
+ */
+int Compositor::blend(cv::Mat &frame)
+{
+    cv::Mat warped = warpBuffer(cv::Rect(0, 0, warpRoi.width, warpRoi.height));
+    cv::Mat mask = maskBuffer(cv::Rect(0, 0, warpRoi.width, warpRoi.height));
+    bool feathered = warpFeather > 0;
+    for (int y = 0; y < warpRoi.height; y++)
+    {
+        compositeRow(frame.ptr<uchar>(warpRoi.y + y) + 3 * warpRoi.x, warped.ptr<uchar>(y), feathered ? mask.ptr<uchar>(y) : NULL, warpRoi.width);
+    }
+
+    return (0);
+}
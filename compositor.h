@@ -0,0 +1,51 @@
+/*
+Puja Chaudhury
+compositor.h
+Placing an image on the target. The image is warped only into the bounding rectangle of the target's quad
+and blended onto the frame in one pass that honours the image's alpha channel and softens the quad's edges.
+While the quad stays put and the image is unchanged, the warped image is kept and only blended again.
+*/
+
+#ifndef compositor_hpp
+#define compositor_hpp
+
+#include <string>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+class Compositor
+{
+public:
+    Compositor(float feather = 2.0f);
+
+    int load(std::string filename);
+    int setImage(const cv::Mat &src);
+    int draw(cv::Mat &frame, const cv::Point2f quad[4]);
+
+    // width in pixels over which the image fades in from the quad's edges, 0 for hard edges
+    float feather;
+
+    // largest movement of a quad corner, in pixels, for which the previous warp is reused
+    float reuseDistance;
+
+private:
+    int blend(cv::Mat &frame);
+
+    std::string filename;
+    cv::Mat image; // 8-bit BGRA, opaque where the file had no alpha channel
+
+    // scratch buffers the size of the frame, of which each draw uses the region's size
+    cv::Mat warpBuffer;
+    cv::Mat maskBuffer;
+
+    // what the scratch buffers hold
+    bool warpValid;
+    cv::Point2f warpQuad[4];
+    cv::Rect warpRoi;
+    float warpFeather;
+};
+
+void compositeRow(uchar *dst, const uchar *src, const uchar *mask, int width);
+
+#endif
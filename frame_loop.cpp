@@ -0,0 +1,366 @@
+/*
+Puja Chaudhury
+frame_loop.cpp
+Function implementations for the capture, output and key handling shared by the AR programs.
+*/
+
+#include <cstdio>
+
+#include <opencv2/highgui.hpp>
+
+#include "frame_loop.h"
+#include "3D_projection.h"
+#include "alloc_tracker.h"
+#include "buffer_pool.h"
+#include "quality_controller.h"
+#include "resolution.h"
+#include "trace.h"
+#include "yuv_source.h"
+
+FrameLoopOptions::FrameLoopOptions()
+    : captureHeight(1080),
+      processingHeight(480),
+      posePort(0),
+      poseBatch(1),
+      rawCamera(false),
+      allocStats(false)
+{
+}
+
+/*
+This function reads the shared options from the command line and skips every other argument.
+ */
+void FrameLoopOptions::parse(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--model" && i + 1 < argc)
+        {
+            modelFilename = argv[++i];
+        }
+        if (std::string(argv[i]) == "--video" && i + 1 < argc)
+        {
+            videoFilename = argv[++i];
+        }
+        if (std::string(argv[i]) == "--capture" && i + 1 < argc)
+        {
+            captureHeight = std::stoi(argv[++i]);
+        }
+        if (std::string(argv[i]) == "--processing" && i + 1 < argc)
+        {
+            processingHeight = std::stoi(argv[++i]);
+        }
+        if (std::string(argv[i]) == "--publish" && i + 1 < argc)
+        {
+            publishName = argv[++i];
+        }
+        if (std::string(argv[i]) == "--yuv")
+        {
+            rawCamera = true;
+        }
+        if (std::string(argv[i]) == "--raw-size" && i + 1 < argc)
+        {
+            sscanf(argv[++i], "%dx%d", &rawSize.width, &rawSize.height);
+        }
+        if (std::string(argv[i]) == "--pose-port" && i + 1 < argc)
+        {
+            posePort = std::stoi(argv[++i]);
+        }
+        if (std::string(argv[i]) == "--pose-batch" && i + 1 < argc)
+        {
+            poseBatch = std::stoi(argv[++i]);
+        }
+        if (std::string(argv[i]) == "--alloc-stats")
+        {
+            allocStats = true;
+        }
+        if (std::string(argv[i]) == "--trace" && i + 1 < argc)
+        {
+            traceFilename = argv[++i];
+        }
+    }
+}
+
+FrameLoop::FrameLoop()
+    : format(PIXEL_BGR),
+      frameTime(0),
+      sequence(0),
+      sourceFormat(PIXEL_BGR),
+      lumaReady(false),
+      frameId(0),
+      snapshotNumber(1),
+      recordingNumber(1)
+{
+}
+
+FrameLoop::~FrameLoop()
+{
+    capture.stop();
+}
+
+/*
+This function reads the shared options, loads the model, opens the source and starts capturing it, and opens the
+display window, the shared memory output and the pose stream that were asked for. Tracing starts before the capture
+and writer threads record anything, so their first frames are on the timeline.
+It returns -1 when the model or the source cannot be opened.
+ */
+int FrameLoop::open(int argc, char *argv[])
+{
+    options.parse(argc, argv);
+
+    if (!options.modelFilename.empty() && loadModel(options.modelFilename, model) != 0)
+    {
+        printf("Failed to load model %s\n", options.modelFilename.c_str());
+        return (-1);
+    }
+
+    sourceFormat = PIXEL_BGR;
+    if (isYuvFile(options.videoFilename))
+    {
+        YuvFileCapture *yuvFile = new YuvFileCapture(options.videoFilename, options.rawSize);
+        sourceFormat = yuvFile->format;
+        cap.reset(yuvFile);
+    }
+    else
+    {
+        cap.reset(options.videoFilename.empty() ? new cv::VideoCapture(0) : new cv::VideoCapture(options.videoFilename));
+    }
+    if (!cap->isOpened())
+    {
+        printf("Failed to open video device");
+        return (-1);
+    }
+
+    cap->set(cv::CAP_PROP_FRAME_WIDTH, options.captureHeight * 16 / 9);
+    cap->set(cv::CAP_PROP_FRAME_HEIGHT, options.captureHeight);
+    if (options.rawCamera && options.videoFilename.empty())
+    {
+        sourceFormat = openRawCamera(*cap);
+        printf(sourceFormat == PIXEL_YUYV ? "Camera delivers YUYV\n" : "Camera only delivers BGR\n");
+    }
+    captureSize = cv::Size((int)cap->get(cv::CAP_PROP_FRAME_WIDTH), (int)cap->get(cv::CAP_PROP_FRAME_HEIGHT));
+    printf("Expected size: %d %d\n", captureSize.width, captureSize.height);
+
+    // detection runs on a downscaled copy; pose, drawing and compositing use the captured frame
+    detectionSize = processingSize(captureSize, options.processingHeight);
+    printf("Detection size: %d %d\n", detectionSize.width, detectionSize.height);
+
+    traceThreadName("main");
+    if (!options.traceFilename.empty())
+    {
+        traceStart();
+    }
+
+    // the capture thread always holds the newest frame; a video file is paced like a live camera
+    capture.start(cap.get(), !options.videoFilename.empty());
+
+    cv::namedWindow("Video", 1);
+
+    if (!options.publishName.empty() && publisher.open(options.publishName, captureSize, CV_8UC3) == 0)
+    {
+        printf("Publishing frames and poses to %s\n", options.publishName.c_str());
+    }
+
+    poseServer.batchSize = options.poseBatch;
+    if (options.posePort > 0 && poseServer.open(options.posePort) == 0)
+    {
+        printf("Streaming poses on 127.0.0.1:%d\n", options.posePort);
+    }
+
+    return (0);
+}
+
+/*
+This function waits for the newest frame and converts it to BGR, for drawing and display, in videoFrame; a YUV frame is
+left as it is in capturedFrame for luma() to detect on. When the source delivers a different size than it reported,
+the detection size and the shared memory output follow it. Allocation counting, when asked for, starts with the first
+frame, so only the frame loop is counted. It returns false once the source has ended.
+ */
+bool FrameLoop::read()
+{
+    if (options.allocStats && !allocTrackingEnabled())
+    {
+        allocTrackingStart();
+    }
+
+    allocStage(ALLOC_CAPTURE);
+    // the wait ends the previous frame; the frame read is traced under the id the capture thread gave it
+    traceBegin("wait for frame");
+    if (!capture.read(capturedFrame, frameTime, sequence))
+    {
+        traceEnd("wait for frame");
+        printf("EmptyFrameError\n");
+        return (false);
+    }
+    traceEnd("wait for frame");
+    traceFrame(sequence);
+    traceBegin("frame");
+
+    traceBegin("convert");
+    allocStage(ALLOC_DETECT);
+    format = frameFormat(capturedFrame, sourceFormat, captureSize);
+    if (format == PIXEL_BGR)
+    {
+        videoFrame = capturedFrame;
+    }
+    else
+    {
+        convertToBGR(capturedFrame, format, videoFrame);
+    }
+    lumaReady = false;
+    traceEnd("convert");
+
+    if (videoFrame.size() != captureSize)
+    {
+        captureSize = videoFrame.size();
+        updateDetectionSize();
+        if (publisher.isOpen())
+        {
+            publisher.open(options.publishName, captureSize, CV_8UC3);
+        }
+    }
+
+    return (true);
+}
+
+/*
+This function returns the luma plane of the current frame, taken from a YUV frame without a conversion, or converted
+from a BGR one. It is only extracted on the first call for each frame.
+ */
+cv::Mat &FrameLoop::luma()
+{
+    if (!lumaReady)
+    {
+        lumaPlane(capturedFrame, format, lumaFrame);
+        lumaReady = true;
+    }
+    return (lumaFrame);
+}
+
+/*
+This function sets the detection size again from the capture size, at the processing height the quality settings allow.
+ */
+void FrameLoop::updateDetectionSize()
+{
+    detectionSize = processingSize(captureSize, qualitySettings().processingHeight(options.processingHeight, captureSize.height));
+}
+
+/*
+This function sends the pose of the current frame to the pose stream, with its reprojection error as the quality.
+A frame without a pose is sent too, without the POSE_VALID flag.
+ */
+void FrameLoop::publishPose(std::vector<cv::Vec3f> &points, std::vector<cv::Point2f> &corners, cv::Mat &camera_matrix, cv::Mat &dist_coeff,
+                            cv::Mat &rot, cv::Mat &trans, int targetId, bool posed)
+{
+    if (!poseServer.isOpen())
+    {
+        return;
+    }
+    allocStage(ALLOC_OUTPUT);
+    float quality = posed ? reprojectionError(points, corners, camera_matrix, dist_coeff, rot, trans) : -1;
+    traceBegin("pose send");
+    poseServer.publish(frameId++, frameTime, rot, trans, targetId, quality, posed);
+    traceEnd("pose send");
+}
+
+/*
+This function shows the finished frame and hands it to the recording and the shared memory output when they are open.
+ */
+void FrameLoop::show(const cv::Mat &outputFrame, const cv::Mat &rot, const cv::Mat &trans, bool posed)
+{
+    allocStage(ALLOC_OUTPUT);
+    traceBegin("display");
+    cv::imshow("Video", outputFrame);
+    traceEnd("display");
+    if (writer.isRecording())
+    {
+        traceBegin("queue recording");
+        writer.addFrame(outputFrame);
+        traceEnd("queue recording");
+    }
+    if (publisher.isOpen())
+    {
+        traceBegin("publish");
+        publisher.publish(outputFrame, frameTime, rot, trans, posed);
+        traceEnd("publish");
+    }
+}
+
+/*
+This function waits briefly for a key and closes the frame; it returns the key, or -1 when none was pressed.
+ */
+char FrameLoop::waitKey()
+{
+    traceBegin("wait for key");
+    char key = cv::waitKey(10);
+    traceEnd("wait for key");
+    allocFrameEnd();
+    traceEnd("frame");
+
+    return (key);
+}
+
+/*
+This function handles the keys every program shares: 'v' starts or stops recording the output to a video file and
+'k' saves a snapshot of it. It returns true when the key was one of them.
+ */
+bool FrameLoop::handleKey(char key, const cv::Mat &outputFrame)
+{
+    if (key == 'v')
+    {
+        if (writer.isRecording())
+        {
+            writer.stopRecording();
+            printf("Recording stopped: %d frames written, %d dropped\n", (int)writer.writtenFrames, (int)writer.droppedFrames);
+        }
+        else
+        {
+            std::string fname = "recording-" + std::to_string(recordingNumber++) + ".avi";
+            if (writer.startRecording(fname, outputFrame.size(), capture.fps > 0 ? capture.fps : 30) == 0)
+            {
+                printf("Recording to %s\n", fname.c_str());
+            }
+        }
+        return (true);
+    }
+    if (key == 'k')
+    {
+        std::string fname = "videoFrame-" + std::to_string(snapshotNumber++) + ".jpg";
+        printf("Saving %s\n", fname.c_str());
+        writer.saveImage(fname, outputFrame);
+        return (true);
+    }
+
+    return (false);
+}
+
+/*
+This function stops capturing, closes the outputs and prints their statistics. Queued snapshots and recording frames
+are written first, and the trace last, so it includes their encoding.
+ */
+void FrameLoop::close()
+{
+    capture.stop();
+    printf("Captured %d frames, %d skipped for newer ones\n", (int)capture.capturedFrames, (int)capture.droppedFrames);
+    framePool().printStats();
+    allocPrintStats();
+    if (publisher.isOpen())
+    {
+        printf("Published %llu frames to %s\n", (unsigned long long)publisher.publishedFrames, options.publishName.c_str());
+        publisher.close();
+    }
+    poseServer.printStats();
+
+    writer.stopRecording();
+    writer.flush();
+    if (writer.droppedSnapshots > 0 || writer.droppedFrames > 0)
+    {
+        printf("Writer dropped %d snapshots and %d recording frames\n", (int)writer.droppedSnapshots, (int)writer.droppedFrames);
+    }
+
+    if (!options.traceFilename.empty())
+    {
+        traceStop();
+        traceWrite(options.traceFilename);
+    }
+}
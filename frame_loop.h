@@ -0,0 +1,115 @@
+/*
+Puja Chaudhury
+frame_loop.h
+What every AR program does around its own detection and drawing: reading the options they share, opening the camera or
+video file and capturing it on its own thread, converting each frame to BGR, and sending every finished frame to the
+display, the recording, shared memory and the pose stream. Snapshots and recordings are taken with the 'k' and 'v' keys,
+and the run ends with the statistics of every part.
+*/
+
+#ifndef frame_loop_hpp
+#define frame_loop_hpp
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "capture.h"
+#include "frame_writer.h"
+#include "mesh_io.h"
+#include "pose_server.h"
+#include "shm_publisher.h"
+
+/*
+The options every program takes; options it does not know are left to the program:
+--model <file>           a model (OBJ, PLY or a converted .mesh file) to place on the target
+--video <file>           play a video file at its own frame rate instead of using the camera
+--capture <height>       the capture height, default 1080 at 16:9
+--processing <height>    the height detection runs at, default 480
+--publish <name>         publish output frames and poses to shared memory for other processes
+--pose-port <port>       stream poses to subscribers on this host, --pose-batch <n> of them to a datagram
+--yuv                    ask the camera for YUYV frames, which are detected on their luma plane like .y4m and .nv12 videos
+--raw-size <w>x<h>       the frame size of a .nv12 video, which does not record it
+--alloc-stats            count heap allocations per stage and per frame and report them on exit
+--trace <file>           write a timeline of every thread's work per frame as Chrome trace JSON, to open in Perfetto
+ */
+struct FrameLoopOptions
+{
+    FrameLoopOptions();
+
+    void parse(int argc, char *argv[]);
+
+    std::string modelFilename;
+    std::string videoFilename;
+    int captureHeight;
+    int processingHeight;
+    std::string publishName;
+    int posePort;
+    int poseBatch;
+    bool rawCamera;
+    cv::Size rawSize;
+    bool allocStats;
+    std::string traceFilename;
+};
+
+class FrameLoop
+{
+public:
+    FrameLoop();
+    ~FrameLoop();
+
+    int open(int argc, char *argv[]);
+    bool read();
+    cv::Mat &luma();
+    void updateDetectionSize();
+
+    void publishPose(std::vector<cv::Vec3f> &points, std::vector<cv::Point2f> &corners, cv::Mat &camera_matrix, cv::Mat &dist_coeff,
+                     cv::Mat &rot, cv::Mat &trans, int targetId, bool posed);
+    void show(const cv::Mat &outputFrame, const cv::Mat &rot, const cv::Mat &trans, bool posed);
+    char waitKey();
+    bool handleKey(char key, const cv::Mat &outputFrame);
+    void close();
+
+    FrameLoopOptions options;
+
+    // the model given with --model, empty without one
+    MappedMesh model;
+
+    // size the source delivers, and the size detection runs at
+    cv::Size captureSize;
+    cv::Size detectionSize;
+
+    // the newest frame as captured and in BGR, its pixel format, capture time and capture sequence number
+    cv::Mat capturedFrame;
+    cv::Mat videoFrame;
+    int format;
+    double frameTime;
+    int64_t sequence;
+
+    CaptureThread capture;
+    FrameWriter writer;
+
+private:
+    FrameLoop(const FrameLoop &);
+    FrameLoop &operator=(const FrameLoop &);
+
+    // the capture device or file; the destructor stops the capture thread before it is released
+    std::unique_ptr<cv::VideoCapture> cap;
+    int sourceFormat;
+
+    cv::Mat lumaFrame;
+    bool lumaReady;
+
+    ShmPublisher publisher;
+    PoseServer poseServer;
+    uint64_t frameId;
+
+    int snapshotNumber;
+    int recordingNumber;
+};
+
+#endif
@@ -0,0 +1,259 @@
+/*
+Puja Chaudhury
+frame_writer.cpp
+Function implementations for the background snapshot and recording writer.
+*/
+
+#include <algorithm>
+#include <cstdio>
+
+#include "frame_writer.h"
+#include "buffer_pool.h"
+#include "alloc_tracker.h"
+#include "trace.h"
+
+/*
+This function encodes an image in the format its file name's extension asks for, then writes the file. The two steps
+are traced apart, so a slow encoder and a slow disk can be told apart on the timeline.
+ */
+static bool encodeAndWrite(const std::string &filename, const cv::Mat &image, int64_t frame)
+{
+    size_t dot = filename.rfind('.');
+    std::vector<uchar> encoded;
+    traceBegin("encode", frame);
+    bool ok = dot != std::string::npos && cv::imencode(filename.substr(dot), image, encoded);
+    traceEnd("encode", frame);
+    if (!ok)
+    {
+        return (false);
+    }
+
+    traceBegin("write", frame);
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (fp != NULL)
+    {
+        ok = fwrite(encoded.data(), 1, encoded.size(), fp) == encoded.size();
+        ok = fclose(fp) == 0 && ok;
+    }
+    traceEnd("write", frame);
+
+    return (fp != NULL && ok);
+}
+
+FrameWriter::FrameWriter(int queueSize, int snapshotThreads)
+    : writtenSnapshots(0),
+      droppedSnapshots(0),
+      writtenFrames(0),
+      droppedFrames(0),
+      queueSize(queueSize > 0 ? queueSize : 1),
+      snapshotsBusy(0),
+      frameBusy(false),
+      recording(false),
+      stopping(false)
+{
+    for (int i = 0; i < std::max(1, snapshotThreads); i++)
+    {
+        threads.push_back(std::thread(&FrameWriter::writeSnapshots, this));
+    }
+    threads.push_back(std::thread(&FrameWriter::writeRecording, this));
+}
+
+/*
+Everything still queued is written and the recording is closed before the threads exit.
+ */
+FrameWriter::~FrameWriter()
+{
+    stopRecording();
+    flush();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+}
+
+/*
+This function queues a copy of the image to be written to the given file, in any format cv::imwrite supports.
+It returns false, and counts a dropped snapshot, when the queue is full.
+ */
+bool FrameWriter::saveImage(std::string filename, const cv::Mat &image)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    if (snapshots.size() >= queueSize)
+    {
+        droppedSnapshots++;
+        return (false);
+    }
+    guard.unlock();
+
+    // copy outside the lock into a pooled buffer; the loop goes on drawing into its own frame
+    cv::Mat copy = framePool().acquire(image.size(), image.type());
+    image.copyTo(copy);
+
+    guard.lock();
+    snapshots.push_back(WriterJob{filename, copy, traceCurrentFrame()});
+    guard.unlock();
+    workAvailable.notify_all();
+
+    return (true);
+}
+
+/*
+This function starts recording to a video file with the MJPG codec, which every OpenCV build can write to .avi.
+ */
+int FrameWriter::startRecording(std::string filename, cv::Size frameSize, double fps)
+{
+    stopRecording();
+
+    std::unique_lock<std::mutex> guard(lock);
+    if (!video.open(filename, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), fps > 0 ? fps : 30, frameSize))
+    {
+        printf("Unable to open %s for recording\n", filename.c_str());
+        return (-1);
+    }
+    recording = true;
+
+    return (0);
+}
+
+/*
+This function stops accepting frames, waits for the queued ones to be encoded and closes the file.
+ */
+int FrameWriter::stopRecording()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    recording = false;
+    waitForRecording(guard);
+    if (video.isOpened())
+    {
+        video.release();
+    }
+
+    return (0);
+}
+
+bool FrameWriter::isRecording() const
+{
+    return (recording);
+}
+
+/*
+This function queues a copy of the frame for the recording. It returns false, and counts a dropped frame,
+when the encoder has fallen a full queue behind.
+ */
+bool FrameWriter::addFrame(const cv::Mat &frame)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    if (!recording)
+    {
+        return (false);
+    }
+    if (frames.size() >= queueSize)
+    {
+        droppedFrames++;
+        return (false);
+    }
+    guard.unlock();
+
+    cv::Mat copy = framePool().acquire(frame.size(), frame.type());
+    frame.copyTo(copy);
+
+    guard.lock();
+    frames.push_back(WriterJob{std::string(), copy, traceCurrentFrame()});
+    guard.unlock();
+    workAvailable.notify_all();
+
+    return (true);
+}
+
+/*
+This function waits until every queued snapshot and recording frame has been written.
+ */
+void FrameWriter::flush()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    workDone.wait(guard, [this]
+                  { return snapshots.empty() && snapshotsBusy == 0 && frames.empty() && !frameBusy; });
+}
+
+void FrameWriter::waitForRecording(std::unique_lock<std::mutex> &guard)
+{
+    workDone.wait(guard, [this]
+                  { return frames.empty() && !frameBusy; });
+}
+
+/*
+This function runs on each snapshot thread, encoding queued images until the writer is destroyed.
+ */
+void FrameWriter::writeSnapshots()
+{
+    allocThreadStage(ALLOC_OUTPUT);
+    traceThreadName("snapshot writer");
+    std::unique_lock<std::mutex> guard(lock);
+    while (true)
+    {
+        workAvailable.wait(guard, [this]
+                           { return stopping || !snapshots.empty(); });
+        if (snapshots.empty())
+        {
+            return;
+        }
+
+        WriterJob job = snapshots.front();
+        snapshots.pop_front();
+        snapshotsBusy++;
+        guard.unlock();
+
+        if (encodeAndWrite(job.filename, job.image, job.frame))
+        {
+            writtenSnapshots++;
+        }
+        else
+        {
+            printf("Unable to write %s\n", job.filename.c_str());
+        }
+        framePool().release(job.image);
+
+        guard.lock();
+        snapshotsBusy--;
+        workDone.notify_all();
+    }
+}
+
+/*
+This function runs on the recording thread. Frames are encoded one at a time in the order they were added.
+ */
+void FrameWriter::writeRecording()
+{
+    allocThreadStage(ALLOC_OUTPUT);
+    traceThreadName("recorder");
+    std::unique_lock<std::mutex> guard(lock);
+    while (true)
+    {
+        workAvailable.wait(guard, [this]
+                           { return stopping || !frames.empty(); });
+        if (frames.empty())
+        {
+            return;
+        }
+
+        WriterJob job = frames.front();
+        frames.pop_front();
+        frameBusy = true;
+        guard.unlock();
+
+        traceBegin("encode", job.frame);
+        video.write(job.image);
+        traceEnd("encode", job.frame);
+        writtenFrames++;
+        framePool().release(job.image);
+
+        guard.lock();
+        frameBusy = false;
+        workDone.notify_all();
+    }
+}
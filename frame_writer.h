@@ -0,0 +1,81 @@
+/*
+Puja Chaudhury
+frame_writer.h
+Writing snapshots and recordings of the AR output without holding up the video loop.
+Frames are copied into bounded queues and encoded by worker threads; when a queue is full the new frame is
+dropped and counted instead of making the loop wait.
+*/
+
+#ifndef frame_writer_hpp
+#define frame_writer_hpp
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+
+// An image queued for a background thread, with the frame that queued it for the trace timeline
+struct WriterJob
+{
+    std::string filename; // empty for recording frames
+    cv::Mat image;
+    int64_t frame;
+};
+
+class FrameWriter
+{
+public:
+    FrameWriter(int queueSize = 8, int snapshotThreads = 2);
+    ~FrameWriter();
+
+    bool saveImage(std::string filename, const cv::Mat &image);
+
+    int startRecording(std::string filename, cv::Size frameSize, double fps);
+    int stopRecording();
+    bool isRecording() const;
+    bool addFrame(const cv::Mat &frame);
+
+    void flush();
+
+    // snapshots and recording frames written, and dropped because their queue was full
+    std::atomic<int> writtenSnapshots;
+    std::atomic<int> droppedSnapshots;
+    std::atomic<int> writtenFrames;
+    std::atomic<int> droppedFrames;
+
+private:
+    FrameWriter(const FrameWriter &);
+    FrameWriter &operator=(const FrameWriter &);
+
+    void writeSnapshots();
+    void writeRecording();
+    void waitForRecording(std::unique_lock<std::mutex> &guard);
+
+    size_t queueSize;
+    std::mutex lock;
+    std::condition_variable workAvailable;
+    std::condition_variable workDone;
+
+    std::deque<WriterJob> snapshots;
+    int snapshotsBusy;
+
+    // only the recording thread touches the writer while frames are queued or being encoded
+    std::deque<WriterJob> frames;
+    bool frameBusy;
+    cv::VideoWriter video;
+    bool recording;
+
+    bool stopping;
+    std::vector<std::thread> threads;
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*
+Puja Chaudhury
+frustum.cpp
+Function implementations for frustum culling and level-of-detail selection.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "frustum.h"
+
+// lens distortion can push points a little outside the pinhole frustum, so spheres are tested slightly enlarged
+static const float distortionMargin = 1.1f;
+
+// target length of one tessellation segment on screen, in pixels
+static const float pixelsPerSegment = 12.0f;
+
+/*
+This function unpacks the rotation, translation and intrinsics of the current frame into a ViewFrustum.
+ */
+int makeFrustum(ViewFrustum &frustum, cv::Mat &camera_matrix, cv::Mat &rot, cv::Mat &trans, cv::Size imageSize)
+{
+    cv::Mat rotMat, R, t, K;
+    cv::Rodrigues(rot, rotMat);
+    rotMat.convertTo(R, CV_64F);
+    trans.convertTo(t, CV_64F);
+    camera_matrix.convertTo(K, CV_64F);
+
+    for (int i = 0; i < 9; i++)
+    {
+        frustum.R[i] = R.at<double>(i / 3, i % 3);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        frustum.t[i] = t.at<double>(i);
+    }
+    frustum.fx = K.at<double>(0, 0);
+    frustum.fy = K.at<double>(1, 1);
+    frustum.cx = K.at<double>(0, 2);
+    frustum.cy = K.at<double>(1, 2);
+    frustum.width = imageSize.width;
+    frustum.height = imageSize.height;
+
+    return (0);
+}
+
+/*
+This function transforms a point from board coordinates into camera coordinates.
+ */
+cv::Point3d toCamera(const ViewFrustum &frustum, const cv::Point3f &p)
+{
+    const double *R = frustum.R;
+    return cv::Point3d(R[0] * p.x + R[1] * p.y + R[2] * p.z + frustum.t[0],
+                       R[3] * p.x + R[4] * p.y + R[5] * p.z + frustum.t[1],
+                       R[6] * p.x + R[7] * p.y + R[8] * p.z + frustum.t[2]);
+}
+
+/*
+This function tests a bounding sphere in board coordinates against the near plane and the four planes through the image borders.
+It returns false when the object cannot appear in the image. Otherwise it sets screenRadius to the approximate radius of
+the object on screen in pixels, and crossesNear when part of the object is behind the near plane and must be clipped.
+ */
+bool sphereVisible(const ViewFrustum &frustum, const BoundingSphere &sphere, float &screenRadius, bool &crossesNear)
+{
+    cv::Point3d c = toCamera(frustum, sphere.center);
+    double r = sphere.radius * distortionMargin;
+
+    if (c.z + r < frustumNear)
+    {
+        return (false);
+    }
+
+    // inward plane normals: a point is inside the left border when fx * x + cx * z >= 0, and so on
+    double planes[4][3] = {{frustum.fx, 0, frustum.cx},
+                           {-frustum.fx, 0, frustum.width - frustum.cx},
+                           {0, frustum.fy, frustum.cy},
+                           {0, -frustum.fy, frustum.height - frustum.cy}};
+    for (int i = 0; i < 4; i++)
+    {
+        double len = std::sqrt(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+        double distance = (planes[i][0] * c.x + planes[i][1] * c.y + planes[i][2] * c.z) / len;
+        if (distance < -r)
+        {
+            return (false);
+        }
+    }
+
+    crossesNear = c.z - r < frustumNear;
+    screenRadius = crossesNear ? (float)std::max(frustum.width, frustum.height) : (float)(std::max(frustum.fx, frustum.fy) * sphere.radius / c.z);
+
+    return (true);
+}
+
+/*
+This function marks which of the given board points lie in front of the near plane,
+so edges touching a point behind the camera can be skipped instead of drawn to a garbage projection.
+ */
+int markInFront(const ViewFrustum &frustum, const std::vector<cv::Vec3f> &points, std::vector<uchar> &inFront)
+{
+    inFront.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        const double *R = frustum.R;
+        double z = R[6] * points[i][0] + R[7] * points[i][1] + R[8] * points[i][2] + frustum.t[2];
+        inFront[i] = z >= frustumNear ? 1 : 0;
+    }
+    return (0);
+}
+
+/*
+This function picks the number of segments for a round object so each segment spans roughly the same number of pixels
+whatever the object's size on screen, within the given limits.
+ */
+int levelOfDetail(float screenRadius, int minSegments, int maxSegments)
+{
+    int segments = (int)std::ceil(2 * CV_PI * screenRadius / pixelsPerSegment);
+    return (std::min(maxSegments, std::max(minSegments, segments)));
+}
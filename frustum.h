@@ -0,0 +1,43 @@
+/*
+Puja Chaudhury
+frustum.h
+Visibility tests for virtual objects against the camera's view, and the choice of tessellation from on-screen size.
+*/
+
+#ifndef frustum_hpp
+#define frustum_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/calib3d.hpp>
+
+// surfaces closer than this to the camera, in board units, are not drawn
+const float frustumNear = 0.01f;
+
+// The current pose and intrinsics, unpacked once per frame for cheap per-object tests
+struct ViewFrustum
+{
+    double R[9];
+    double t[3];
+    double fx, fy, cx, cy;
+    int width, height;
+};
+
+struct BoundingSphere
+{
+    cv::Point3f center;
+    float radius;
+};
+
+int makeFrustum(ViewFrustum &frustum, cv::Mat &camera_matrix, cv::Mat &rot, cv::Mat &trans, cv::Size imageSize);
+
+cv::Point3d toCamera(const ViewFrustum &frustum, const cv::Point3f &p);
+
+bool sphereVisible(const ViewFrustum &frustum, const BoundingSphere &sphere, float &screenRadius, bool &crossesNear);
+
+int markInFront(const ViewFrustum &frustum, const std::vector<cv::Vec3f> &points, std::vector<uchar> &inFront);
+
+int levelOfDetail(float screenRadius, int minSegments, int maxSegments);
+
+#endif
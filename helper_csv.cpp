@@ -136,6 +136,7 @@ This function is designed to parse a file in CSV format,
 where the first column contains strings and the remaining columns contain floating point numbers. 
 The function returns a std::vector of character arrays containing the filenames, 
 and a 2D std::vector of floats containing the features calculated from each image.
+Each filename is allocated with new[] and belongs to the caller, who must delete[] it.
 
 If echo_file is set to true, 
 the function will print the file contents as they are read into memory. 
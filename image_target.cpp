@@ -0,0 +1,366 @@
+/*
+Puja Chaudhury
+image_target.cpp
+Function implementations for tracking a printed picture with ORB features, optical flow and a homography.
+*/
+
+#include <algorithm>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "image_target.h"
+#include "resolution.h"
+#include "target_index.h"
+
+/*
+This function loads a picture as a target and computes its features once. The picture is scaled down so its longer
+side is at most maxSide pixels, which is about the size it appears at in a frame, and it spans width board units across.
+ */
+int loadImageTarget(std::string filename, ImageTarget &target, float width, int features, int maxSide)
+{
+    cv::Mat image = cv::imread(filename, cv::IMREAD_GRAYSCALE);
+    if (image.empty())
+    {
+        printf("Unable to read the image target %s\n", filename.c_str());
+        return (-1);
+    }
+
+    int longSide = std::max(image.cols, image.rows);
+    if (longSide > maxSide)
+    {
+        double scale = (double)maxSide / longSide;
+        cv::resize(image, image, cv::Size(), scale, scale, cv::INTER_AREA);
+    }
+
+    cv::Ptr<cv::ORB> orb = cv::ORB::create(features);
+    orb->detectAndCompute(image, cv::noArray(), target.keypoints, target.descriptors);
+    if ((int)target.keypoints.size() < 20)
+    {
+        printf("The image target %s has too little texture to track (%d features)\n", filename.c_str(), (int)target.keypoints.size());
+        return (-1);
+    }
+
+    target.name = filename;
+    target.size = image.size();
+    target.unitsPerPixel = width / image.cols;
+
+    return (0);
+}
+
+/*
+This function returns the board coordinates of a pixel of the target picture.
+ */
+cv::Vec3f imageTargetPoint(const ImageTarget &target, cv::Point2f pixel)
+{
+    return cv::Vec3f(pixel.x * target.unitsPerPixel, -pixel.y * target.unitsPerPixel, 0);
+}
+
+ImageTracker::ImageTracker(int features)
+    : minInliers(15),
+      minTracked(40),
+      matchRatio(0.75f),
+      ransacThreshold(3.0),
+      targetIndex(-1),
+      maxCandidates(3),
+      orb(cv::ORB::create(features)),
+      matcher(cv::BFMatcher::create(cv::NORM_HAMMING)),
+      index(NULL),
+      frames(0),
+      followedFrames(0),
+      matchedFrames(0),
+      candidatesChecked(0),
+      poses(0),
+      detectMs(0)
+{
+}
+
+int ImageTracker::setTarget(const ImageTarget &target)
+{
+    this->target = target;
+    reset();
+    return (0);
+}
+
+/*
+This function makes the tracker recognise whichever target of an opened index is in view, instead of a single picture.
+The index must stay open while the tracker uses it.
+ */
+int ImageTracker::setIndex(TargetIndex *index)
+{
+    this->index = index;
+    targetIndex = -1;
+    reset();
+    return (index != NULL && index->isOpen() ? 0 : -1);
+}
+
+/*
+This function forgets the followed features, so the next frame is matched against the picture.
+ */
+void ImageTracker::reset()
+{
+    trackedReference.clear();
+    trackedFrame.clear();
+    previous.release();
+}
+
+/*
+This function fits a RANSAC homography from picture to frame points and keeps only its inliers in both lists.
+ */
+bool ImageTracker::fitHomography(std::vector<cv::Point2f> &reference, std::vector<cv::Point2f> &frame)
+{
+    if ((int)reference.size() < minInliers)
+    {
+        return (false);
+    }
+
+    std::vector<uchar> inliers;
+    cv::Mat h = cv::findHomography(reference, frame, cv::RANSAC, ransacThreshold, inliers);
+    if (h.empty())
+    {
+        return (false);
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < reference.size(); i++)
+    {
+        if (inliers[i])
+        {
+            reference[kept] = reference[i];
+            frame[kept] = frame[i];
+            kept++;
+        }
+    }
+    reference.resize(kept);
+    frame.resize(kept);
+    if ((int)kept < minInliers)
+    {
+        return (false);
+    }
+
+    homography = h;
+    return (true);
+}
+
+/*
+This function follows the features of the previous frame into this one with pyramidal Lucas-Kanade flow.
+Features the flow loses, or that no longer agree with the picture's homography, are dropped.
+ */
+bool ImageTracker::follow()
+{
+    if (trackedFrame.empty() || previous.size() != small.size())
+    {
+        return (false);
+    }
+
+    std::vector<cv::Point2f> next;
+    std::vector<uchar> status;
+    std::vector<float> error;
+    cv::calcOpticalFlowPyrLK(previous, small, trackedFrame, next, status, error, cv::Size(21, 21), 3);
+
+    std::vector<cv::Point2f> reference, frame;
+    for (size_t i = 0; i < next.size(); i++)
+    {
+        if (status[i])
+        {
+            reference.push_back(trackedReference[i]);
+            frame.push_back(next[i]);
+        }
+    }
+
+    if (!fitHomography(reference, frame))
+    {
+        return (false);
+    }
+    trackedReference.swap(reference);
+    trackedFrame.swap(frame);
+    return (true);
+}
+
+/*
+This function finds ORB features in the whole frame and matches them to the picture's, keeping matches that pass
+the ratio test and the homography check.
+ */
+bool ImageTracker::match()
+{
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat descriptors;
+    orb->detectAndCompute(small, cv::noArray(), keypoints, descriptors);
+    if (descriptors.empty())
+    {
+        return (false);
+    }
+    if (index != NULL)
+    {
+        return (matchIndex(keypoints, descriptors));
+    }
+
+    std::vector<std::vector<cv::DMatch>> matches;
+    matcher->knnMatch(descriptors, target.descriptors, matches, 2);
+
+    std::vector<cv::Point2f> reference, frame;
+    for (size_t i = 0; i < matches.size(); i++)
+    {
+        if (matches[i].size() == 2 && matches[i][0].distance < matchRatio * matches[i][1].distance)
+        {
+            reference.push_back(target.keypoints[matches[i][0].trainIdx].pt);
+            frame.push_back(keypoints[matches[i][0].queryIdx].pt);
+        }
+    }
+
+    if (!fitHomography(reference, frame))
+    {
+        return (false);
+    }
+    trackedReference.swap(reference);
+    trackedFrame.swap(frame);
+    return (true);
+}
+
+/*
+This function retrieves the targets of the index the frame's features vote for and checks them, best voted first,
+with a homography on the matches that voted. The first that passes becomes the target being followed.
+ */
+bool ImageTracker::matchIndex(std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors)
+{
+    std::vector<TargetCandidate> candidates;
+    index->query(descriptors, candidates, maxCandidates);
+
+    for (size_t c = 0; c < candidates.size(); c++)
+    {
+        candidatesChecked++;
+        std::vector<cv::Point2f> reference, frame;
+        for (size_t i = 0; i < candidates[c].matches.size(); i++)
+        {
+            const cv::DMatch &m = candidates[c].matches[i];
+            reference.push_back(index->point(candidates[c].target, m.trainIdx));
+            frame.push_back(keypoints[m.queryIdx].pt);
+        }
+        if (!fitHomography(reference, frame))
+        {
+            continue;
+        }
+
+        if (candidates[c].target != targetIndex)
+        {
+            targetIndex = candidates[c].target;
+            index->target(targetIndex, target);
+            printf("Recognised %s\n", target.name.c_str());
+        }
+        trackedReference.swap(reference);
+        trackedFrame.swap(frame);
+        return (true);
+    }
+
+    return (false);
+}
+
+/*
+This function looks for the picture in a BGR or grayscale frame, at the processing size, and copies the frame to dst.
+A grayscale frame, such as the luma plane of a YUV source, is read as it is; when dst already holds a BGR frame of the
+same size, such as the converted colour frame, it is drawn on as it is instead of being replaced with the grey one.
+The features of the previous frame are followed first; the frame is matched against the picture only when they are
+lost or too few remain. The points are the board coordinates of the features in view and the corners where they are
+in frame pixels, ready for estimatePose().
+ */
+bool ImageTracker::detect(const cv::Mat &src, cv::Mat &dst, cv::Size processing, std::vector<cv::Vec3f> &points, std::vector<cv::Point2f> &corners, bool drawFeatures)
+{
+    double start = (double)cv::getTickCount();
+
+    if (src.channels() == 3)
+    {
+        cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
+        src.copyTo(dst);
+    }
+    else
+    {
+        gray = src;
+        if (dst.size() != src.size() || dst.type() != CV_8UC3)
+        {
+            cv::cvtColor(src, dst, cv::COLOR_GRAY2BGR);
+        }
+    }
+    resizeForProcessing(gray, processing.area() > 0 ? processing : gray.size(), small);
+
+    bool found = follow();
+    if (found)
+    {
+        followedFrames++;
+    }
+    if (!found || (int)trackedFrame.size() < minTracked)
+    {
+        // a fresh match replaces features that are thinning out, but a failed one does not discard them
+        if (match())
+        {
+            found = true;
+            matchedFrames++;
+        }
+    }
+    if (!found)
+    {
+        trackedReference.clear();
+        trackedFrame.clear();
+    }
+    small.copyTo(previous);
+
+    points.clear();
+    corners.clear();
+    outline.clear();
+    if (found)
+    {
+        corners = trackedFrame;
+        scalePoints(corners, small.size(), gray.size());
+        for (size_t i = 0; i < trackedReference.size(); i++)
+        {
+            points.push_back(imageTargetPoint(target, trackedReference[i]));
+        }
+
+        std::vector<cv::Point2f> edges = {cv::Point2f(0, 0), cv::Point2f((float)target.size.width, 0),
+                                          cv::Point2f((float)target.size.width, (float)target.size.height), cv::Point2f(0, (float)target.size.height)};
+        cv::perspectiveTransform(edges, outline, homography);
+        scalePoints(outline, small.size(), gray.size());
+
+        if (drawFeatures)
+        {
+            for (size_t i = 0; i < corners.size(); i++)
+            {
+                cv::circle(dst, corners[i], 3, cv::Scalar(0, 255, 0), 1);
+            }
+            std::vector<cv::Point> polygon(outline.begin(), outline.end());
+            cv::polylines(dst, polygon, true, cv::Scalar(255, 0, 255), 2);
+        }
+    }
+
+    frames++;
+    detectMs += ((double)cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+    return (found);
+}
+
+/*
+This function recovers the camera pose from the features detect() returned. All of them lie on the picture's plane,
+so the planar IPPE solver is used.
+ */
+int ImageTracker::estimatePose(std::vector<cv::Vec3f> &points, std::vector<cv::Point2f> &corners, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans)
+{
+    if (points.size() < 4 || points.size() != corners.size())
+    {
+        return (-1);
+    }
+    cv::solvePnP(points, corners, camera_matrix, dist_coeff, rot, trans, false, cv::SOLVEPNP_IPPE);
+    poses++;
+    return (0);
+}
+
+void ImageTracker::printStats()
+{
+    if (frames == 0)
+    {
+        return;
+    }
+    printf("Image target %s: followed in %d/%d frames, matched in %d (%.1f%%), %d poses, %.2f ms per frame\n",
+           target.name.c_str(), followedFrames, frames, matchedFrames, 100.0 * matchedFrames / frames, poses, detectMs / frames);
+    if (index != NULL)
+    {
+        printf("Target index: %d targets, %d candidates checked\n", index->numTargets(), candidatesChecked);
+    }
+}
@@ -0,0 +1,103 @@
+/*
+Puja Chaudhury
+image_target.h
+Markerless tracking of a printed picture. The picture's ORB features are computed once when it is loaded. Each
+frame, the features found on the previous frame are followed with pyramidal optical flow and checked with a RANSAC
+homography. Only when too few of them survive is the frame matched against the picture's descriptors again, with a
+brute-force Hamming matcher, or looked up in a TargetIndex when any picture of a catalogue may be in view.
+The pose comes from planar PnP on the homography's inliers.
+*/
+
+#ifndef image_target_hpp
+#define image_target_hpp
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/features2d.hpp>
+#include <opencv2/video/tracking.hpp>
+
+class TargetIndex;
+
+// A picture to track: its features and where they lie on the board plane
+struct ImageTarget
+{
+    std::string name;
+    cv::Size size; // of the grayscale picture the features were computed on
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat descriptors;
+
+    // board units per picture pixel; x runs along the picture's top edge and y down it, negative, like the chessboard
+    float unitsPerPixel;
+};
+
+int loadImageTarget(std::string filename, ImageTarget &target, float width = 8, int features = 1000, int maxSide = 640);
+
+cv::Vec3f imageTargetPoint(const ImageTarget &target, cv::Point2f pixel);
+
+class ImageTracker
+{
+public:
+    ImageTracker(int features = 1000);
+
+    int setTarget(const ImageTarget &target);
+    int setIndex(TargetIndex *index);
+    bool detect(const cv::Mat &src, cv::Mat &dst, cv::Size processing, std::vector<cv::Vec3f> &points, std::vector<cv::Point2f> &corners, bool drawFeatures);
+    int estimatePose(std::vector<cv::Vec3f> &points, std::vector<cv::Point2f> &corners, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans);
+    void reset();
+    void printStats();
+
+    // outline of the picture in the frame, valid while detect() returns true
+    std::vector<cv::Point2f> outline;
+
+    // homography inliers needed to accept the picture
+    int minInliers;
+
+    // below this many followed features the frame is matched against the picture again
+    int minTracked;
+
+    // Lowe's ratio between the best and second-best match
+    float matchRatio;
+
+    // RANSAC reprojection threshold in processing pixels
+    double ransacThreshold;
+
+    ImageTarget target;
+
+    // with an index, a lost target is looked for among every target in it; -1 until one has been recognised
+    int targetIndex;
+
+    // candidates from the index that are checked with a homography before giving up on a frame
+    int maxCandidates;
+
+private:
+    bool follow();
+    bool match();
+    bool matchIndex(std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors);
+    bool fitHomography(std::vector<cv::Point2f> &reference, std::vector<cv::Point2f> &frame);
+
+    cv::Ptr<cv::ORB> orb;
+    cv::Ptr<cv::DescriptorMatcher> matcher;
+    TargetIndex *index;
+
+    cv::Mat gray;
+    cv::Mat small;
+    cv::Mat previous;
+
+    // features being followed: where they are on the picture and where they were in the previous frame, processing pixels
+    std::vector<cv::Point2f> trackedReference;
+    std::vector<cv::Point2f> trackedFrame;
+    cv::Mat homography;
+
+    int frames;
+    int followedFrames;
+    int matchedFrames;
+    int candidatesChecked;
+    int poses;
+    double detectMs;
+};
+
+#endif
@@ -5,6 +5,7 @@ This is a CPP function that analyzes a video stream by detecting feature points
 */
 
 #include <iostream>
+#include <string>
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
@@ -13,34 +14,63 @@ This is a CPP function that analyzes a video stream by detecting feature points
 
 #include "calibration.h"
 #include "3D_projection.h"
+#include "alloc_tracker.h"
+#include "marker_tracking.h"
+#include "buffer_pool.h"
+#include "frame_loop.h"
+#include "image_target.h"
+#include "multi_board.h"
+#include "overlay_layer.h"
+#include "quality_controller.h"
+#include "target_index.h"
+#include "trace.h"
+#include "yuv_source.h"
 
 int main(int argc, char *argv[])
 {
-    cv::VideoCapture *cap;
+    // The options every program shares, such as --model, --video, --publish and --trace, are described in frame_loop.h
+    // Several chessboards in view are detected and followed at once with --boards <n>, up to n of them
+    // A printed picture can be tracked instead of a board with --image-target <file>; 'i' switches to it
+    // Any picture of a catalogue indexed by build_target_index is recognised with --target-index <file>
+    // With --frame-budget <ms> detection and drawing quality are lowered while frames take longer, and raised again when they are fast
+    int maxBoards = 1;
+    std::string imageTargetFilename;
+    std::string targetIndexFilename;
+    double frameBudget = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--boards" && i + 1 < argc)
+        {
+            maxBoards = std::stoi(argv[++i]);
+        }
+        if (std::string(argv[i]) == "--image-target" && i + 1 < argc)
+        {
+            imageTargetFilename = argv[++i];
+        }
+        if (std::string(argv[i]) == "--target-index" && i + 1 < argc)
+        {
+            targetIndexFilename = argv[++i];
+        }
+        if (std::string(argv[i]) == "--frame-budget" && i + 1 < argc)
+        {
+            frameBudget = std::stod(argv[++i]);
+        }
+    }
 
-    // Initialize video capture object
-    cap = new cv::VideoCapture(0);
-    if (!cap->isOpened())
+    // Capture, display, recording, snapshots and the shared memory and pose outputs
+    FrameLoop loop;
+    if (loop.open(argc, argv) != 0)
     {
-        printf("Failed to open video device");
         return (-1);
     }
+    MeshPlacement modelPlacement;
+    if (!loop.model.empty())
+    {
+        modelPlacement = fitToBoard(loop.model.view(cv::Vec3b(200, 200, 200)), cv::Point3f(4, -2.5, 0), 4);
+    }
+    cv::Mat &videoFrame = loop.videoFrame;
 
-    // Set video capture properties
-    cap->set(cv::CAP_PROP_FRAME_WIDTH, 960);
-    cap->set(cv::CAP_PROP_FRAME_HEIGHT, 540);
-    cv::Size refS((int)cap->get(cv::CAP_PROP_FRAME_WIDTH),
-                  (int)cap->get(cv::CAP_PROP_FRAME_HEIGHT));
-    printf("Expected size: %d %d\n", refS.width, refS.height);
-
-    // Create a window to display the video
-    cv::namedWindow("Video", 1); // identifies a window
-
-    // Create a cv::Mat object to hold the current video videoFrame
-    cv::Mat videoFrame;
-
-    // Initialize variables for videoFrame numbers
-    int frameNumber = 1;
+    // Initialize the number of calibration frames
     int savedFrameNumber = 1;
 
     // Create a cv::Mat object to hold the output videoFrame
@@ -52,7 +82,7 @@ int main(int argc, char *argv[])
     std::vector<std::vector<cv::Point2f>> corners_list;
 
     // Create an array for the camera matrix
-    double camMat[] = {1, 0, (double)videoFrame.cols / 2, 0, 1, (double)videoFrame.rows / 2, 0, 0, 1};
+    double camMat[] = {1, 0, (double)loop.captureSize.width / 2, 0, 1, (double)loop.captureSize.height / 2, 0, 0, 1};
 
     // Create a cv::Mat object to hold the camera matrix
     cv::Mat cameraMat(cv::Size(3, 3), CV_64FC1, &camMat);
@@ -67,65 +97,268 @@ int main(int argc, char *argv[])
     bool showAxes = false;
     bool showObject = false;
 
+    // Draw virtual objects as shaded solids instead of wireframes
+    bool solidObjects = false;
+
     // Initialize variable for robust feature detection
     bool isRobust = false;
 
-    while (true)
+    // Initialize the ChArUco tracker used instead of the chessboard in marker mode
+    MarkerTracker markerTracker;
+    bool markerMode = false;
+
+    // Initialize the markerless tracker for a printed picture, used instead of the chessboard in image mode
+    TargetIndex targetIndex;
+    ImageTracker imageTracker;
+    bool imageMode = false;
+    bool imageTargetLoaded = false;
+    if (!targetIndexFilename.empty())
     {
-        *cap >> videoFrame; // get a new videoFrame from the camera, treat as a stream
-        if (videoFrame.empty())
+        if (targetIndex.open(targetIndexFilename) != 0)
         {
-            printf("EmptyFrameError\n");
-            break;
+            return (-1);
         }
+        imageTracker.setIndex(&targetIndex);
+        imageTargetLoaded = true;
+        printf("Recognising the %d targets in %s\n", targetIndex.numTargets(), targetIndexFilename.c_str());
+    }
+    else if (!imageTargetFilename.empty())
+    {
+        ImageTarget imageTarget;
+        if (loadImageTarget(imageTargetFilename, imageTarget) != 0)
+        {
+            return (-1);
+        }
+        imageTracker.setTarget(imageTarget);
+        imageTargetLoaded = true;
+        printf("Loaded image target %s with %d features\n", imageTargetFilename.c_str(), (int)imageTarget.keypoints.size());
+    }
+
+    // Detection statistics for the chessboard, to compare against the marker tracker
+    int chessboardFrames = 0;
+    int chessboardPoses = 0;
+    double chessboardMs = 0;
+
+    // Axes and wireframe objects of a frame are collected here and drawn in one pass
+    OverlayDrawList overlay;
+
+    // What the overlay drew is kept and blended onto the following frames until the pose moves
+    OverlayLayer overlayLayer;
+
+    // Quality settings follow the frame time when --frame-budget is given
+    QualityController qualityController(frameBudget);
+    if (qualityController.enabled())
+    {
+        printf("Holding a frame budget of %.1f ms\n", frameBudget);
+    }
+
+    // With --boards every chessboard in view is detected, given an id and posed; each has a draw list of its own
+    MultiBoardDetector boards(makeTargetDetector<ChessboardTarget>("chessboard", "chessboard_intrinsics.csv"), maxBoards);
+    std::vector<OverlayDrawList> boardOverlays;
+    bool multiBoard = maxBoards > 1;
+
+    // every stage of the loop below tells the allocation tracker where it is; that costs nothing while it is off.
+    // Each pass reads the newest frame from the camera, treated as a stream, already converted to BGR for drawing and display
+    while (loop.read())
+    {
+        traceBegin("detect");
+        allocStage(ALLOC_DETECT);
+        double frameStart = (double)cv::getTickCount();
+        int format = loop.format;
+        cv::Size detectionSize = loop.detectionSize;
 
         std::vector<cv::Point2f> corners;
         std::vector<cv::Vec3f> points;
 
-        // Task 1 - Detect and Extract Chessboard Corners
-        bool found = GetChessboardCorners(videoFrame, outputFrame, corners, cornersDrawn);
-        if (showAxes && found)
+        bool found;
+        bool chessboardMode = !markerMode && !imageMode;
+        if (imageMode)
         {
-            specifyCalibration(corners, corners_list, points, points_list);
-
-            // Task 4 - Calculate Current Position of the Camera
-            calculateCameraPosition(points, corners, cameraMat, distCoeff, rot, trans);
-            std::cout << std::endl
-                      << "rotation matrix: " << rot << std::endl;
-            std::cout << std::endl
-                      << "translation matrix: " << trans << std::endl;
-
-            // Task 5 - Project Outside Corners or 3D Axes
-            draw3dAxes(outputFrame, cameraMat, distCoeff, rot, trans);
+            // Follow the picture's features from the last frame, or match them again when too few are left;
+            // a YUV frame is tracked on its luma and the features are drawn on the converted colour frame
+            if (format == PIXEL_BGR)
+            {
+                found = imageTracker.detect(videoFrame, outputFrame, detectionSize, points, corners, cornersDrawn);
+            }
+            else
+            {
+                videoFrame.copyTo(outputFrame);
+                found = imageTracker.detect(loop.luma(), outputFrame, detectionSize, points, corners, cornersDrawn);
+            }
+        }
+        else if (markerMode)
+        {
+            // Detect whichever ChArUco markers are visible and match them to board coordinates, on the luma of a YUV frame
+            if (format == PIXEL_BGR)
+            {
+                found = markerTracker.detect(videoFrame, outputFrame, points, corners, cornersDrawn);
+            }
+            else
+            {
+                videoFrame.copyTo(outputFrame);
+                found = markerTracker.detect(loop.luma(), outputFrame, points, corners, cornersDrawn);
+            }
+        }
+        else
+        {
+            // Task 1 - Detect and Extract Chessboard Corners
+            double start = (double)cv::getTickCount();
+            if (multiBoard)
+            {
+                boards.detect(format == PIXEL_BGR ? videoFrame : loop.luma(), detectionSize);
+                videoFrame.copyTo(outputFrame);
+
+                // the first board found stands in for the single board when saving calibration images
+                found = false;
+                for (size_t i = 0; i < boards.instances.size() && boards.instances[i].missed == 0; i++)
+                {
+                    if (cornersDrawn)
+                    {
+                        cv::drawChessboardCorners(outputFrame, ChessboardTarget::patternSize(), boards.instances[i].corners, true);
+                    }
+                    if (!found)
+                    {
+                        corners = boards.instances[i].corners;
+                        found = true;
+                    }
+                }
+            }
+            else if (format == PIXEL_BGR)
+            {
+                found = GetChessboardCorners(videoFrame, outputFrame, corners, cornersDrawn, detectionSize);
+            }
+            else
+            {
+                cv::Mat &luma = loop.luma();
+                found = GetChessboardCorners(luma, luma, corners, false, detectionSize);
+                videoFrame.copyTo(outputFrame);
+                if (cornersDrawn)
+                {
+                    cv::drawChessboardCorners(outputFrame, ChessboardTarget::patternSize(), corners, found);
+                }
+            }
+            chessboardMs += ((double)cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+            chessboardFrames++;
+            chessboardPoses += found ? 1 : 0;
         }
 
-        // Display virtual object
-        if (showObject && found)
+        traceEnd("detect");
+        allocStage(ALLOC_POSE);
+        double detectEnd = (double)cv::getTickCount();
+        bool posed = (showAxes || showObject) && found;
+        if (posed)
         {
-            specifyCalibration(corners, corners_list, points, points_list);
+            traceBegin("pnp");
+            // only the board points are needed here; calibration views are collected when 's' is pressed
+            if (chessboardMode)
+            {
+                ChessboardTarget::objectPoints(points);
+            }
 
-            // Task 4 - Calculate Current Position of the Camera
-            calculateCameraPosition(points, corners, cameraMat, distCoeff, rot, trans);
+            // Task 4 - Calculate Current Position of the Camera; with several boards the first one's pose is printed and published
+            if (imageMode)
+            {
+                imageTracker.estimatePose(points, corners, cameraMat, distCoeff, rot, trans);
+            }
+            else if (multiBoard && chessboardMode)
+            {
+                boards.estimatePoses(cameraMat, distCoeff);
+                rot = boards.instances[0].rot;
+                trans = boards.instances[0].trans;
+            }
+            else
+            {
+                calculateCameraPosition(points, corners, cameraMat, distCoeff, rot, trans);
+            }
             std::cout << std::endl
                       << "rotation matrix: " << rot << std::endl;
             std::cout << std::endl
                       << "translation matrix: " << trans << std::endl;
 
-            // Task 6 - Create a virtual object
-            draw3dObject(outputFrame, cameraMat, distCoeff, rot, trans);
+            traceEnd("pnp");
+            traceBegin("render");
+            allocStage(ALLOC_RENDER);
+
+            // every board changes its pose independently, so they are drawn straight onto the frame rather than cached
+            if (multiBoard && chessboardMode)
+            {
+                drawBoardInstances(outputFrame, boards.instances, boardOverlays, cameraMat, distCoeff, showAxes, showObject, solidObjects, chessboardScene());
+                traceEnd("render");
+            }
+            else
+            {
+                // the axes and objects are drawn into the cached layer only when the pose or what is shown has changed
+                int scene = (showAxes ? 1 : 0) | (showObject ? 2 : 0) | (solidObjects ? 4 : 0);
+                if (overlayLayer.needsRender(cameraMat, distCoeff, rot, trans, outputFrame.size(), scene))
+                {
+                    cv::Mat &canvas = overlayLayer.beginRender();
+                    overlay.begin(canvas);
+
+                    // Task 5 - Project Outside Corners or 3D Axes
+                    if (showAxes)
+                    {
+                        draw3dAxes(overlay, cameraMat, distCoeff, rot, trans);
+                    }
+
+                    // Task 6 - Create a virtual object
+                    if (showObject)
+                    {
+                        if (!loop.model.empty())
+                        {
+                            drawModel(canvas, loop.model.view(cv::Vec3b(200, 200, 200)), modelPlacement, cameraMat, distCoeff, rot, trans);
+                        }
+                        else if (solidObjects)
+                        {
+                            drawSolidObject(canvas, cameraMat, distCoeff, rot, trans);
+                        }
+                        else
+                        {
+                            draw3dObject(overlay, cameraMat, distCoeff, rot, trans);
+                        }
+                    }
+
+                    overlay.end();
+                    overlayLayer.endRender();
+                }
+                traceEnd("render");
+                traceBegin("composite");
+                allocStage(ALLOC_COMPOSITE);
+                overlayLayer.composite(outputFrame);
+                traceEnd("composite");
+            }
         }
 
+        allocStage(ALLOC_OUTPUT);
+        double renderEnd = (double)cv::getTickCount();
+
+        // the pose goes out before the frame is shown, so subscribers are not held up by the display
+        loop.publishPose(points, corners, cameraMat, distCoeff, rot, trans, imageMode ? POSE_TARGET_IMAGE : (markerMode ? POSE_TARGET_CHARUCO : POSE_TARGET_CHESSBOARD), posed);
+
         if (isRobust)
         {
             // Task 7 - detect Robust features
             detectHarrisCorners(videoFrame, outputFrame);
         }
 
-        // display the current videoFrame
-        cv::imshow("Video", outputFrame);
+        // display the current videoFrame, and record and publish it
+        loop.show(outputFrame, rot, trans, posed);
 
-        // see if there is a waiting keystroke
-        char key = cv::waitKey(10);
+        // the controller judges the work of the frame, not the wait for a key
+        double tickMs = 1000.0 / cv::getTickFrequency();
+        int qualityChanged = qualityController.update((detectEnd - frameStart) * tickMs, (renderEnd - detectEnd) * tickMs, ((double)cv::getTickCount() - frameStart) * tickMs);
+        if (qualityChanged & 1)
+        {
+            loop.updateDetectionSize();
+        }
+        if (qualityChanged & 2)
+        {
+            overlayLayer.renderInterval = qualitySettings().overlayInterval;
+            overlayLayer.invalidate();
+        }
+
+        // see if there is a waiting keystroke; 'v' records the output to a video file and 'k' saves a snapshot of it
+        char key = loop.waitKey();
+        loop.handleKey(key, outputFrame);
 
         // press 'q' to quit
         if (key == 'q')
@@ -133,15 +366,15 @@ int main(int argc, char *argv[])
             break;
         }
         // press 's' to save current calibration videoFrame and perform calibration if frames >= 5
-        else if (key == 's' && found && !showAxes && !showObject && cornersDrawn)
+        else if (key == 's' && found && chessboardMode && !showAxes && !showObject && cornersDrawn)
         {
             // Task 2 - Select calibration images
-            specifyCalibration(corners, corners_list, points, points_list);
+            specifyCalibration<ChessboardTarget>(corners, corners_list, points, points_list);
 
             printf("Calibration image is saved...\n");
             std::string fname = "calibrated-videoFrame-";
             fname += std::to_string(savedFrameNumber) + ".jpg";
-            imwrite(fname, outputFrame);
+            loop.writer.saveImage(fname, outputFrame);
 
             // print the corner points in world coordinates with corresponding image coordinates
             std::cout << "---------------------------------------------------------------------------" << std::endl;
@@ -164,7 +397,7 @@ int main(int argc, char *argv[])
                 std::cout << "Camera matrix before calibration:" << std::endl;
                 std::cout << cameraMat << std::endl;
 
-                float reprojErr = computeCameraParameters(points_list, corners_list, cameraMat, distCoeff);
+                float reprojErr = computeCameraParameters(points_list, corners_list, videoFrame.size(), cameraMat, distCoeff);
 
                 // print the calibration stats for the user
                 std::cout << "Calibrated camera matrix:" << std::endl;
@@ -181,7 +414,7 @@ int main(int argc, char *argv[])
             // saving current calibration in a csv file
             std::cout << std::endl
                       << "Saving current calibration data." << std::endl;
-            storeCalibrationData(cameraMat, distCoeff);
+            storeCalibrationData(cameraMat, distCoeff, videoFrame.size());
         }
         // Press 'x' to toggle display of 3D axes at the origin of world coordinates
         else if (key == 'x' && found)
@@ -198,7 +431,7 @@ int main(int argc, char *argv[])
 
             // Read calibration data from "intrinsic_data_chessboard.csv" file and print the camera matrix and distortion coefficients
             std::string fileName = "chessboard_intrinsics.csv";
-            loadCalibration(fileName, cameraMat, distCoeff);
+            loadCalibration(fileName, cameraMat, distCoeff, videoFrame.size());
             std::cout << std::endl
                       << "retrieved calibrated camera matrix:" << std::endl;
             std::cout << cameraMat << std::endl;
@@ -216,7 +449,7 @@ int main(int argc, char *argv[])
 
             // Load the calibration data to display the virtual object.
             std::string fileName = "chessboard_intrinsics.csv";
-            loadCalibration(fileName, cameraMat, distCoeff);
+            loadCalibration(fileName, cameraMat, distCoeff, videoFrame.size());
             std::cout << std::endl
                       << "Calibrated camera matrix is retrieved:" << std::endl;
             std::cout << cameraMat << std::endl;
@@ -231,18 +464,55 @@ int main(int argc, char *argv[])
             showObject = false;
             isRobust = !isRobust;
         }
-        // Press the 'k' key to capture a snapshot of the current video videoFrame.
-        else if (key == 'k')
+        // Press the 'm' key to switch between the chessboard and the ChArUco marker board
+        else if (key == 'm')
+        {
+            markerMode = !markerMode;
+            imageMode = false;
+            if (markerMode)
+            {
+                // Write the board alongside the snapshots so it can be printed
+                markerTracker.saveBoardImage("charuco_board.png", cv::Size(1000, 1400));
+                printf("Tracking the ChArUco board (printable copy saved to charuco_board.png)\n");
+            }
+            else
+            {
+                printf("Tracking the chessboard\n");
+            }
+        }
+        // Press the 'i' key to switch between the chessboard and the picture given with --image-target
+        else if (key == 'i' && imageTargetLoaded)
         {
-            printf("Saving the Images\n");
-            std::string fname = "videoFrame-";
-            fname += std::to_string(frameNumber) + ".jpg";
-            imwrite(fname, outputFrame);
-            frameNumber++;
+            imageMode = !imageMode;
+            markerMode = false;
+            imageTracker.reset();
+            printf(imageMode ? "Tracking the image target\n" : "Tracking the chessboard\n");
+        }
+        // Press the 'f' key to switch virtual objects between wireframe and solid rendering
+        else if (key == 'f')
+        {
+            solidObjects = !solidObjects;
         }
     }
 
-    delete cap;
+    if (chessboardFrames > 0)
+    {
+        printf("Chessboard tracking: %d/%d frames with pose (%.1f%%), %.2f ms per frame, %.2f ms per pose\n",
+               chessboardPoses, chessboardFrames, 100.0 * chessboardPoses / chessboardFrames, chessboardMs / chessboardFrames,
+               chessboardPoses > 0 ? chessboardMs / chessboardPoses : 0.0);
+    }
+    markerTracker.printStats();
+    imageTracker.printStats();
+    if (multiBoard)
+    {
+        boards.printStats();
+    }
+
+    overlayLayer.printStats();
+    qualityController.printStats();
+
+    // stop capturing, finish writing queued snapshots and close any recording, then write the trace
+    loop.close();
 
     return (0);
 }
@@ -0,0 +1,253 @@
+/*
+Puja Chaudhury
+marker_tracking.cpp
+Function implementations for detecting a ChArUco board tile by tile and matching whatever markers are visible to board coordinates.
+*/
+
+#include <algorithm>
+#include <map>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include "marker_tracking.h"
+#include "buffer_pool.h"
+
+/*
+Board object points from OpenCV have y growing down the board. They are mirrored here so the marker board uses
+the same frame as the chessboard target (x along the first row, y negative down the board, z towards the camera)
+and the existing axes and virtual objects land on it unchanged.
+ */
+static cv::Vec3f toBoardFrame(const cv::Point3f &p)
+{
+    return cv::Vec3f(p.x, -p.y, p.z);
+}
+
+MarkerTracker::MarkerTracker(cv::Size squares, float markerRatio, cv::aruco::PredefinedDictionaryType dictionary, cv::Size tiles)
+    : overlap(0.25f),
+      fullFrameScale(0.5f),
+      interpolateCorners(true),
+      board(squares, 1.0f, markerRatio, cv::aruco::getPredefinedDictionary(dictionary)),
+      detector(cv::aruco::getPredefinedDictionary(dictionary)),
+      charucoDetector(board),
+      tiles(tiles),
+      frames(0),
+      poses(0),
+      detectMs(0)
+{
+}
+
+/*
+This function splits the grayscale frame into overlapping tiles and runs the marker detector on every tile in parallel.
+Alongside the tiles, the whole frame is searched once at fullFrameScale, so a marker larger than the overlap that lies
+across a seam, and so is whole in no tile, is still found; small markers that would vanish at that scale are left to the
+full resolution tiles. Corners are shifted back to frame coordinates and a marker seen more than once is kept once:
+from the tile that saw it largest, or from the downscaled pass only when no tile saw it.
+ */
+int MarkerTracker::detectTiles(const cv::Mat &gray, std::vector<std::vector<cv::Point2f>> &markerCorners, std::vector<int> &markerIds)
+{
+    int tileW = (gray.cols + tiles.width - 1) / tiles.width;
+    int tileH = (gray.rows + tiles.height - 1) / tiles.height;
+    int padX = (int)(overlap * tileW / 2);
+    int padY = (int)(overlap * tileH / 2);
+    int numTiles = tiles.area();
+    bool fullFrame = numTiles > 1 && fullFrameScale > 0 && fullFrameScale < 1;
+    int numPasses = numTiles + (fullFrame ? 1 : 0);
+
+    // the last pass, when there is one, is the downscaled whole frame
+    std::vector<std::vector<std::vector<cv::Point2f>>> tileCorners(numPasses);
+    std::vector<std::vector<int>> tileIds(numPasses);
+
+    cv::parallel_for_(cv::Range(0, numPasses), [&](const cv::Range &range)
+                      {
+        for (int t = range.start; t < range.end; t++)
+        {
+            if (t == numTiles)
+            {
+                cv::Size scaled(std::max(1, cvRound(gray.cols * fullFrameScale)), std::max(1, cvRound(gray.rows * fullFrameScale)));
+                PooledMat small(scaled, CV_8UC1);
+                cv::resize(gray, small.mat, scaled, 0, 0, cv::INTER_AREA);
+                detector.detectMarkers(small.mat, tileCorners[t], tileIds[t]);
+
+                float sx = (float)gray.cols / scaled.width;
+                float sy = (float)gray.rows / scaled.height;
+                for (size_t m = 0; m < tileCorners[t].size(); m++)
+                {
+                    for (size_t c = 0; c < tileCorners[t][m].size(); c++)
+                    {
+                        tileCorners[t][m][c].x = (tileCorners[t][m][c].x + 0.5f) * sx - 0.5f;
+                        tileCorners[t][m][c].y = (tileCorners[t][m][c].y + 0.5f) * sy - 0.5f;
+                    }
+                }
+                continue;
+            }
+
+            int tx = t % tiles.width;
+            int ty = t / tiles.width;
+            cv::Rect roi(tx * tileW - padX, ty * tileH - padY, tileW + 2 * padX, tileH + 2 * padY);
+            roi &= cv::Rect(0, 0, gray.cols, gray.rows);
+
+            detector.detectMarkers(gray(roi), tileCorners[t], tileIds[t]);
+            for (size_t m = 0; m < tileCorners[t].size(); m++)
+            {
+                for (size_t c = 0; c < tileCorners[t][m].size(); c++)
+                {
+                    tileCorners[t][m][c].x += roi.x;
+                    tileCorners[t][m][c].y += roi.y;
+                }
+            }
+        } });
+
+    // keep a single detection per marker id
+    std::map<int, std::pair<double, const std::vector<cv::Point2f> *>> best;
+    for (int t = 0; t < numTiles; t++)
+    {
+        for (size_t m = 0; m < tileIds[t].size(); m++)
+        {
+            double area = cv::contourArea(tileCorners[t][m]);
+            auto it = best.find(tileIds[t][m]);
+            if (it == best.end() || it->second.first < area)
+            {
+                best[tileIds[t][m]] = std::make_pair(area, &tileCorners[t][m]);
+            }
+        }
+    }
+
+    // the downscaled corners are less precise, so they only fill in markers no tile found
+    if (fullFrame)
+    {
+        for (size_t m = 0; m < tileIds[numTiles].size(); m++)
+        {
+            if (best.find(tileIds[numTiles][m]) == best.end())
+            {
+                best[tileIds[numTiles][m]] = std::make_pair(0.0, &tileCorners[numTiles][m]);
+            }
+        }
+    }
+
+    markerCorners.clear();
+    markerIds.clear();
+    for (auto it = best.begin(); it != best.end(); ++it)
+    {
+        markerIds.push_back(it->first);
+        markerCorners.push_back(*it->second.second);
+    }
+
+    return ((int)markerIds.size());
+}
+
+/*
+This function detects the visible part of the ChArUco board in the BGR or grayscale input frame and copies the frame
+to the output. A grayscale frame, such as the luma plane of a YUV source, is read as it is; when the output already
+holds a BGR frame of the same size, such as the converted colour frame, the markers are drawn on it as it is.
+It fills points and corners with matching board and pixel coordinates, ready for calculateCameraPosition.
+When enough markers are seen the interpolated chessboard corners are used, otherwise the corners of the markers themselves.
+It returns true when at least four correspondences were found.
+ */
+bool MarkerTracker::detect(cv::Mat &src, cv::Mat &dst, std::vector<cv::Vec3f> &points, std::vector<cv::Point2f> &corners, bool drawMarkers)
+{
+    double start = (double)cv::getTickCount();
+
+    if (src.channels() == 3)
+    {
+        src.copyTo(dst);
+    }
+    else if (dst.size() != src.size() || dst.type() != CV_8UC3)
+    {
+        cv::cvtColor(src, dst, cv::COLOR_GRAY2BGR);
+    }
+    points.clear();
+    corners.clear();
+
+    PooledMat grayBuffer(src.size(), CV_8UC1);
+    cv::Mat gray = grayBuffer.mat;
+    if (src.channels() == 3)
+    {
+        cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
+    }
+    else
+    {
+        gray = src;
+    }
+
+    std::vector<std::vector<cv::Point2f>> markerCorners;
+    std::vector<int> markerIds;
+    detectTiles(gray, markerCorners, markerIds);
+
+    std::vector<cv::Point2f> charucoCorners;
+    std::vector<int> charucoIds;
+    if (interpolateCorners && !markerIds.empty())
+    {
+        charucoDetector.detectBoard(gray, charucoCorners, charucoIds, markerCorners, markerIds);
+    }
+
+    if (charucoIds.size() >= 4)
+    {
+        std::vector<cv::Point3f> chessboardCorners = board.getChessboardCorners();
+        for (size_t i = 0; i < charucoIds.size(); i++)
+        {
+            points.push_back(toBoardFrame(chessboardCorners[charucoIds[i]]));
+            corners.push_back(charucoCorners[i]);
+        }
+    }
+    else
+    {
+        const std::vector<int> &boardIds = board.getIds();
+        const std::vector<std::vector<cv::Point3f>> &boardPoints = board.getObjPoints();
+        for (size_t m = 0; m < markerIds.size(); m++)
+        {
+            size_t idx = std::find(boardIds.begin(), boardIds.end(), markerIds[m]) - boardIds.begin();
+            if (idx == boardIds.size())
+            {
+                continue; // marker from another board
+            }
+            for (int c = 0; c < 4; c++)
+            {
+                points.push_back(toBoardFrame(boardPoints[idx][c]));
+                corners.push_back(markerCorners[m][c]);
+            }
+        }
+    }
+
+    if (drawMarkers)
+    {
+        cv::aruco::drawDetectedMarkers(dst, markerCorners, markerIds);
+        if (!charucoIds.empty())
+        {
+            cv::aruco::drawDetectedCornersCharuco(dst, charucoCorners, charucoIds);
+        }
+    }
+
+    bool found = corners.size() >= 4;
+    frames++;
+    if (found)
+    {
+        poses++;
+    }
+    detectMs += ((double)cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+    return (found);
+}
+
+/*
+This function renders the board to an image file so it can be printed.
+ */
+int MarkerTracker::saveBoardImage(std::string filename, cv::Size size)
+{
+    cv::Mat image;
+    board.generateImage(size, image, 20, 1);
+    cv::imwrite(filename, image);
+    return (0);
+}
+
+/*
+This function prints the pose hit rate and the detection cost per frame and per successful pose.
+ */
+void MarkerTracker::printStats()
+{
+    if (frames == 0)
+    {
+        return;
+    }
+    printf("Marker tracking: %d/%d frames with pose (%.1f%%), %.2f ms per frame, %.2f ms per pose\n",
+           poses, frames, 100.0 * poses / frames, detectMs / frames, poses > 0 ? detectMs / poses : 0.0);
+}
@@ -0,0 +1,57 @@
+/*
+Puja Chaudhury
+marker_tracking.h
+ChArUco target tracking. Markers are detected independently in overlapping image tiles, so the pose can be recovered
+from whichever part of the board is visible instead of requiring the whole pattern. A downscaled pass over the whole
+frame catches the markers that lie across a seam and are too large for any one tile.
+*/
+
+#ifndef marker_tracking_hpp
+#define marker_tracking_hpp
+
+#include <stdio.h>
+#include <iostream>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/calib3d.hpp>
+#include <opencv2/objdetect/aruco_detector.hpp>
+#include <opencv2/objdetect/charuco_detector.hpp>
+
+class MarkerTracker
+{
+public:
+    /*
+    squares is the number of chessboard squares across and down, markerRatio the marker edge as a fraction of the square
+    and tiles the grid of image tiles detection is split into. One chessboard square is one board unit.
+     */
+    MarkerTracker(cv::Size squares = cv::Size(5, 7), float markerRatio = 0.7f,
+                  cv::aruco::PredefinedDictionaryType dictionary = cv::aruco::DICT_4X4_50, cv::Size tiles = cv::Size(2, 2));
+
+    bool detect(cv::Mat &src, cv::Mat &dst, std::vector<cv::Vec3f> &points, std::vector<cv::Point2f> &corners, bool drawMarkers);
+    int saveBoardImage(std::string filename, cv::Size size);
+    void printStats();
+
+    // fraction of the tile size that neighbouring tiles overlap by; markers smaller than this are never split
+    float overlap;
+
+    // scale of the extra pass over the whole frame that finds markers too large for the overlap, 0 to skip it
+    float fullFrameScale;
+
+    // interpolate ChArUco chessboard corners instead of using the raw marker corners for the pose
+    bool interpolateCorners;
+
+private:
+    int detectTiles(const cv::Mat &gray, std::vector<std::vector<cv::Point2f>> &markerCorners, std::vector<int> &markerIds);
+
+    cv::aruco::CharucoBoard board;
+    cv::aruco::ArucoDetector detector;
+    cv::aruco::CharucoDetector charucoDetector;
+    cv::Size tiles;
+
+    int frames;
+    int poses;
+    double detectMs;
+};
+
+#endif
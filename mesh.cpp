@@ -0,0 +1,234 @@
+/*
+Puja Chaudhury
+mesh.cpp
+Function implementations for tessellating the primitive shapes used as virtual objects.
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "mesh.h"
+
+/*
+This function returns a view of the mesh's arrays for the rasterizer. The mesh must outlive the view.
+ */
+MeshView meshView(const Mesh &mesh)
+{
+    MeshView view;
+    view.vertices = mesh.vertices.data();
+    view.normals = mesh.normals.size() == mesh.vertices.size() ? mesh.normals.data() : NULL;
+    view.numVertices = (int)mesh.vertices.size();
+    view.triangles = mesh.triangles.data();
+    view.numTriangles = (int)mesh.triangles.size();
+    view.color = mesh.color;
+    view.minBound = mesh.minBound;
+    view.maxBound = mesh.maxBound;
+    return (view);
+}
+
+/*
+This function returns a placement that scales the mesh so its largest extent is size board units
+and stands it on the board with its footprint centred on center.
+ */
+MeshPlacement fitToBoard(const MeshView &mesh, cv::Point3f center, float size)
+{
+    MeshPlacement placement;
+    cv::Vec3f extent = mesh.maxBound - mesh.minBound;
+    float largest = std::max(extent[0], std::max(extent[1], extent[2]));
+    placement.scale = largest > 0 ? size / largest : 1.0;
+    placement.position = cv::Vec3d(center.x - placement.scale * (mesh.minBound[0] + mesh.maxBound[0]) / 2,
+                                   center.y - placement.scale * (mesh.minBound[1] + mesh.maxBound[1]) / 2,
+                                   center.z - placement.scale * mesh.minBound[2]);
+    return (placement);
+}
+
+/*
+This function recomputes the axis-aligned bounding box of the mesh vertices.
+ */
+int computeBounds(Mesh &mesh)
+{
+    mesh.minBound = cv::Vec3f(FLT_MAX, FLT_MAX, FLT_MAX);
+    mesh.maxBound = cv::Vec3f(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (size_t i = 0; i < mesh.vertices.size(); i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            mesh.minBound[k] = std::min(mesh.minBound[k], mesh.vertices[i][k]);
+            mesh.maxBound[k] = std::max(mesh.maxBound[k], mesh.vertices[i][k]);
+        }
+    }
+    return (0);
+}
+
+/*
+This function sets every vertex normal to the area-weighted average of the faces around it,
+for models that come without usable per-vertex normals.
+ */
+int computeNormals(Mesh &mesh)
+{
+    mesh.normals.assign(mesh.vertices.size(), cv::Vec3f(0, 0, 0));
+    for (size_t f = 0; f < mesh.triangles.size(); f++)
+    {
+        const cv::Vec3i &tri = mesh.triangles[f];
+        cv::Vec3f a = mesh.vertices[tri[1]] - mesh.vertices[tri[0]];
+        cv::Vec3f b = mesh.vertices[tri[2]] - mesh.vertices[tri[0]];
+        cv::Vec3f n(a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]);
+        for (int k = 0; k < 3; k++)
+        {
+            mesh.normals[tri[k]] += n;
+        }
+    }
+    for (size_t i = 0; i < mesh.normals.size(); i++)
+    {
+        cv::Vec3f &n = mesh.normals[i];
+        float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len > 0)
+        {
+            n = n * (1.0f / len);
+        }
+    }
+    return (0);
+}
+
+/*
+This function builds a square pyramid standing on the board, with the base centred on baseCenter.
+The faces are flat so no vertex normals are generated.
+ */
+int makePyramid(Mesh &mesh, cv::Point3f baseCenter, float halfWidth, float height, cv::Vec3b color)
+{
+    float x = baseCenter.x;
+    float y = baseCenter.y;
+    float z = baseCenter.z;
+
+    mesh.vertices.clear();
+    mesh.normals.clear();
+    mesh.triangles.clear();
+    mesh.color = color;
+
+    // base corners in counter-clockwise order seen from above, then the apex
+    mesh.vertices.push_back(cv::Vec3f(x + halfWidth, y + halfWidth, z)); // tr
+    mesh.vertices.push_back(cv::Vec3f(x - halfWidth, y + halfWidth, z)); // tl
+    mesh.vertices.push_back(cv::Vec3f(x - halfWidth, y - halfWidth, z)); // bl
+    mesh.vertices.push_back(cv::Vec3f(x + halfWidth, y - halfWidth, z)); // br
+    mesh.vertices.push_back(cv::Vec3f(x, y, z + height));               // apex
+
+    for (int i = 0; i < 4; i++)
+    {
+        mesh.triangles.push_back(cv::Vec3i(i, (i + 1) % 4, 4));
+    }
+    mesh.triangles.push_back(cv::Vec3i(0, 3, 2));
+    mesh.triangles.push_back(cv::Vec3i(0, 2, 1));
+
+    computeBounds(mesh);
+    return (0);
+}
+
+/*
+This function builds a closed cylinder standing on its axis, centred on center, with segments facets around the side.
+Side vertices carry radial normals and the caps have their own vertices so they shade flat.
+ */
+int makeCylinder(Mesh &mesh, cv::Point3f center, float radius, float height, int segments, cv::Vec3b color)
+{
+    float bottom = center.z - height / 2;
+    float top = center.z + height / 2;
+
+    mesh.vertices.clear();
+    mesh.normals.clear();
+    mesh.triangles.clear();
+    mesh.color = color;
+
+    // side ring: bottom and top vertex for every segment boundary
+    for (int i = 0; i <= segments; i++)
+    {
+        float phi = (float)i / (float)segments * 2 * CV_PI;
+        float c = cos(phi);
+        float s = sin(phi);
+        mesh.vertices.push_back(cv::Vec3f(center.x + radius * c, center.y + radius * s, bottom));
+        mesh.vertices.push_back(cv::Vec3f(center.x + radius * c, center.y + radius * s, top));
+        mesh.normals.push_back(cv::Vec3f(c, s, 0));
+        mesh.normals.push_back(cv::Vec3f(c, s, 0));
+    }
+    for (int i = 0; i < segments; i++)
+    {
+        int b0 = 2 * i, t0 = 2 * i + 1, b1 = 2 * i + 2, t1 = 2 * i + 3;
+        mesh.triangles.push_back(cv::Vec3i(b0, b1, t1));
+        mesh.triangles.push_back(cv::Vec3i(b0, t1, t0));
+    }
+
+    // caps: a centre vertex plus a ring of their own
+    for (int cap = 0; cap < 2; cap++)
+    {
+        float z = cap == 0 ? bottom : top;
+        float nz = cap == 0 ? -1.0f : 1.0f;
+        int first = (int)mesh.vertices.size();
+        mesh.vertices.push_back(cv::Vec3f(center.x, center.y, z));
+        mesh.normals.push_back(cv::Vec3f(0, 0, nz));
+        for (int i = 0; i <= segments; i++)
+        {
+            float phi = (float)i / (float)segments * 2 * CV_PI;
+            mesh.vertices.push_back(cv::Vec3f(center.x + radius * cos(phi), center.y + radius * sin(phi), z));
+            mesh.normals.push_back(cv::Vec3f(0, 0, nz));
+        }
+        for (int i = 0; i < segments; i++)
+        {
+            if (cap == 0)
+            {
+                mesh.triangles.push_back(cv::Vec3i(first, first + i + 2, first + i + 1));
+            }
+            else
+            {
+                mesh.triangles.push_back(cv::Vec3i(first, first + i + 1, first + i + 2));
+            }
+        }
+    }
+
+    computeBounds(mesh);
+    return (0);
+}
+
+/*
+This function builds a UV sphere with segments rings from pole to pole and 2 * segments facets around.
+Every vertex normal points away from the centre.
+ */
+int makeSphere(Mesh &mesh, cv::Point3f center, float radius, int segments, cv::Vec3b color)
+{
+    int around = 2 * segments;
+
+    mesh.vertices.clear();
+    mesh.normals.clear();
+    mesh.triangles.clear();
+    mesh.color = color;
+
+    for (int i = 0; i <= segments; i++)
+    {
+        float theta = (float)i / (float)segments * CV_PI;
+        for (int j = 0; j <= around; j++)
+        {
+            float phi = (float)j / (float)around * 2 * CV_PI;
+            cv::Vec3f n(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+            mesh.vertices.push_back(cv::Vec3f(center.x + radius * n[0], center.y + radius * n[1], center.z + radius * n[2]));
+            mesh.normals.push_back(n);
+        }
+    }
+    for (int i = 0; i < segments; i++)
+    {
+        for (int j = 0; j < around; j++)
+        {
+            int upper = i * (around + 1) + j;
+            int lower = upper + around + 1;
+            // the triangles touching a pole would be degenerate
+            if (i != segments - 1)
+            {
+                mesh.triangles.push_back(cv::Vec3i(upper, lower, lower + 1));
+            }
+            if (i != 0)
+            {
+                mesh.triangles.push_back(cv::Vec3i(upper, lower + 1, upper + 1));
+            }
+        }
+    }
+
+    computeBounds(mesh);
+    return (0);
+}
@@ -0,0 +1,65 @@
+/*
+Puja Chaudhury
+mesh.h
+Triangle meshes for the virtual objects placed on the target, in board coordinates.
+*/
+
+#ifndef mesh_hpp
+#define mesh_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+struct Mesh
+{
+    std::vector<cv::Vec3f> vertices;
+    std::vector<cv::Vec3f> normals;   // one per vertex for smooth shading, empty for flat shading
+    std::vector<cv::Vec3i> triangles; // counter-clockwise when seen from outside the object
+    cv::Vec3b color;
+    cv::Vec3f minBound, maxBound;     // axis-aligned bounding box of the vertices
+};
+
+/*
+A read-only view of mesh data, which may live in a Mesh or in a memory-mapped mesh file.
+This is what the rasterizer draws.
+ */
+struct MeshView
+{
+    const cv::Vec3f *vertices;
+    const cv::Vec3f *normals; // null for flat shading
+    int numVertices;
+    const cv::Vec3i *triangles;
+    int numTriangles;
+    cv::Vec3b color;
+    cv::Vec3f minBound, maxBound;
+};
+
+/*
+Where a mesh sits on the board: it is rotated (Rodrigues vector) and uniformly scaled about its own origin,
+then moved to position in board units.
+ */
+struct MeshPlacement
+{
+    cv::Vec3d rotation;
+    double scale;
+    cv::Vec3d position;
+
+    MeshPlacement() : rotation(0, 0, 0), scale(1), position(0, 0, 0) {}
+};
+
+MeshView meshView(const Mesh &mesh);
+
+MeshPlacement fitToBoard(const MeshView &mesh, cv::Point3f center, float size);
+
+int computeBounds(Mesh &mesh);
+
+int computeNormals(Mesh &mesh);
+
+int makePyramid(Mesh &mesh, cv::Point3f baseCenter, float halfWidth, float height, cv::Vec3b color);
+
+int makeCylinder(Mesh &mesh, cv::Point3f center, float radius, float height, int segments, cv::Vec3b color);
+
+int makeSphere(Mesh &mesh, cv::Point3f center, float radius, int segments, cv::Vec3b color);
+
+#endif
@@ -0,0 +1,551 @@
+/*
+Puja Chaudhury
+mesh_io.cpp
+Function implementations for parsing OBJ/PLY models and for writing and memory-mapping the binary mesh files.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mesh_io.h"
+
+static const uint32_t meshFileVersion = 1;
+
+MappedMesh::MappedMesh() : data(NULL), size(0)
+{
+}
+
+MappedMesh::~MappedMesh()
+{
+    close();
+}
+
+/*
+This function maps a binary mesh file read-only and checks that its header matches the file size and that every
+triangle index names one of its vertices, so a corrupt or edited file cannot make the rasterizer read out of bounds.
+Apart from the index array, pages are only read from disk when the rasterizer first touches them.
+ */
+int MappedMesh::open(std::string filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return (-1);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MeshFileHeader))
+    {
+        ::close(fd);
+        return (-1);
+    }
+
+    void *mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        printf("Unable to map mesh file %s\n", filename.c_str());
+        return (-1);
+    }
+    data = mapped;
+    size = (size_t)st.st_size;
+
+    const MeshFileHeader &h = header();
+    size_t expected = sizeof(MeshFileHeader) + (size_t)h.numVertices * sizeof(cv::Vec3f) * (h.hasNormals ? 2 : 1) + (size_t)h.numTriangles * sizeof(cv::Vec3i);
+    if (memcmp(h.magic, "ARMS", 4) != 0 || h.version != meshFileVersion || size != expected)
+    {
+        close();
+        return (-1);
+    }
+
+    MeshView v = view(cv::Vec3b());
+    for (int t = 0; t < v.numTriangles; t++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            if (v.triangles[t][c] < 0 || v.triangles[t][c] >= v.numVertices)
+            {
+                printf("Mesh file %s has a triangle index outside its %d vertices\n", filename.c_str(), v.numVertices);
+                close();
+                return (-1);
+            }
+        }
+    }
+
+    return (0);
+}
+
+void MappedMesh::close()
+{
+    if (data != NULL)
+    {
+        munmap(data, size);
+    }
+    data = NULL;
+    size = 0;
+}
+
+bool MappedMesh::empty() const
+{
+    return (data == NULL);
+}
+
+const MeshFileHeader &MappedMesh::header() const
+{
+    return (*(const MeshFileHeader *)data);
+}
+
+/*
+This function returns a view pointing into the mapped file. It stays valid until the mesh is closed.
+ */
+MeshView MappedMesh::view(cv::Vec3b color) const
+{
+    MeshView v;
+    const MeshFileHeader &h = header();
+    const char *p = (const char *)data + sizeof(MeshFileHeader);
+
+    v.numVertices = (int)h.numVertices;
+    v.vertices = (const cv::Vec3f *)p;
+    p += (size_t)h.numVertices * sizeof(cv::Vec3f);
+    v.normals = NULL;
+    if (h.hasNormals)
+    {
+        v.normals = (const cv::Vec3f *)p;
+        p += (size_t)h.numVertices * sizeof(cv::Vec3f);
+    }
+    v.numTriangles = (int)h.numTriangles;
+    v.triangles = (const cv::Vec3i *)p;
+    v.color = color;
+    v.minBound = cv::Vec3f(h.bounds[0], h.bounds[1], h.bounds[2]);
+    v.maxBound = cv::Vec3f(h.bounds[3], h.bounds[4], h.bounds[5]);
+    return (v);
+}
+
+/*
+This function turns a polygon with the given vertex indices into a fan of triangles.
+Indices outside the vertex list are rejected so a broken file cannot make the rasterizer read out of bounds.
+ */
+static void addPolygon(Mesh &mesh, const std::vector<int> &polygon)
+{
+    int n = (int)mesh.vertices.size();
+    for (size_t i = 0; i < polygon.size(); i++)
+    {
+        if (polygon[i] < 0 || polygon[i] >= n)
+        {
+            return;
+        }
+    }
+    for (size_t i = 2; i < polygon.size(); i++)
+    {
+        mesh.triangles.push_back(cv::Vec3i(polygon[0], polygon[i - 1], polygon[i]));
+    }
+}
+
+/*
+This function reads the vertices and faces of a Wavefront OBJ file. Texture coordinates, normals and materials are ignored,
+faces with more than three corners are split into triangles and negative (relative) indices are supported.
+ */
+int loadMeshObj(std::string filename, Mesh &mesh)
+{
+    std::ifstream file(filename.c_str());
+    if (!file.is_open())
+    {
+        printf("Unable to open model file %s\n", filename.c_str());
+        return (-1);
+    }
+
+    mesh.vertices.clear();
+    mesh.normals.clear();
+    mesh.triangles.clear();
+
+    std::string line;
+    std::vector<int> polygon;
+    while (std::getline(file, line))
+    {
+        const char *s = line.c_str();
+        while (*s == ' ' || *s == '\t')
+        {
+            s++;
+        }
+        if (s[0] == 'v' && (s[1] == ' ' || s[1] == '\t'))
+        {
+            char *end;
+            float x = strtof(s + 2, &end);
+            float y = strtof(end, &end);
+            float z = strtof(end, &end);
+            mesh.vertices.push_back(cv::Vec3f(x, y, z));
+        }
+        else if (s[0] == 'f' && (s[1] == ' ' || s[1] == '\t'))
+        {
+            polygon.clear();
+            std::istringstream corners(s + 2);
+            std::string corner;
+            while (corners >> corner)
+            {
+                // the vertex index is everything before the first '/'
+                int idx = atoi(corner.c_str());
+                polygon.push_back(idx < 0 ? (int)mesh.vertices.size() + idx : idx - 1);
+            }
+            addPolygon(mesh, polygon);
+        }
+    }
+
+    return (0);
+}
+
+enum PlyType
+{
+    PLY_INT8,
+    PLY_UINT8,
+    PLY_INT16,
+    PLY_UINT16,
+    PLY_INT32,
+    PLY_UINT32,
+    PLY_FLOAT32,
+    PLY_FLOAT64,
+    PLY_UNKNOWN
+};
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type;
+    bool isList;
+    PlyType countType;
+};
+
+struct PlyElement
+{
+    std::string name;
+    long count;
+    std::vector<PlyProperty> properties;
+};
+
+static PlyType plyType(const std::string &name)
+{
+    if (name == "char" || name == "int8")
+        return PLY_INT8;
+    if (name == "uchar" || name == "uint8")
+        return PLY_UINT8;
+    if (name == "short" || name == "int16")
+        return PLY_INT16;
+    if (name == "ushort" || name == "uint16")
+        return PLY_UINT16;
+    if (name == "int" || name == "int32")
+        return PLY_INT32;
+    if (name == "uint" || name == "uint32")
+        return PLY_UINT32;
+    if (name == "float" || name == "float32")
+        return PLY_FLOAT32;
+    if (name == "double" || name == "float64")
+        return PLY_FLOAT64;
+    return PLY_UNKNOWN;
+}
+
+/*
+This function reads one scalar of the given type, either as text or as a little-endian binary value.
+ */
+static double readPlyValue(FILE *fp, PlyType type, bool ascii)
+{
+    if (ascii)
+    {
+        double v = 0;
+        if (fscanf(fp, "%lf", &v) != 1)
+        {
+            return 0;
+        }
+        return v;
+    }
+
+    static const size_t sizes[] = {1, 1, 2, 2, 4, 4, 4, 8};
+    unsigned char buf[8] = {0};
+    if (fread(buf, 1, sizes[type], fp) != sizes[type])
+    {
+        return 0;
+    }
+    switch (type)
+    {
+    case PLY_INT8:
+        return (double)(int8_t)buf[0];
+    case PLY_UINT8:
+        return (double)buf[0];
+    case PLY_INT16:
+    {
+        int16_t v;
+        memcpy(&v, buf, 2);
+        return v;
+    }
+    case PLY_UINT16:
+    {
+        uint16_t v;
+        memcpy(&v, buf, 2);
+        return v;
+    }
+    case PLY_INT32:
+    {
+        int32_t v;
+        memcpy(&v, buf, 4);
+        return v;
+    }
+    case PLY_UINT32:
+    {
+        uint32_t v;
+        memcpy(&v, buf, 4);
+        return v;
+    }
+    case PLY_FLOAT32:
+    {
+        float v;
+        memcpy(&v, buf, 4);
+        return v;
+    }
+    default:
+    {
+        double v;
+        memcpy(&v, buf, 8);
+        return v;
+    }
+    }
+}
+
+/*
+This function reads the vertex positions and faces of a PLY file in ASCII or binary little-endian format.
+Other vertex properties and other elements are skipped.
+ */
+int loadMeshPly(std::string filename, Mesh &mesh)
+{
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (!fp)
+    {
+        printf("Unable to open model file %s\n", filename.c_str());
+        return (-1);
+    }
+
+    char line[512];
+    bool ascii = true;
+    std::vector<PlyElement> elements;
+    if (!fgets(line, sizeof(line), fp) || strncmp(line, "ply", 3) != 0)
+    {
+        printf("%s is not a PLY file\n", filename.c_str());
+        fclose(fp);
+        return (-1);
+    }
+    while (fgets(line, sizeof(line), fp))
+    {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "format")
+        {
+            std::string format;
+            words >> format;
+            if (format == "binary_big_endian")
+            {
+                printf("Big-endian PLY files are not supported: %s\n", filename.c_str());
+                fclose(fp);
+                return (-1);
+            }
+            ascii = format == "ascii";
+        }
+        else if (keyword == "element")
+        {
+            PlyElement element;
+            words >> element.name >> element.count;
+            elements.push_back(element);
+        }
+        else if (keyword == "property" && !elements.empty())
+        {
+            PlyProperty property;
+            std::string type;
+            words >> type;
+            property.isList = type == "list";
+            if (property.isList)
+            {
+                std::string countType;
+                words >> countType >> type;
+                property.countType = plyType(countType);
+            }
+            property.type = plyType(type);
+            words >> property.name;
+            if (property.type == PLY_UNKNOWN || (property.isList && property.countType == PLY_UNKNOWN))
+            {
+                printf("Unsupported PLY property type in %s\n", filename.c_str());
+                fclose(fp);
+                return (-1);
+            }
+            elements.back().properties.push_back(property);
+        }
+        else if (keyword == "end_header")
+        {
+            break;
+        }
+    }
+
+    mesh.vertices.clear();
+    mesh.normals.clear();
+    mesh.triangles.clear();
+
+    std::vector<int> polygon;
+    for (size_t e = 0; e < elements.size(); e++)
+    {
+        const PlyElement &element = elements[e];
+        for (long i = 0; i < element.count; i++)
+        {
+            cv::Vec3f vertex(0, 0, 0);
+            for (size_t p = 0; p < element.properties.size(); p++)
+            {
+                const PlyProperty &property = element.properties[p];
+                if (property.isList)
+                {
+                    int n = (int)readPlyValue(fp, property.countType, ascii);
+                    polygon.clear();
+                    for (int k = 0; k < n; k++)
+                    {
+                        polygon.push_back((int)readPlyValue(fp, property.type, ascii));
+                    }
+                    if (element.name == "face" && (property.name == "vertex_indices" || property.name == "vertex_index"))
+                    {
+                        addPolygon(mesh, polygon);
+                    }
+                    continue;
+                }
+
+                double value = readPlyValue(fp, property.type, ascii);
+                if (element.name == "vertex")
+                {
+                    if (property.name == "x")
+                        vertex[0] = (float)value;
+                    else if (property.name == "y")
+                        vertex[1] = (float)value;
+                    else if (property.name == "z")
+                        vertex[2] = (float)value;
+                }
+            }
+            if (element.name == "vertex")
+            {
+                mesh.vertices.push_back(vertex);
+            }
+        }
+    }
+    fclose(fp);
+
+    return (0);
+}
+
+/*
+This function writes a mesh in the binary layout that MappedMesh reads, recording the size and time of the source model.
+It writes to a temporary name and renames it, so a crash never leaves a truncated file behind.
+ */
+int writeMeshFile(std::string filename, const Mesh &mesh, uint64_t sourceSize, int64_t sourceTime)
+{
+    MeshFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "ARMS", 4);
+    h.version = meshFileVersion;
+    h.numVertices = (uint32_t)mesh.vertices.size();
+    h.numTriangles = (uint32_t)mesh.triangles.size();
+    h.sourceSize = sourceSize;
+    h.sourceTime = sourceTime;
+    for (int k = 0; k < 3; k++)
+    {
+        h.bounds[k] = mesh.minBound[k];
+        h.bounds[3 + k] = mesh.maxBound[k];
+    }
+    h.hasNormals = mesh.normals.size() == mesh.vertices.size() ? 1 : 0;
+
+    std::string tmpName = filename + ".tmp";
+    FILE *fp = fopen(tmpName.c_str(), "wb");
+    if (!fp)
+    {
+        printf("Unable to write mesh file %s\n", filename.c_str());
+        return (-1);
+    }
+    fwrite(&h, sizeof(h), 1, fp);
+    fwrite(mesh.vertices.data(), sizeof(cv::Vec3f), mesh.vertices.size(), fp);
+    if (h.hasNormals)
+    {
+        fwrite(mesh.normals.data(), sizeof(cv::Vec3f), mesh.normals.size(), fp);
+    }
+    fwrite(mesh.triangles.data(), sizeof(cv::Vec3i), mesh.triangles.size(), fp);
+    bool ok = ferror(fp) == 0;
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(tmpName.c_str(), filename.c_str()) != 0)
+    {
+        printf("Unable to write mesh file %s\n", filename.c_str());
+        remove(tmpName.c_str());
+        return (-1);
+    }
+
+    return (0);
+}
+
+/*
+This function makes a model available for drawing. A .mesh file is mapped directly.
+For an OBJ or PLY file the converted copy (<model>.mesh) is mapped if it is newer than the model;
+otherwise the model is parsed, given smooth normals, written out as the converted copy and then mapped.
+ */
+int loadModel(std::string filename, MappedMesh &mesh)
+{
+    std::string ext = filename.substr(filename.find_last_of('.') + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if (ext == "mesh")
+    {
+        return (mesh.open(filename));
+    }
+
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0)
+    {
+        printf("Unable to open model file %s\n", filename.c_str());
+        return (-1);
+    }
+
+    std::string cacheName = filename + ".mesh";
+    if (mesh.open(cacheName) == 0 && mesh.header().sourceSize == (uint64_t)st.st_size && mesh.header().sourceTime == (int64_t)st.st_mtime)
+    {
+        printf("Mapped %s (%u triangles)\n", cacheName.c_str(), mesh.header().numTriangles);
+        return (0);
+    }
+    mesh.close();
+
+    Mesh parsed;
+    int status;
+    if (ext == "obj")
+    {
+        status = loadMeshObj(filename, parsed);
+    }
+    else if (ext == "ply")
+    {
+        status = loadMeshPly(filename, parsed);
+    }
+    else
+    {
+        printf("Unknown model format: %s\n", filename.c_str());
+        return (-1);
+    }
+    if (status != 0 || parsed.triangles.empty())
+    {
+        printf("No triangles found in %s\n", filename.c_str());
+        return (-1);
+    }
+
+    computeNormals(parsed);
+    computeBounds(parsed);
+    if (writeMeshFile(cacheName, parsed, (uint64_t)st.st_size, (int64_t)st.st_mtime) != 0)
+    {
+        return (-1);
+    }
+    printf("Converted %s to %s (%zu vertices, %zu triangles)\n", filename.c_str(), cacheName.c_str(), parsed.vertices.size(), parsed.triangles.size());
+
+    return (mesh.open(cacheName));
+}
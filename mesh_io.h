@@ -0,0 +1,59 @@
+/*
+Puja Chaudhury
+mesh_io.h
+Loading OBJ and PLY models as virtual objects. The first load converts the model into a compact binary mesh file
+next to it; later runs memory-map that file and draw straight from it.
+*/
+
+#ifndef mesh_io_hpp
+#define mesh_io_hpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+
+#include "mesh.h"
+
+// Layout of a binary mesh file: this header, then vertices, normals (if any) and triangles as packed 32-bit values
+struct MeshFileHeader
+{
+    char magic[4]; // "ARMS"
+    uint32_t version;
+    uint32_t numVertices;
+    uint32_t numTriangles;
+    uint64_t sourceSize; // size and modification time of the model the file was converted from
+    int64_t sourceTime;
+    float bounds[6]; // min x, y, z then max x, y, z
+    uint32_t hasNormals;
+    uint32_t reserved;
+};
+
+class MappedMesh
+{
+public:
+    MappedMesh();
+    ~MappedMesh();
+
+    int open(std::string filename);
+    void close();
+    bool empty() const;
+    const MeshFileHeader &header() const;
+    MeshView view(cv::Vec3b color) const;
+
+private:
+    MappedMesh(const MappedMesh &);
+    MappedMesh &operator=(const MappedMesh &);
+
+    void *data;
+    size_t size;
+};
+
+int loadMeshObj(std::string filename, Mesh &mesh);
+
+int loadMeshPly(std::string filename, Mesh &mesh);
+
+int writeMeshFile(std::string filename, const Mesh &mesh, uint64_t sourceSize, int64_t sourceTime);
+
+int loadModel(std::string filename, MappedMesh &mesh);
+
+#endif
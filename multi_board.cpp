@@ -0,0 +1,267 @@
+/*
+Puja Chaudhury
+multi_board.cpp
+Function implementations for detecting and following several boards of the same kind in one frame.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "multi_board.h"
+
+MultiBoardDetector::MultiBoardDetector(const TargetDetector &detector, int maxBoards)
+    : maxBoards(maxBoards),
+      keepMissing(10),
+      matchDistance(0.5f),
+      detector(detector),
+      nextId(0),
+      frames(0),
+      boards(0),
+      detectMs(0)
+{
+    detector.objectPoints(points);
+}
+
+/*
+This function looks for every board in a BGR or grayscale frame and returns how many it found.
+The search runs on the frame scaled to the processing size. After each board is found, its area, grown by about one
+square so its outer squares go too, is painted over with the image's mean grey and the search is repeated on what is left.
+The boards found are then refined at full resolution in parallel and matched to the boards of the previous frame.
+ */
+int MultiBoardDetector::detect(const cv::Mat &frame, cv::Size processing)
+{
+    double start = (double)cv::getTickCount();
+
+    if (frame.channels() == 3)
+    {
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    }
+    else
+    {
+        gray = frame;
+    }
+    resizeForProcessing(gray, processing.area() > 0 ? processing : gray.size(), small);
+    small.copyTo(masked);
+
+    // the hull of the corners is grown by one square's width on each side
+    int shortSide = std::min(detector.patternSize.width, detector.patternSize.height);
+    float grow = 1.0f + 2.0f / std::max(shortSide - 1, 1) + 0.1f;
+    cv::Scalar fill = cv::mean(small);
+
+    std::vector<std::vector<cv::Point2f>> found;
+    for (int k = 0; k < maxBoards; k++)
+    {
+        std::vector<cv::Point2f> corners;
+        if (!detector.find(masked, corners))
+        {
+            break;
+        }
+        found.push_back(corners);
+
+        std::vector<cv::Point2f> hull;
+        cv::convexHull(corners, hull);
+        cv::Point2f center(0, 0);
+        for (size_t i = 0; i < hull.size(); i++)
+        {
+            center += hull[i];
+        }
+        center *= 1.0f / hull.size();
+        std::vector<cv::Point> region(hull.size());
+        for (size_t i = 0; i < hull.size(); i++)
+        {
+            region[i] = center + (hull[i] - center) * grow;
+        }
+        cv::fillConvexPoly(masked, region, fill);
+    }
+
+    if (small.size() != gray.size())
+    {
+        cv::parallel_for_(cv::Range(0, (int)found.size()), [&](const cv::Range &range)
+                          {
+            for (int i = range.start; i < range.end; i++)
+            {
+                scalePoints(found[i], small.size(), gray.size());
+                detector.refine(gray, found[i]);
+            } });
+    }
+
+    match(found);
+
+    frames++;
+    boards += (int)found.size();
+    detectMs += ((double)cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+    return ((int)found.size());
+}
+
+/*
+This function gives each detection an id. Detections and the boards of the previous frame are paired closest first,
+as long as they are within matchDistance of the board's size; a detection left over starts a new board, and a board
+left over counts one more missed frame and is forgotten after keepMissing of them. Boards found in this frame come first.
+ */
+void MultiBoardDetector::match(std::vector<std::vector<cv::Point2f>> &found)
+{
+    std::vector<BoardInstance> current(found.size());
+    for (size_t i = 0; i < found.size(); i++)
+    {
+        cv::Rect2f bounds = cv::boundingRect(found[i]);
+        current[i].id = -1;
+        current[i].corners.swap(found[i]);
+        current[i].center = cv::Point2f(bounds.x + bounds.width / 2, bounds.y + bounds.height / 2);
+        current[i].size = std::sqrt(bounds.width * bounds.width + bounds.height * bounds.height);
+        current[i].missed = 0;
+        current[i].posed = false;
+    }
+
+    struct Pair
+    {
+        float distance;
+        int detection;
+        int instance;
+    };
+    std::vector<Pair> pairs;
+    for (size_t i = 0; i < current.size(); i++)
+    {
+        for (size_t j = 0; j < instances.size(); j++)
+        {
+            float distance = (float)cv::norm(current[i].center - instances[j].center);
+            if (distance < matchDistance * instances[j].size)
+            {
+                pairs.push_back({distance, (int)i, (int)j});
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [](const Pair &a, const Pair &b)
+              { return a.distance < b.distance; });
+
+    std::vector<uchar> taken(instances.size(), 0);
+    for (size_t k = 0; k < pairs.size(); k++)
+    {
+        BoardInstance &detection = current[pairs[k].detection];
+        if (detection.id >= 0 || taken[pairs[k].instance])
+        {
+            continue;
+        }
+        detection.id = instances[pairs[k].instance].id;
+        detection.rot = instances[pairs[k].instance].rot;
+        detection.trans = instances[pairs[k].instance].trans;
+        taken[pairs[k].instance] = 1;
+    }
+
+    for (size_t i = 0; i < current.size(); i++)
+    {
+        if (current[i].id < 0)
+        {
+            current[i].id = nextId++;
+        }
+    }
+    for (size_t j = 0; j < instances.size(); j++)
+    {
+        if (!taken[j] && instances[j].missed < keepMissing)
+        {
+            current.push_back(instances[j]);
+            current.back().missed++;
+            current.back().posed = false;
+        }
+    }
+
+    instances.swap(current);
+}
+
+/*
+This function solves the pose of every board found in this frame, one solvePnP per board, side by side.
+It returns the number of boards posed.
+ */
+int MultiBoardDetector::estimatePoses(cv::Mat &camera_matrix, cv::Mat &dist_coeff)
+{
+    cv::parallel_for_(cv::Range(0, (int)instances.size()), [&](const cv::Range &range)
+                      {
+        for (int i = range.start; i < range.end; i++)
+        {
+            BoardInstance &board = instances[i];
+            if (board.missed == 0)
+            {
+                // each board gets matrices of its own, so the pose carried over from the last frame is not overwritten in place
+                cv::Mat rot, trans;
+                calculateCameraPosition(points, board.corners, camera_matrix, dist_coeff, rot, trans);
+                board.rot = rot;
+                board.trans = trans;
+                board.posed = true;
+            }
+        } });
+
+    int posed = 0;
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+        posed += instances[i].posed ? 1 : 0;
+    }
+    return (posed);
+}
+
+/*
+This function forgets every board, so the next boards found get new ids.
+ */
+void MultiBoardDetector::reset()
+{
+    instances.clear();
+}
+
+void MultiBoardDetector::printStats()
+{
+    if (frames == 0)
+    {
+        return;
+    }
+    printf("%s: %.2f boards per frame, %d ids given, %.2f ms per frame\n",
+           detector.name.c_str(), (double)boards / frames, nextId, detectMs / frames);
+}
+
+/*
+This function draws the axes, objects and id of every posed board. The wireframes of all boards are projected into
+their own draw lists in parallel and then rasterized one list after another. Solid objects are rendered board by
+board, as they share one rasterizer.
+ */
+int drawBoardInstances(cv::Mat &frame, std::vector<BoardInstance> &instances, std::vector<OverlayDrawList> &overlays, cv::Mat &camera_matrix, cv::Mat &dist_coeff, bool axes, bool objects, bool solid, TargetScene &scene)
+{
+    overlays.resize(instances.size());
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+        overlays[i].begin(frame);
+    }
+
+    cv::parallel_for_(cv::Range(0, (int)instances.size()), [&](const cv::Range &range)
+                      {
+        for (int i = range.start; i < range.end; i++)
+        {
+            BoardInstance &board = instances[i];
+            if (!board.posed)
+            {
+                continue;
+            }
+            if (axes)
+            {
+                draw3dAxes(overlays[i], camera_matrix, dist_coeff, board.rot, board.trans, scene);
+            }
+            if (objects && !solid)
+            {
+                draw3dObject(overlays[i], camera_matrix, dist_coeff, board.rot, board.trans, scene);
+            }
+        } });
+
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+        BoardInstance &board = instances[i];
+        if (!board.posed)
+        {
+            continue;
+        }
+        if (objects && solid)
+        {
+            drawSolidObject(frame, camera_matrix, dist_coeff, board.rot, board.trans, scene);
+        }
+        overlays[i].end();
+        cv::putText(frame, "#" + std::to_string(board.id), board.center, cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 255, 255), 2);
+    }
+
+    return (0);
+}
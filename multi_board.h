@@ -0,0 +1,77 @@
+/*
+Puja Chaudhury
+multi_board.h
+Detecting several copies of one target in the same frame. Each board that is found is masked out of the processing
+image and the search is repeated, until no further board turns up. Boards keep their id from frame to frame by
+matching each detection to the nearest board of the previous frame; their poses are solved and their overlays
+projected side by side on OpenCV's thread pool.
+*/
+
+#ifndef multi_board_hpp
+#define multi_board_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/calib3d.hpp>
+
+#include "3D_projection.h"
+#include "multi_target.h"
+#include "overlay.h"
+
+// One board in view, followed across frames under the same id
+struct BoardInstance
+{
+    int id;
+    std::vector<cv::Point2f> corners; // frame pixels, refined at full resolution
+    cv::Point2f center;
+    float size;  // diagonal of the corners' bounding box, in pixels
+    int missed;  // frames since the board was last found; 0 when it was found in this frame
+    bool posed;  // rot and trans hold its pose in this frame
+    cv::Mat rot, trans;
+};
+
+class MultiBoardDetector
+{
+public:
+    MultiBoardDetector(const TargetDetector &detector, int maxBoards = 4);
+
+    int detect(const cv::Mat &frame, cv::Size processing);
+    int estimatePoses(cv::Mat &camera_matrix, cv::Mat &dist_coeff);
+    void reset();
+    void printStats();
+
+    // boards found in this frame, followed by boards lost within the last keepMissing frames so they keep their id if they come back
+    std::vector<BoardInstance> instances;
+
+    // searches per frame; the search stops earlier at the first one that finds nothing
+    int maxBoards;
+
+    // frames a lost board keeps its id for
+    int keepMissing;
+
+    // a detection takes over a board's id when its center is within this fraction of the board's size of the board's last center
+    float matchDistance;
+
+    // the object points shared by every board
+    std::vector<cv::Vec3f> points;
+
+private:
+    void match(std::vector<std::vector<cv::Point2f>> &found);
+
+    TargetDetector detector;
+    cv::Mat gray;
+    cv::Mat small;
+    cv::Mat masked;
+    int nextId;
+
+    // frames processed, boards found in them and the time spent searching
+    int frames;
+    int boards;
+    double detectMs;
+};
+
+int drawBoardInstances(cv::Mat &frame, std::vector<BoardInstance> &instances, std::vector<OverlayDrawList> &overlays, cv::Mat &camera_matrix, cv::Mat &dist_coeff, bool axes, bool objects, bool solid, TargetScene &scene);
+
+#endif
@@ -0,0 +1,145 @@
+/*
+Puja Chaudhury
+multi_target.cpp
+Function implementations for detecting any of several registered targets.
+*/
+
+#include "multi_target.h"
+
+MultiTargetDetector::MultiTargetDetector()
+    : lockAfter(5),
+      unlockAfter(15),
+      lockedIndex(-1),
+      candidate(-1),
+      streak(0),
+      misses(0)
+{
+}
+
+/*
+This function registers a target and returns its index. When several targets are found in one frame, the first registered wins.
+ */
+int MultiTargetDetector::add(const TargetDetector &detector)
+{
+    detectors.push_back(detector);
+    return ((int)detectors.size() - 1);
+}
+
+/*
+This function looks for the registered targets in a BGR frame and returns the index of the one found, or -1.
+The frame is converted to grayscale and scaled to the processing size once, and the detectors share that image:
+all of them run in parallel on OpenCV's thread pool, or only the locked one once a target has been locked.
+The returned corners are in frame pixels, refined at full resolution.
+ */
+int MultiTargetDetector::detect(const cv::Mat &frame, cv::Size processing, std::vector<cv::Point2f> &corners)
+{
+    if (frame.channels() == 3)
+    {
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+    }
+    else
+    {
+        gray = frame;
+    }
+    resizeForProcessing(gray, processing.area() > 0 ? processing : gray.size(), small);
+
+    int n = (int)detectors.size();
+    results.resize(n);
+    found.assign(n, 0);
+
+    if (lockedIndex >= 0)
+    {
+        run(lockedIndex);
+    }
+    else
+    {
+        cv::parallel_for_(cv::Range(0, n), [&](const cv::Range &range)
+                          {
+            for (int i = range.start; i < range.end; i++)
+            {
+                run(i);
+            } });
+    }
+
+    int best = -1;
+    for (int i = 0; i < n && best < 0; i++)
+    {
+        best = found[i] ? i : -1;
+    }
+
+    if (best >= 0)
+    {
+        corners = results[best];
+        if (small.size() != gray.size())
+        {
+            scalePoints(corners, small.size(), gray.size());
+            detectors[best].refine(gray, corners);
+        }
+    }
+
+    if (lockedIndex >= 0)
+    {
+        misses = best >= 0 ? 0 : misses + 1;
+        if (misses >= unlockAfter)
+        {
+            printf("Lost the %s, looking for every target again\n", detectors[lockedIndex].name.c_str());
+            unlock();
+        }
+    }
+    else
+    {
+        streak = best >= 0 && best == candidate ? streak + 1 : (best >= 0 ? 1 : 0);
+        candidate = best;
+        if (best >= 0 && streak >= lockAfter)
+        {
+            lockedIndex = best;
+            misses = 0;
+            printf("Locked onto the %s\n", detectors[best].name.c_str());
+        }
+    }
+
+    return (best);
+}
+
+/*
+This function returns the index of the locked target, or -1 while every detector is running.
+ */
+int MultiTargetDetector::locked() const
+{
+    return (lockedIndex);
+}
+
+void MultiTargetDetector::unlock()
+{
+    lockedIndex = -1;
+    candidate = -1;
+    streak = 0;
+    misses = 0;
+}
+
+void MultiTargetDetector::printStats()
+{
+    for (size_t i = 0; i < detectors.size(); i++)
+    {
+        const TargetDetector &d = detectors[i];
+        if (d.runs == 0)
+        {
+            continue;
+        }
+        printf("%s: found in %d/%d frames (%.1f%%), %.2f ms per run\n",
+               d.name.c_str(), d.hits, d.runs, 100.0 * d.hits / d.runs, d.detectMs / d.runs);
+    }
+}
+
+/*
+This function runs one detector on the shared processing image. Each detector only writes its own slots, so they can run side by side.
+ */
+void MultiTargetDetector::run(int index)
+{
+    TargetDetector &d = detectors[index];
+    double start = (double)cv::getTickCount();
+    found[index] = d.find(small, results[index]) ? 1 : 0;
+    d.detectMs += ((double)cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+    d.runs++;
+    d.hits += found[index];
+}
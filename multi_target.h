@@ -0,0 +1,90 @@
+/*
+Puja Chaudhury
+multi_target.h
+Recognising whichever registered target is in view. Every detector runs concurrently on one shared grayscale frame
+until the same target has been seen for a few frames; from then on only that target's detector runs until it is lost.
+*/
+
+#ifndef multi_target_hpp
+#define multi_target_hpp
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "board.h"
+#include "resolution.h"
+
+// One kind of target: how to find it, where its points lie on the board and which calibration goes with it
+struct TargetDetector
+{
+    std::string name;
+    std::string calibrationFile;
+    cv::Size patternSize;
+    bool (*find)(cv::Mat &src, std::vector<cv::Point2f> &corners);
+    void (*refine)(cv::Mat &src, std::vector<cv::Point2f> &corners);
+    void (*objectPoints)(std::vector<cv::Vec3f> &dst);
+
+    // frames the detector ran on and found its target in, and the time it spent
+    int runs;
+    int hits;
+    double detectMs;
+};
+
+/*
+This function builds the detector entry for the target described by Board.
+ */
+template <typename Board>
+TargetDetector makeTargetDetector(std::string name, std::string calibrationFile)
+{
+    TargetDetector detector;
+    detector.name = name;
+    detector.calibrationFile = calibrationFile;
+    detector.patternSize = Board::patternSize();
+    detector.find = &Board::find;
+    detector.refine = &Board::refine;
+    detector.objectPoints = static_cast<void (*)(std::vector<cv::Vec3f> &)>(&Board::objectPoints);
+    detector.runs = 0;
+    detector.hits = 0;
+    detector.detectMs = 0;
+    return (detector);
+}
+
+class MultiTargetDetector
+{
+public:
+    MultiTargetDetector();
+
+    int add(const TargetDetector &detector);
+
+    int detect(const cv::Mat &frame, cv::Size processing, std::vector<cv::Point2f> &corners);
+
+    int locked() const;
+    void unlock();
+    void printStats();
+
+    std::vector<TargetDetector> detectors;
+
+    // consecutive frames one target must be found in before the other detectors stop running
+    int lockAfter;
+
+    // consecutive frames the locked target may be missing before every detector runs again
+    int unlockAfter;
+
+private:
+    void run(int index);
+
+    cv::Mat gray;
+    cv::Mat small;
+    std::vector<std::vector<cv::Point2f>> results;
+    std::vector<uchar> found;
+
+    int lockedIndex;
+    int candidate;
+    int streak;
+    int misses;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+Puja Chaudhury
+overlay.cpp
+Function implementations for the batched overlay draw list.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "overlay.h"
+
+OverlayDrawList::OverlayDrawList(int stripHeight)
+    : immediate(false),
+      numSegments(0),
+      numStyles(0),
+      stripHeight(stripHeight)
+{
+}
+
+/*
+This function starts collecting the overlay for a new frame. The batches keep their storage between frames.
+ */
+int OverlayDrawList::begin(cv::Mat &frame)
+{
+    target = frame;
+    for (size_t i = 0; i < batches.size(); i++)
+    {
+        batches[i].points.clear();
+        batches[i].rows.clear();
+    }
+    numSegments = 0;
+    numStyles = 0;
+
+    return (0);
+}
+
+cv::Size OverlayDrawList::size() const
+{
+    return (target.size());
+}
+
+/*
+This function queues one line segment in the batch for its colour and thickness.
+End points are rounded to whole pixels here, as cv::line does.
+ */
+void OverlayDrawList::addLine(cv::Point2f a, cv::Point2f b, const cv::Scalar &color, int thickness)
+{
+    cv::Point p0(cvRound(a.x), cvRound(a.y));
+    cv::Point p1(cvRound(b.x), cvRound(b.y));
+    numSegments++;
+
+    if (immediate)
+    {
+        cv::line(target, p0, p1, color, thickness);
+        return;
+    }
+
+    size_t i = 0;
+    while (i < batches.size() && !(batches[i].color == color && batches[i].thickness == thickness))
+    {
+        i++;
+    }
+    if (i == batches.size())
+    {
+        batches.push_back(Batch());
+        batches[i].color = color;
+        batches[i].thickness = thickness;
+    }
+
+    Batch &batch = batches[i];
+    batch.points.push_back(p0);
+    batch.points.push_back(p1);
+    batch.rows.push_back(cv::Vec2i(std::min(p0.y, p1.y) - thickness, std::max(p0.y, p1.y) + thickness));
+}
+
+/*
+This function queues an arrow as its shaft and the two strokes of its tip, with the same geometry as cv::arrowedLine.
+ */
+void OverlayDrawList::addArrow(cv::Point2f from, cv::Point2f to, const cv::Scalar &color, int thickness, double tipLength)
+{
+    cv::Point p0(cvRound(from.x), cvRound(from.y));
+    cv::Point p1(cvRound(to.x), cvRound(to.y));
+    double tipSize = cv::norm(p0 - p1) * tipLength;
+    double angle = std::atan2((double)p0.y - p1.y, (double)p0.x - p1.x);
+
+    addLine(p0, p1, color, thickness);
+    addLine(cv::Point2f((float)cvRound(p1.x + tipSize * std::cos(angle + CV_PI / 4)), (float)cvRound(p1.y + tipSize * std::sin(angle + CV_PI / 4))), p1, color, thickness);
+    addLine(cv::Point2f((float)cvRound(p1.x + tipSize * std::cos(angle - CV_PI / 4)), (float)cvRound(p1.y + tipSize * std::sin(angle - CV_PI / 4))), p1, color, thickness);
+}
+
+/*
+This function draws every segment that can touch one horizontal strip of the frame. Each batch becomes a single
+cv::polylines call on the strip, so clipping and setup happen once per style instead of once per segment.
+ */
+void OverlayDrawList::renderStrip(int strip)
+{
+    int y0 = strip * stripHeight;
+    int y1 = std::min(y0 + stripHeight, target.rows);
+    cv::Mat region = target.rowRange(y0, y1);
+
+    std::vector<cv::Point> shifted;
+    std::vector<const cv::Point *> contours;
+    std::vector<int> counts;
+    for (size_t b = 0; b < batches.size(); b++)
+    {
+        const Batch &batch = batches[b];
+        shifted.clear();
+        for (size_t s = 0; s < batch.rows.size(); s++)
+        {
+            if (batch.rows[s][1] < y0 || batch.rows[s][0] >= y1)
+            {
+                continue;
+            }
+            shifted.push_back(batch.points[2 * s] - cv::Point(0, y0));
+            shifted.push_back(batch.points[2 * s + 1] - cv::Point(0, y0));
+        }
+        if (shifted.empty())
+        {
+            continue;
+        }
+
+        // pointers are taken only once shifted has stopped growing
+        contours.resize(shifted.size() / 2);
+        counts.assign(shifted.size() / 2, 2);
+        for (size_t s = 0; s < contours.size(); s++)
+        {
+            contours[s] = &shifted[2 * s];
+        }
+        cv::polylines(region, contours.data(), counts.data(), (int)contours.size(), false, batch.color, batch.thickness);
+    }
+}
+
+/*
+This function rasterizes the queued segments onto the frame, with the strips drawn in parallel.
+All segments of one style are drawn together, in the order the styles first appeared, so crossing lines of different
+colours can stack differently than when every line was drawn as it was added.
+ */
+int OverlayDrawList::end()
+{
+    for (size_t i = 0; i < batches.size(); i++)
+    {
+        numStyles += batches[i].rows.empty() ? 0 : 1;
+    }
+
+    if (!immediate && numSegments > 0)
+    {
+        int strips = (target.rows + stripHeight - 1) / stripHeight;
+        cv::parallel_for_(cv::Range(0, strips), [&](const cv::Range &range)
+                          {
+            for (int i = range.start; i < range.end; i++)
+            {
+                renderStrip(i);
+            } });
+    }
+
+    target = cv::Mat();
+
+    return (0);
+}
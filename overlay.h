@@ -0,0 +1,53 @@
+/*
+Puja Chaudhury
+overlay.h
+A per-frame draw list for the line overlays (axes and wireframe objects).
+Projected segments are collected and grouped by colour and thickness, then rasterized together in one pass
+that splits the frame into horizontal strips and draws the strips in parallel.
+*/
+
+#ifndef overlay_hpp
+#define overlay_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+class OverlayDrawList
+{
+public:
+    OverlayDrawList(int stripHeight = 64);
+
+    int begin(cv::Mat &frame);
+    void addLine(cv::Point2f a, cv::Point2f b, const cv::Scalar &color, int thickness);
+    void addArrow(cv::Point2f from, cv::Point2f to, const cv::Scalar &color, int thickness, double tipLength = 0.1);
+    int end();
+
+    // size of the frame being drawn on
+    cv::Size size() const;
+
+    // draw every segment as soon as it is added with its own cv::line call, the way overlays used to be drawn
+    bool immediate;
+
+    // segments and styles in the last frame
+    int numSegments;
+    int numStyles;
+
+private:
+    struct Batch
+    {
+        cv::Scalar color;
+        int thickness;
+        std::vector<cv::Point> points; // two per segment
+        std::vector<cv::Vec2i> rows;   // first and last image row each segment can touch
+    };
+
+    void renderStrip(int strip);
+
+    int stripHeight;
+    cv::Mat target;
+    std::vector<Batch> batches;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+Puja Chaudhury
+overlay_layer.cpp
+Function implementations for the cached overlay layer.
+*/
+
+#include <cstdio>
+
+#include <opencv2/calib3d.hpp>
+
+#include "overlay_layer.h"
+#include "compositor.h"
+
+// true when both matrices hold the same values
+static bool sameMat(const cv::Mat &a, const cv::Mat &b)
+{
+    if (a.size() != b.size() || a.type() != b.type())
+    {
+        return (false);
+    }
+    return (a.empty() || cv::norm(a, b, cv::NORM_INF) == 0);
+}
+
+OverlayLayer::OverlayLayer(double rotationThreshold, double translationThreshold)
+    : rotationThreshold(rotationThreshold),
+      translationThreshold(translationThreshold),
+      renderInterval(1),
+      renderedFrames(0),
+      reusedFrames(0),
+      valid(false),
+      scene(0),
+      framesSinceRender(0)
+{
+}
+
+/*
+This function decides whether the layer has to be drawn again. The cached layer is kept while the calibration, frame size
+and scene are unchanged and the pose has rotated and moved by no more than the thresholds since it was drawn, so the
+jitter of a still target does not cause redraws. With a renderInterval above 1, the layer is also kept without looking at
+the pose until that many frames have passed since it was drawn. When it returns true the new state is taken as the layer's, and the
+caller draws on beginRender's canvas and finishes with endRender.
+ */
+bool OverlayLayer::needsRender(const cv::Mat &camera_matrix, const cv::Mat &dist_coeff, const cv::Mat &rot, const cv::Mat &trans, cv::Size size, int scene)
+{
+    if (valid && size == this->size && scene == this->scene && sameMat(camera_matrix, cameraMatrix) && sameMat(dist_coeff, distCoeff))
+    {
+        if (++framesSinceRender < renderInterval)
+        {
+            reusedFrames++;
+            return (false);
+        }
+
+        // the angle of the rotation between the two poses
+        cv::Mat r0, r1, delta;
+        cv::Rodrigues(this->rot, r0);
+        cv::Rodrigues(rot, r1);
+        cv::Rodrigues(r1 * r0.t(), delta);
+        double rotation = cv::norm(delta) * 180.0 / CV_PI;
+        double translation = cv::norm(trans, this->trans);
+
+        if (rotation <= rotationThreshold && translation <= translationThreshold)
+        {
+            reusedFrames++;
+            return (false);
+        }
+    }
+
+    camera_matrix.copyTo(cameraMatrix);
+    dist_coeff.copyTo(distCoeff);
+    rot.copyTo(this->rot);
+    trans.copyTo(this->trans);
+    this->size = size;
+    this->scene = scene;
+    valid = false;
+    framesSinceRender = 0;
+
+    return (true);
+}
+
+/*
+This function returns the black canvas the axes and objects are drawn on. Only the region the previous drawing covered
+is cleared, the rest of the canvas is still black.
+ */
+cv::Mat &OverlayLayer::beginRender()
+{
+    if (canvas.size() != size)
+    {
+        canvas = cv::Mat::zeros(size, CV_8UC3);
+        bounds = cv::Rect();
+    }
+    else if (!bounds.empty())
+    {
+        canvas(bounds).setTo(cv::Scalar::all(0));
+    }
+
+    return (canvas);
+}
+
+/*
+This function turns the canvas into the cached layer. Every pixel that is not black is covered by the drawing;
+the layer keeps only the rectangle around the covered pixels, with the coverage as its alpha channel.
+Content drawn in pure black is therefore transparent.
+ */
+int OverlayLayer::endRender()
+{
+    cv::inRange(canvas, cv::Scalar::all(0), cv::Scalar::all(0), mask);
+    cv::bitwise_not(mask, mask);
+    bounds = cv::boundingRect(mask);
+
+    if (!bounds.empty())
+    {
+        cv::cvtColor(canvas(bounds), layer, cv::COLOR_BGR2BGRA);
+        cv::Mat alpha = mask(bounds);
+        int fromTo[] = {0, 3};
+        cv::mixChannels(&alpha, 1, &layer, 1, fromTo, 1);
+    }
+
+    valid = true;
+    renderedFrames++;
+
+    return (0);
+}
+
+/*
+This function blends the cached layer onto a camera frame of the size it was drawn for.
+Only the rows and columns the drawing covers are touched.
+ */
+int OverlayLayer::composite(cv::Mat &frame)
+{
+    if (!valid || frame.size() != size || frame.type() != CV_8UC3)
+    {
+        return (-1);
+    }
+
+    for (int y = 0; y < bounds.height; y++)
+    {
+        compositeRow(frame.ptr<uchar>(bounds.y + y) + 3 * bounds.x, layer.ptr<uchar>(y), NULL, bounds.width);
+    }
+
+    return (0);
+}
+
+/*
+This function drops the cached layer, so the next frame draws it again.
+ */
+void OverlayLayer::invalidate()
+{
+    valid = false;
+}
+
+void OverlayLayer::printStats()
+{
+    int frames = renderedFrames + reusedFrames;
+    if (frames == 0)
+    {
+        return;
+    }
+    printf("Overlay layer: drawn on %d frames, reused on %d (%.1f%%)\n", renderedFrames, reusedFrames, 100.0 * reusedFrames / frames);
+}
@@ -0,0 +1,52 @@
+/*
+Puja Chaudhury
+overlay_layer.h
+A cached layer of virtual content. The axes and objects are drawn once into a layer of their own, kept as premultiplied
+BGRA with its coverage mask, and only drawn again when the pose, the calibration, the frame size or the scene changes.
+Every other frame just blends the kept layer onto the new camera frame.
+*/
+
+#ifndef overlay_layer_hpp
+#define overlay_layer_hpp
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+class OverlayLayer
+{
+public:
+    OverlayLayer(double rotationThreshold = 0.1, double translationThreshold = 0.01);
+
+    bool needsRender(const cv::Mat &camera_matrix, const cv::Mat &dist_coeff, const cv::Mat &rot, const cv::Mat &trans, cv::Size size, int scene);
+    cv::Mat &beginRender();
+    int endRender();
+    int composite(cv::Mat &frame);
+    void invalidate();
+    void printStats();
+
+    // largest change of the rotation, in degrees, and of the translation, in board units, that keeps the cached layer
+    double rotationThreshold;
+    double translationThreshold;
+
+    // the pose is compared with the layer's only on every renderInterval-th frame, so a moving target redraws less often
+    int renderInterval;
+
+    // frames the layer was drawn for, and frames it was reused on
+    int renderedFrames;
+    int reusedFrames;
+
+private:
+    cv::Mat canvas; // BGR, black wherever nothing was drawn
+    cv::Mat layer;  // premultiplied BGRA of the drawn region
+    cv::Mat mask;   // coverage of the whole frame
+    cv::Rect bounds;
+    bool valid;
+
+    // what the layer was drawn for
+    cv::Mat cameraMatrix, distCoeff, rot, trans;
+    cv::Size size;
+    int scene;
+    int framesSinceRender;
+};
+
+#endif
@@ -0,0 +1,191 @@
+/*
+Puja Chaudhury
+
+This is a CPP program that subscribes to the pose stream of a program started with --pose-port <port> and measures
+how long poses take to arrive: from being handed to the server, and from the capture of their frame.
+With --serve it runs a server of its own that publishes synthetic poses at the given rate, to measure the stream alone.
+Usage: pose_client [port] [seconds] [--serve <poses per second> [batch size]]
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <opencv2/core.hpp>
+
+#include "capture.h"
+#include "pose_server.h"
+
+/*
+This function publishes synthetic poses at a fixed rate until told to stop, standing in for the AR loop.
+ */
+static void servePoses(int port, double rate, int batchSize, const std::atomic<bool> &running)
+{
+    PoseServer server(batchSize);
+    if (server.open(port) != 0)
+    {
+        return;
+    }
+
+    cv::Mat rot = (cv::Mat_<double>(3, 1) << 2.6, 0.2, 0);
+    cv::Mat trans = (cv::Mat_<double>(3, 1) << -4, -1, 14);
+    uint64_t frameId = 0;
+    double start = captureClock();
+    while (running)
+    {
+        double due = start + frameId / rate;
+        double wait = due - captureClock();
+        if (wait > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+        }
+        server.publish(frameId++, captureClock(), rot, trans, 0, 0.25f, true);
+    }
+    server.printStats();
+}
+
+static void subscribe(int fd, const sockaddr_in &server, uint32_t command)
+{
+    PoseSubscribe request;
+    request.magic = POSE_SUBSCRIBE_MAGIC;
+    request.command = command;
+    sendto(fd, &request, sizeof(request), 0, (const sockaddr *)&server, sizeof(server));
+}
+
+// the given percentile of sorted samples
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return (0);
+    }
+    return (sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))]);
+}
+
+int main(int argc, char *argv[])
+{
+    int port = argc > 1 ? std::stoi(argv[1]) : 5005;
+    double seconds = argc > 2 ? std::stod(argv[2]) : 10;
+    double serveRate = 0;
+    int batchSize = 1;
+    for (int i = 3; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--serve" && i + 1 < argc)
+        {
+            serveRate = std::stod(argv[++i]);
+            if (i + 1 < argc)
+            {
+                batchSize = std::stoi(argv[++i]);
+            }
+        }
+    }
+
+    std::atomic<bool> running(true);
+    std::thread serving;
+    if (serveRate > 0)
+    {
+        serving = std::thread(servePoses, port, serveRate, batchSize, std::cref(running));
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || bind(fd, (sockaddr *)&local, sizeof(local)) != 0)
+    {
+        printf("Unable to open a socket for the pose stream\n");
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        running = false;
+        if (serving.joinable())
+        {
+            serving.join();
+        }
+        return (-1);
+    }
+    sockaddr_in server = local;
+    server.sin_port = htons((uint16_t)port);
+
+    std::vector<PoseMessage> batch(64);
+    std::vector<double> publishLatency;
+    std::vector<double> captureLatency;
+    uint64_t datagrams = 0;
+    uint64_t missed = 0;
+    uint64_t nextFrame = 0;
+    bool first = true;
+
+    double start = captureClock();
+    double lastSubscribe = -1;
+    while (captureClock() - start < seconds)
+    {
+        // renew the subscription every second, well within the server's timeout
+        double now = captureClock();
+        if (now - lastSubscribe >= 1.0)
+        {
+            subscribe(fd, server, 1);
+            lastSubscribe = now;
+        }
+
+        pollfd wait = {fd, POLLIN, 0};
+        if (poll(&wait, 1, 100) <= 0)
+        {
+            continue;
+        }
+        ssize_t bytes = recv(fd, batch.data(), batch.size() * sizeof(PoseMessage), 0);
+        double received = captureClock();
+        if (bytes <= 0 || bytes % sizeof(PoseMessage) != 0)
+        {
+            continue;
+        }
+
+        datagrams++;
+        for (size_t i = 0; i < bytes / sizeof(PoseMessage); i++)
+        {
+            const PoseMessage &message = batch[i];
+            if (message.magic != POSE_MESSAGE_MAGIC || message.version != POSE_PROTOCOL_VERSION)
+            {
+                continue;
+            }
+            if (!first && message.frameId > nextFrame)
+            {
+                missed += message.frameId - nextFrame;
+            }
+            first = false;
+            nextFrame = message.frameId + 1;
+
+            publishLatency.push_back((received - message.publishTime) * 1e6);
+            captureLatency.push_back((received - message.timestamp) * 1e6);
+        }
+    }
+
+    subscribe(fd, server, 0);
+    close(fd);
+    running = false;
+    if (serving.joinable())
+    {
+        serving.join();
+    }
+
+    std::sort(publishLatency.begin(), publishLatency.end());
+    std::sort(captureLatency.begin(), captureLatency.end());
+    printf("Received %d poses in %llu datagrams, %llu frames missed\n", (int)publishLatency.size(), (unsigned long long)datagrams, (unsigned long long)missed);
+    printf("publish to receive: median %.1f us, 99th percentile %.1f us, max %.1f us\n",
+           percentile(publishLatency, 0.5), percentile(publishLatency, 0.99), percentile(publishLatency, 1.0));
+    printf("capture to receive: median %.1f us, 99th percentile %.1f us, max %.1f us\n",
+           percentile(captureLatency, 0.5), percentile(captureLatency, 0.99), percentile(captureLatency, 1.0));
+
+    return (0);
+}
@@ -0,0 +1,210 @@
+/*
+Puja Chaudhury
+pose_server.cpp
+Function implementations for the UDP pose stream.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "pose_server.h"
+#include "capture.h"
+
+// a datagram of poses stays well inside what the loopback interface takes in one piece
+static const int MAX_BATCH = 64;
+
+PoseServer::PoseServer(int batchSize, double subscriberTimeout)
+    : batchSize(batchSize),
+      subscriberTimeout(subscriberTimeout),
+      sentDatagrams(0),
+      droppedDatagrams(0),
+      fd(-1)
+{
+}
+
+PoseServer::~PoseServer()
+{
+    close();
+}
+
+/*
+This function binds the server to the given port on 127.0.0.1, so only processes on this host can subscribe.
+ */
+int PoseServer::open(int port)
+{
+    close();
+
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        printf("Unable to create the pose socket\n");
+        return (-1);
+    }
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (sockaddr *)&address, sizeof(address)) != 0 || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) != 0)
+    {
+        printf("Unable to listen for pose subscribers on port %d: %s\n", port, strerror(errno));
+        ::close(fd);
+        fd = -1;
+        return (-1);
+    }
+
+    return (0);
+}
+
+/*
+This function sends whatever is still batched and closes the socket.
+ */
+void PoseServer::close()
+{
+    if (fd < 0)
+    {
+        return;
+    }
+    flush();
+    ::close(fd);
+    fd = -1;
+    subscribers.clear();
+}
+
+bool PoseServer::isOpen() const
+{
+    return (fd >= 0);
+}
+
+/*
+This function takes in whatever subscribe and unsubscribe messages have arrived, without waiting for any,
+and forgets subscribers that have not renewed within the timeout.
+ */
+void PoseServer::pollSubscribers(double now)
+{
+    PoseSubscribe request;
+    sockaddr_in from;
+    socklen_t length = sizeof(from);
+    ssize_t received;
+    while ((received = recvfrom(fd, &request, sizeof(request), 0, (sockaddr *)&from, &length)) >= 0)
+    {
+        length = sizeof(from);
+        // a stray datagram of another size is skipped, and the requests queued behind it are still read
+        if (received != (ssize_t)sizeof(request) || request.magic != POSE_SUBSCRIBE_MAGIC)
+        {
+            continue;
+        }
+
+        size_t i = 0;
+        while (i < subscribers.size() && !(subscribers[i].address.sin_port == from.sin_port && subscribers[i].address.sin_addr.s_addr == from.sin_addr.s_addr))
+        {
+            i++;
+        }
+        if (request.command == 0)
+        {
+            if (i < subscribers.size())
+            {
+                subscribers.erase(subscribers.begin() + i);
+            }
+            continue;
+        }
+        if (i == subscribers.size())
+        {
+            subscribers.push_back(Subscriber());
+            subscribers[i].address = from;
+        }
+        subscribers[i].lastSeen = now;
+    }
+
+    for (size_t i = subscribers.size(); i-- > 0;)
+    {
+        if (now - subscribers[i].lastSeen > subscriberTimeout)
+        {
+            subscribers.erase(subscribers.begin() + i);
+        }
+    }
+}
+
+/*
+This function queues the pose of one frame, rotation and translation as solvePnP returns them, and sends the batch
+once it holds batchSize poses. A frame without a pose is still sent, without the POSE_VALID flag, so subscribers can
+tell a lost target from a stalled stream.
+ */
+int PoseServer::publish(uint64_t frameId, double timestamp, const cv::Mat &rot, const cv::Mat &trans, int targetId, float quality, bool valid)
+{
+    if (fd < 0)
+    {
+        return (-1);
+    }
+
+    PoseMessage message;
+    memset(&message, 0, sizeof(message));
+    message.magic = POSE_MESSAGE_MAGIC;
+    message.version = POSE_PROTOCOL_VERSION;
+    message.targetId = (uint16_t)targetId;
+    message.frameId = frameId;
+    message.timestamp = timestamp;
+    message.publishTime = captureClock();
+    message.quality = valid ? quality : -1;
+    message.flags = valid && rot.total() == 3 && trans.total() == 3 ? POSE_VALID : 0;
+    for (int i = 0; i < 3 && message.flags != 0; i++)
+    {
+        message.rvec[i] = rot.at<double>(i);
+        message.tvec[i] = trans.at<double>(i);
+    }
+    pending.push_back(message);
+
+    if ((int)pending.size() >= std::min(std::max(batchSize, 1), MAX_BATCH))
+    {
+        return (flush());
+    }
+
+    return (0);
+}
+
+/*
+This function sends the batched poses to every subscriber as one datagram. A subscriber whose receive buffer is full
+misses the datagram rather than holding up the sender.
+ */
+int PoseServer::flush()
+{
+    if (fd < 0 || pending.empty())
+    {
+        return (0);
+    }
+
+    pollSubscribers(captureClock());
+    size_t bytes = pending.size() * sizeof(PoseMessage);
+    for (size_t i = 0; i < subscribers.size(); i++)
+    {
+        if (sendto(fd, pending.data(), bytes, MSG_DONTWAIT, (sockaddr *)&subscribers[i].address, sizeof(sockaddr_in)) == (ssize_t)bytes)
+        {
+            sentDatagrams++;
+        }
+        else
+        {
+            droppedDatagrams++;
+        }
+    }
+    pending.clear();
+
+    return (0);
+}
+
+void PoseServer::printStats()
+{
+    if (fd < 0)
+    {
+        return;
+    }
+    printf("Pose server: %llu datagrams sent, %llu dropped, %d subscribers\n",
+           (unsigned long long)sentDatagrams, (unsigned long long)droppedDatagrams, (int)subscribers.size());
+}
@@ -0,0 +1,98 @@
+/*
+Puja Chaudhury
+pose_server.h
+Streaming the estimated pose to other processes on this host over UDP on the loopback interface. Every frame becomes
+one fixed-size PoseMessage, and several can be sent together in one datagram. A subscriber registers by sending a
+PoseSubscribe datagram to the server's port and repeats it every second or so; subscribers that fall silent are dropped.
+The socket is non-blocking, and messages a subscriber's buffer cannot take are dropped, so the frame loop never waits.
+*/
+
+#ifndef pose_server_hpp
+#define pose_server_hpp
+
+#include <cstdint>
+#include <vector>
+
+#include <netinet/in.h>
+
+#include <opencv2/core.hpp>
+
+static const uint32_t POSE_MESSAGE_MAGIC = 0x53505241; // "ARPS" in little-endian order
+static const uint32_t POSE_SUBSCRIBE_MAGIC = 0x42535241; // "ARSB"
+static const uint16_t POSE_PROTOCOL_VERSION = 1;
+
+// One frame's pose, in host byte order; both ends run on the same machine
+struct PoseMessage
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t targetId;
+    uint64_t frameId;
+    double timestamp;   // capture time of the frame, on captureClock
+    double publishTime; // when the pose was handed to the server, on the same clock
+    double rvec[3];
+    double tvec[3];
+    float quality;  // RMS reprojection error in pixels, negative when not known
+    uint32_t flags; // POSE_VALID when the target was found
+};
+
+static const uint32_t POSE_VALID = 1;
+
+// targetId of each target
+static const uint16_t POSE_TARGET_CHESSBOARD = 0;
+static const uint16_t POSE_TARGET_CIRCLE_GRID = 1;
+static const uint16_t POSE_TARGET_CHARUCO = 2;
+static const uint16_t POSE_TARGET_IMAGE = 3;
+
+// Sent by a subscriber to the server's port: command 1 subscribes or renews, 0 unsubscribes
+struct PoseSubscribe
+{
+    uint32_t magic;
+    uint32_t command;
+};
+
+static_assert(sizeof(PoseMessage) == 88, "PoseMessage is a fixed wire format");
+static_assert(sizeof(PoseSubscribe) == 8, "PoseSubscribe is a fixed wire format");
+
+class PoseServer
+{
+public:
+    PoseServer(int batchSize = 1, double subscriberTimeout = 5.0);
+    ~PoseServer();
+
+    int open(int port);
+    void close();
+    bool isOpen() const;
+
+    int publish(uint64_t frameId, double timestamp, const cv::Mat &rot, const cv::Mat &trans, int targetId, float quality, bool valid);
+    int flush();
+    void printStats();
+
+    // poses per datagram; 1 sends every pose as soon as it is published
+    int batchSize;
+
+    // seconds after its last subscribe message that a subscriber is dropped
+    double subscriberTimeout;
+
+    // datagrams sent, and datagrams dropped because a subscriber's socket buffer was full
+    uint64_t sentDatagrams;
+    uint64_t droppedDatagrams;
+
+private:
+    PoseServer(const PoseServer &);
+    PoseServer &operator=(const PoseServer &);
+
+    struct Subscriber
+    {
+        sockaddr_in address;
+        double lastSeen;
+    };
+
+    void pollSubscribers(double now);
+
+    int fd;
+    std::vector<Subscriber> subscribers;
+    std::vector<PoseMessage> pending;
+};
+
+#endif
@@ -0,0 +1,209 @@
+/*
+Puja Chaudhury
+primitives.cpp
+Function implementations for culling, tessellating and drawing the built-in virtual objects.
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "primitives.h"
+#include "quality_controller.h"
+
+// tessellation limits for round objects; the upper limit is the fixed tessellation the objects used to be drawn with,
+// and the quality settings may lower it
+static const int minSegments = 6;
+static const int maxSegments = 20;
+
+static int segmentLimit()
+{
+    return (std::max(minSegments, std::min(maxSegments, qualitySettings().maxSegments)));
+}
+
+/*
+This function describes a virtual object. Its mesh is built on first use at the level of detail the current view needs.
+ */
+Primitive makePrimitive(PrimitiveShape shape, cv::Point3f center, float radius, float height, cv::Vec3b color)
+{
+    Primitive primitive;
+    primitive.shape = shape;
+    primitive.center = center;
+    primitive.radius = radius;
+    primitive.height = height;
+    primitive.color = color;
+    primitive.segments = 0;
+    return (primitive);
+}
+
+/*
+This function returns a sphere enclosing the object, in board coordinates.
+ */
+BoundingSphere primitiveBounds(const Primitive &primitive)
+{
+    BoundingSphere bounds;
+    switch (primitive.shape)
+    {
+    case PrimitivePyramid:
+        bounds.center = cv::Point3f(primitive.center.x, primitive.center.y, primitive.center.z + primitive.height / 2);
+        bounds.radius = std::sqrt(2 * primitive.radius * primitive.radius + primitive.height * primitive.height / 4);
+        break;
+    case PrimitiveCylinder:
+        bounds.center = primitive.center;
+        bounds.radius = std::sqrt(primitive.radius * primitive.radius + primitive.height * primitive.height / 4);
+        break;
+    default:
+        bounds.center = primitive.center;
+        bounds.radius = primitive.radius;
+        break;
+    }
+    return (bounds);
+}
+
+/*
+This function generates the wireframe of an object as points and the pairs of point indices joined by lines.
+ */
+static void wireframe(const Primitive &primitive, int segments, std::vector<cv::Vec3f> &points, std::vector<cv::Vec2i> &edges)
+{
+    const cv::Point3f &c = primitive.center;
+    float r = primitive.radius;
+    points.clear();
+    edges.clear();
+
+    if (primitive.shape == PrimitivePyramid)
+    {
+        points.push_back(cv::Vec3f(c.x, c.y, c.z + primitive.height)); // apex
+        points.push_back(cv::Vec3f(c.x + r, c.y + r, c.z));           // tr
+        points.push_back(cv::Vec3f(c.x + r, c.y - r, c.z));           // br
+        points.push_back(cv::Vec3f(c.x - r, c.y - r, c.z));           // bl
+        points.push_back(cv::Vec3f(c.x - r, c.y + r, c.z));           // tl
+        for (int i = 1; i <= 4; i++)
+        {
+            edges.push_back(cv::Vec2i(0, i));
+            edges.push_back(cv::Vec2i(i, i % 4 + 1));
+        }
+    }
+    else if (primitive.shape == PrimitiveCylinder)
+    {
+        // bottom ring, then top ring
+        float h = primitive.height / 2;
+        for (int k = 0; k < 2; k++)
+        {
+            for (int j = 0; j < segments; j++)
+            {
+                float phi = (float)j / (float)segments * 2 * CV_PI;
+                points.push_back(cv::Vec3f(c.x + r * std::cos(phi), c.y + r * std::sin(phi), k == 0 ? c.z - h : c.z + h));
+            }
+        }
+        for (int j = 0; j < segments; j++)
+        {
+            edges.push_back(cv::Vec2i(j, (j + 1) % segments));
+            edges.push_back(cv::Vec2i(segments + j, segments + (j + 1) % segments));
+            edges.push_back(cv::Vec2i(j, segments + j));
+        }
+    }
+    else
+    {
+        // rings of latitude from the top pole down, each with one point per meridian
+        for (int i = 0; i <= segments; i++)
+        {
+            float theta = (float)i / (float)segments * CV_PI;
+            for (int j = 0; j < segments; j++)
+            {
+                float phi = (float)j / (float)segments * 2 * CV_PI;
+                points.push_back(cv::Vec3f(c.x + r * std::sin(theta) * std::cos(phi),
+                                           c.y + r * std::sin(theta) * std::sin(phi),
+                                           c.z + r * std::cos(theta)));
+            }
+        }
+        for (int i = 0; i < segments; i++)
+        {
+            for (int j = 0; j < segments; j++)
+            {
+                if (i > 0)
+                {
+                    edges.push_back(cv::Vec2i(i * segments + j, i * segments + (j + 1) % segments));
+                }
+                edges.push_back(cv::Vec2i(i * segments + j, (i + 1) * segments + j));
+            }
+        }
+    }
+}
+
+/*
+This function queues one object's wireframe on the overlay. Objects outside the view are skipped before anything is generated or projected,
+round objects get only as many segments as their size on screen needs, and lines to points behind the camera are left out.
+ */
+int drawWirePrimitive(OverlayDrawList &overlay, const ViewFrustum &frustum, const Primitive &primitive, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans)
+{
+    float screenRadius;
+    bool crossesNear;
+    if (!sphereVisible(frustum, primitiveBounds(primitive), screenRadius, crossesNear))
+    {
+        return (0);
+    }
+
+    std::vector<cv::Vec3f> points;
+    std::vector<cv::Vec2i> edges;
+    std::vector<cv::Point2f> corners;
+    std::vector<uchar> inFront;
+
+    wireframe(primitive, levelOfDetail(screenRadius, minSegments, segmentLimit()), points, edges);
+    cv::projectPoints(points, rot, trans, camera_matrix, dist_coeff, corners);
+    if (crossesNear)
+    {
+        markInFront(frustum, points, inFront);
+    }
+
+    cv::Scalar color(primitive.color[0], primitive.color[1], primitive.color[2]);
+    int thickness = qualitySettings().lineThickness(3);
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        if (crossesNear && !(inFront[edges[i][0]] && inFront[edges[i][1]]))
+        {
+            continue;
+        }
+        overlay.addLine(corners[edges[i][0]], corners[edges[i][1]], color, thickness);
+    }
+
+    return (0);
+}
+
+/*
+This function queues the visible objects on the rasterizer. Each round object's mesh is re-tessellated
+when its size on screen calls for a different number of segments than last time.
+ */
+int drawSolidPrimitives(Rasterizer &rasterizer, const ViewFrustum &frustum, std::vector<Primitive> &primitives, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans)
+{
+    for (size_t i = 0; i < primitives.size(); i++)
+    {
+        Primitive &p = primitives[i];
+        float screenRadius;
+        bool crossesNear;
+        if (!sphereVisible(frustum, primitiveBounds(p), screenRadius, crossesNear))
+        {
+            continue;
+        }
+
+        int segments = p.shape == PrimitivePyramid ? 4 : levelOfDetail(screenRadius, minSegments, segmentLimit());
+        if (segments != p.segments)
+        {
+            switch (p.shape)
+            {
+            case PrimitivePyramid:
+                makePyramid(p.mesh, p.center, p.radius, p.height, p.color);
+                break;
+            case PrimitiveCylinder:
+                makeCylinder(p.mesh, p.center, p.radius, p.height, segments, p.color);
+                break;
+            default:
+                makeSphere(p.mesh, p.center, p.radius, segments, p.color);
+                break;
+            }
+            p.segments = segments;
+        }
+
+        rasterizer.addMesh(meshView(p.mesh), camera_matrix, dist_coeff, rot, trans);
+    }
+
+    return (0);
+}
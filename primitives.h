@@ -0,0 +1,49 @@
+/*
+Puja Chaudhury
+primitives.h
+The built-in virtual objects (pyramid, cylinder, sphere) drawn as wireframes or solid meshes.
+Each object is culled against the view frustum and tessellated according to its size on screen.
+*/
+
+#ifndef primitives_hpp
+#define primitives_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/calib3d.hpp>
+
+#include "frustum.h"
+#include "mesh.h"
+#include "overlay.h"
+#include "rasterizer.h"
+
+enum PrimitiveShape
+{
+    PrimitivePyramid,
+    PrimitiveCylinder,
+    PrimitiveSphere
+};
+
+// One virtual object in board coordinates. The solid mesh is rebuilt whenever the chosen number of segments changes.
+struct Primitive
+{
+    PrimitiveShape shape;
+    cv::Point3f center; // centre of the base for the pyramid, of the whole object otherwise
+    float radius;       // half width of the base for the pyramid
+    float height;
+    cv::Vec3b color;
+    int segments;
+    Mesh mesh;
+};
+
+Primitive makePrimitive(PrimitiveShape shape, cv::Point3f center, float radius, float height, cv::Vec3b color);
+
+BoundingSphere primitiveBounds(const Primitive &primitive);
+
+int drawWirePrimitive(OverlayDrawList &overlay, const ViewFrustum &frustum, const Primitive &primitive, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans);
+
+int drawSolidPrimitives(Rasterizer &rasterizer, const ViewFrustum &frustum, std::vector<Primitive> &primitives, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans);
+
+#endif
@@ -0,0 +1,204 @@
+/*
+Puja Chaudhury
+quality_controller.cpp
+Function implementations for the quality settings and the frame budget controller.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "quality_controller.h"
+
+// One step of the detection ladder, from full quality down
+struct DetectQuality
+{
+    double processingScale;
+    int subPixWindow;
+    int subPixIterations;
+};
+
+// One step of the drawing ladder, from full quality down
+struct RenderQuality
+{
+    int maxSegments;
+    double lineScale;
+    int overlayInterval;
+};
+
+static const DetectQuality detectLevels[] = {{1.0, 5, 30}, {1.0, 4, 15}, {0.75, 3, 10}, {0.5, 3, 5}};
+static const RenderQuality renderLevels[] = {{20, 1.0, 1}, {12, 0.7, 1}, {8, 0.5, 2}, {6, 0.3, 3}};
+static const int numLevels = 4;
+
+QualitySettings::QualitySettings()
+    : processingScale(1.0),
+      subPixWindow(5),
+      subPixIterations(30),
+      maxSegments(20),
+      lineScale(1.0),
+      overlayInterval(1)
+{
+}
+
+/*
+This function returns the height detection runs at for the configured processing height, 0 meaning the capture height.
+At full quality the configured height is returned unchanged.
+ */
+int QualitySettings::processingHeight(int configuredHeight, int captureHeight) const
+{
+    if (processingScale >= 1.0)
+    {
+        return (configuredHeight);
+    }
+    int height = configuredHeight > 0 && configuredHeight < captureHeight ? configuredHeight : captureHeight;
+    return (std::max(1, (int)std::lround(height * processingScale)));
+}
+
+/*
+This function returns the thickness a line drawn at full quality with the given thickness gets now, at least 1 pixel.
+ */
+int QualitySettings::lineThickness(int thickness) const
+{
+    return (std::max(1, (int)std::lround(thickness * lineScale)));
+}
+
+QualitySettings &qualitySettings()
+{
+    static QualitySettings settings;
+    return (settings);
+}
+
+QualityController::QualityController(double budgetMs)
+    : budgetMs(budgetMs),
+      headroom(0.7),
+      settleFrames(15),
+      smoothing(0.1),
+      detectLevel(0),
+      renderLevel(0),
+      frames(0),
+      overBudgetFrames(0),
+      loweredSteps(0),
+      raisedSteps(0),
+      detectAverage(0),
+      renderAverage(0),
+      frameAverage(0),
+      frameTotal(0),
+      sinceChange(0)
+{
+    std::fill(detectLevelFrames, detectLevelFrames + numLevels, 0);
+    std::fill(renderLevelFrames, renderLevelFrames + numLevels, 0);
+}
+
+bool QualityController::enabled() const
+{
+    return (budgetMs > 0);
+}
+
+/*
+This function takes one frame's timings in milliseconds: detection, pose and drawing together, and the whole frame.
+While the smoothed frame time is over budget, the stage taking the larger share is lowered a level, or the other
+stage when that one is already at its lowest. While it is below the headroom fraction of the budget, the stage taking
+the smaller share is raised first, as it costs the least to restore. After every change the timings are given
+settleFrames to show its effect. It returns which settings changed: 1 for detection, 2 for drawing, 0 for none.
+ */
+int QualityController::update(double detectMs, double renderMs, double frameMs)
+{
+    if (!enabled())
+    {
+        return (0);
+    }
+
+    // the first frame seeds the averages, so they do not start from zero
+    double weight = frames == 0 ? 1.0 : smoothing;
+    detectAverage += weight * (detectMs - detectAverage);
+    renderAverage += weight * (renderMs - renderAverage);
+    frameAverage += weight * (frameMs - frameAverage);
+    frameTotal += frameMs;
+    frames++;
+    overBudgetFrames += frameMs > budgetMs ? 1 : 0;
+    detectLevelFrames[detectLevel]++;
+    renderLevelFrames[renderLevel]++;
+
+    if (++sinceChange < settleFrames)
+    {
+        return (0);
+    }
+
+    int changed = 0;
+    bool detectHeavier = detectAverage >= renderAverage;
+    if (frameAverage > budgetMs)
+    {
+        if ((detectHeavier || renderLevel == numLevels - 1) && detectLevel < numLevels - 1)
+        {
+            detectLevel++;
+            changed = 1;
+        }
+        else if (renderLevel < numLevels - 1)
+        {
+            renderLevel++;
+            changed = 2;
+        }
+        loweredSteps += changed != 0 ? 1 : 0;
+    }
+    else if (frameAverage < headroom * budgetMs)
+    {
+        if ((detectHeavier || detectLevel == 0) && renderLevel > 0)
+        {
+            renderLevel--;
+            changed = 2;
+        }
+        else if (detectLevel > 0)
+        {
+            detectLevel--;
+            changed = 1;
+        }
+        raisedSteps += changed != 0 ? 1 : 0;
+    }
+
+    if (changed != 0)
+    {
+        apply();
+        sinceChange = 0;
+        const QualitySettings &q = qualitySettings();
+        printf("Quality: %.1f ms per frame for a %.1f ms budget (detection %.1f ms, drawing %.1f ms); ", frameAverage, budgetMs, detectAverage, renderAverage);
+        if (changed == 1)
+        {
+            printf("detection level %d: %.0f%% resolution, sub-pixel window %d, %d iterations\n",
+                   detectLevel, 100 * q.processingScale, q.subPixWindow, q.subPixIterations);
+        }
+        else
+        {
+            printf("drawing level %d: at most %d segments, lines at %.0f%%, overlay checked every %d frames\n",
+                   renderLevel, q.maxSegments, 100 * q.lineScale, q.overlayInterval);
+        }
+    }
+
+    return (changed);
+}
+
+/*
+This function copies the current levels into the shared settings.
+ */
+void QualityController::apply()
+{
+    QualitySettings &q = qualitySettings();
+    q.processingScale = detectLevels[detectLevel].processingScale;
+    q.subPixWindow = detectLevels[detectLevel].subPixWindow;
+    q.subPixIterations = detectLevels[detectLevel].subPixIterations;
+    q.maxSegments = renderLevels[renderLevel].maxSegments;
+    q.lineScale = renderLevels[renderLevel].lineScale;
+    q.overlayInterval = renderLevels[renderLevel].overlayInterval;
+}
+
+void QualityController::printStats()
+{
+    if (!enabled() || frames == 0)
+    {
+        return;
+    }
+    printf("Quality: %.1f ms per frame for a %.1f ms budget, %d of %d frames over, lowered %d times and raised %d times\n",
+           frameTotal / frames, budgetMs, overBudgetFrames, frames, loweredSteps, raisedSteps);
+    printf("  frames at detection levels 0-3: %d %d %d %d, at drawing levels 0-3: %d %d %d %d, now at %d and %d\n",
+           detectLevelFrames[0], detectLevelFrames[1], detectLevelFrames[2], detectLevelFrames[3],
+           renderLevelFrames[0], renderLevelFrames[1], renderLevelFrames[2], renderLevelFrames[3], detectLevel, renderLevel);
+}
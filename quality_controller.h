@@ -0,0 +1,77 @@
+/*
+Puja Chaudhury
+quality_controller.h
+Holding a frame time budget by trading quality for time. The quality settings are read by the stages they affect:
+detection resolution and corner refinement by the detectors, tessellation and line thickness by the overlay, and how
+often the cached overlay layer is checked against the pose by the frame loop. The controller watches how long
+detection and drawing take, lowers the level of whichever stage takes the larger share while frames run over budget,
+and raises levels again once there is headroom.
+*/
+
+#ifndef quality_controller_hpp
+#define quality_controller_hpp
+
+// The knobs the controller turns; the defaults are full quality, the settings the stages used before the controller
+struct QualitySettings
+{
+    QualitySettings();
+
+    double processingScale; // fraction of the configured processing height detection runs at
+    int subPixWindow;       // half size of the cornerSubPix search window
+    int subPixIterations;   // cornerSubPix iterations
+    int maxSegments;        // upper tessellation limit of round objects
+    double lineScale;       // factor on overlay line thicknesses
+    int overlayInterval;    // frames between pose checks of the cached overlay layer
+
+    int processingHeight(int configuredHeight, int captureHeight) const;
+    int lineThickness(int thickness) const;
+};
+
+// the settings shared by every stage of the process
+QualitySettings &qualitySettings();
+
+class QualityController
+{
+public:
+    QualityController(double budgetMs = 0);
+
+    bool enabled() const;
+    int update(double detectMs, double renderMs, double frameMs);
+    void printStats();
+
+    // frame time to stay within, 0 to leave the settings alone
+    double budgetMs;
+
+    // quality is raised again once the smoothed frame time is below this fraction of the budget
+    double headroom;
+
+    // frames to wait after a change before judging its effect
+    int settleFrames;
+
+    // weight of the newest frame in the smoothed timings
+    double smoothing;
+
+    // current levels, 0 for full quality
+    int detectLevel;
+    int renderLevel;
+
+    int frames;
+    int overBudgetFrames;
+    int loweredSteps;
+    int raisedSteps;
+
+private:
+    void apply();
+
+    double detectAverage;
+    double renderAverage;
+    double frameAverage;
+    double frameTotal;
+    int sinceChange;
+
+    // frames spent at each level
+    int detectLevelFrames[4];
+    int renderLevelFrames[4];
+};
+
+#endif
@@ -0,0 +1,311 @@
+/*
+Puja Chaudhury
+rasterizer.cpp
+Function implementations for the tiled z-buffer rasterizer.
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "frustum.h"
+#include "rasterizer.h"
+
+static inline cv::Vec3f crossVec(const cv::Vec3f &a, const cv::Vec3f &b)
+{
+    return cv::Vec3f(a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]);
+}
+
+static inline float dotVec(const cv::Vec3f &a, const cv::Vec3f &b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+Rasterizer::Rasterizer(int tileSize)
+    : smoothShading(true),
+      lightDir(-0.3f, -0.6f, -0.74f),
+      ambient(0.3f),
+      submittedTriangles(0),
+      culledTriangles(0),
+      drawnTriangles(0),
+      tileSize(tileSize),
+      tilesX(0),
+      tilesY(0)
+{
+}
+
+/*
+This function starts a new frame. Triangles added until end() is called are drawn onto frame.
+The depth buffer and tile bins are reused as long as the frame size does not change.
+ */
+int Rasterizer::begin(cv::Mat &frame)
+{
+    target = frame;
+    depth.create(frame.size(), CV_32FC1);
+
+    tilesX = (frame.cols + tileSize - 1) / tileSize;
+    tilesY = (frame.rows + tileSize - 1) / tileSize;
+    bins.resize(tilesX * tilesY);
+    for (size_t i = 0; i < bins.size(); i++)
+    {
+        bins[i].clear();
+    }
+
+    triangles.clear();
+    submittedTriangles = 0;
+    culledTriangles = 0;
+    drawnTriangles = 0;
+
+    return (0);
+}
+
+/*
+This function transforms a mesh into camera coordinates with its placement on the board and the current pose,
+projects it into the image and queues every triangle that faces the camera, lies in front of it and touches the frame.
+Meshes whose bounds fall entirely outside the view are rejected before any vertex is projected.
+Lighting is evaluated here so the tile pass only interpolates it.
+ */
+int Rasterizer::addMesh(const MeshView &mesh, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, const MeshPlacement &placement)
+{
+    if (mesh.numVertices == 0)
+    {
+        return (0);
+    }
+
+    // skip the whole mesh when its placed bounding sphere is outside the view
+    cv::Mat placeRot;
+    cv::Rodrigues(cv::Mat(placement.rotation), placeRot);
+    cv::Vec3f mid = (mesh.minBound + mesh.maxBound) * 0.5f;
+    cv::Vec3f extent = mesh.maxBound - mesh.minBound;
+    BoundingSphere bounds;
+    bounds.center = cv::Point3f((float)(placement.scale * (placeRot.at<double>(0, 0) * mid[0] + placeRot.at<double>(0, 1) * mid[1] + placeRot.at<double>(0, 2) * mid[2]) + placement.position[0]),
+                                (float)(placement.scale * (placeRot.at<double>(1, 0) * mid[0] + placeRot.at<double>(1, 1) * mid[1] + placeRot.at<double>(1, 2) * mid[2]) + placement.position[1]),
+                                (float)(placement.scale * (placeRot.at<double>(2, 0) * mid[0] + placeRot.at<double>(2, 1) * mid[1] + placeRot.at<double>(2, 2) * mid[2]) + placement.position[2]));
+    bounds.radius = (float)(placement.scale * 0.5 * std::sqrt(dotVec(extent, extent)));
+
+    ViewFrustum frustum;
+    float screenRadius;
+    bool crossesNear;
+    makeFrustum(frustum, camera_matrix, rot, trans, target.size());
+    if (!sphereVisible(frustum, bounds, screenRadius, crossesNear))
+    {
+        submittedTriangles += mesh.numTriangles;
+        culledTriangles += mesh.numTriangles;
+        return (0);
+    }
+
+    // fold the placement into the pose: camera = s * (R * Rm * v + (R * p + t) / s), and projection ignores the scale s
+    cv::Mat rotMat, R, t;
+    cv::Rodrigues(rot, rotMat);
+    rotMat.convertTo(R, CV_64F);
+    trans.convertTo(t, CV_64F);
+    cv::Mat modelRot = R * placeRot;
+    cv::Mat modelTrans = (R * cv::Mat(placement.position) + t) * (1.0 / placement.scale);
+    cv::Mat modelRvec;
+    cv::Rodrigues(modelRot, modelRvec);
+
+    // project straight from the mesh arrays, which may be memory-mapped
+    cv::Mat vertexMat(mesh.numVertices, 1, CV_32FC3, (void *)mesh.vertices);
+    cv::projectPoints(vertexMat, modelRvec, modelTrans, camera_matrix, dist_coeff, projected);
+
+    size_t numVertices = mesh.numVertices;
+    bool smooth = smoothShading && mesh.normals != NULL;
+    float light = 1.0f / std::sqrt(dotVec(lightDir, lightDir));
+    cv::Vec3f towardsLight = lightDir * light;
+    float scale = (float)placement.scale;
+
+    cameraPoints.resize(numVertices);
+    vertexShade.resize(numVertices);
+    for (size_t i = 0; i < numVertices; i++)
+    {
+        const cv::Vec3f &v = mesh.vertices[i];
+        for (int r = 0; r < 3; r++)
+        {
+            cameraPoints[i][r] = scale * (float)(modelRot.at<double>(r, 0) * v[0] + modelRot.at<double>(r, 1) * v[1] + modelRot.at<double>(r, 2) * v[2] + modelTrans.at<double>(r));
+        }
+        if (smooth)
+        {
+            const cv::Vec3f &n = mesh.normals[i];
+            cv::Vec3f nc;
+            for (int r = 0; r < 3; r++)
+            {
+                nc[r] = (float)(modelRot.at<double>(r, 0) * n[0] + modelRot.at<double>(r, 1) * n[1] + modelRot.at<double>(r, 2) * n[2]);
+            }
+            vertexShade[i] = ambient + (1 - ambient) * std::max(0.0f, dotVec(nc, towardsLight));
+        }
+    }
+
+    for (int f = 0; f < mesh.numTriangles; f++)
+    {
+        const cv::Vec3i &tri = mesh.triangles[f];
+        submittedTriangles++;
+
+        const cv::Vec3f &a = cameraPoints[tri[0]];
+        const cv::Vec3f &b = cameraPoints[tri[1]];
+        const cv::Vec3f &c = cameraPoints[tri[2]];
+        if (a[2] < frustumNear || b[2] < frustumNear || c[2] < frustumNear)
+        {
+            culledTriangles++;
+            continue;
+        }
+
+        // back-facing when the outward normal points away from the camera at the origin
+        cv::Vec3f normal = crossVec(b - a, c - a);
+        if (dotVec(normal, a) >= 0)
+        {
+            culledTriangles++;
+            continue;
+        }
+
+        ScreenTriangle st;
+        float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+        for (int k = 0; k < 3; k++)
+        {
+            st.p[k] = projected[tri[k]];
+            st.invZ[k] = 1.0f / cameraPoints[tri[k]][2];
+            minX = std::min(minX, st.p[k].x);
+            maxX = std::max(maxX, st.p[k].x);
+            minY = std::min(minY, st.p[k].y);
+            maxY = std::max(maxY, st.p[k].y);
+        }
+        if (maxX < 0 || maxY < 0 || minX >= target.cols || minY >= target.rows)
+        {
+            culledTriangles++;
+            continue;
+        }
+
+        if (smooth)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                st.shade[k] = vertexShade[tri[k]];
+            }
+        }
+        else
+        {
+            float len = std::sqrt(dotVec(normal, normal));
+            float shade = ambient + (1 - ambient) * std::max(0.0f, dotVec(normal, towardsLight) / (len > 0 ? len : 1.0f));
+            st.shade[0] = st.shade[1] = st.shade[2] = shade;
+        }
+        st.color = mesh.color;
+
+        int index = (int)triangles.size();
+        triangles.push_back(st);
+
+        // clamp in floating point first, vertices close to the camera can project far outside the frame
+        int tx0 = (int)std::max(0.0f, minX) / tileSize;
+        int ty0 = (int)std::max(0.0f, minY) / tileSize;
+        int tx1 = (int)std::min((float)(target.cols - 1), maxX) / tileSize;
+        int ty1 = (int)std::min((float)(target.rows - 1), maxY) / tileSize;
+        for (int ty = ty0; ty <= ty1; ty++)
+        {
+            for (int tx = tx0; tx <= tx1; tx++)
+            {
+                bins[ty * tilesX + tx].push_back(index);
+            }
+        }
+    }
+
+    return (0);
+}
+
+/*
+This function fills every triangle binned to one tile, using edge functions evaluated at pixel centres.
+The tile's part of the depth buffer is cleared first, so tiles that nothing touches are never visited.
+ */
+void Rasterizer::rasterizeTile(int tile)
+{
+    int x0 = (tile % tilesX) * tileSize;
+    int y0 = (tile / tilesX) * tileSize;
+    int x1 = std::min(x0 + tileSize, target.cols);
+    int y1 = std::min(y0 + tileSize, target.rows);
+
+    for (int y = y0; y < y1; y++)
+    {
+        float *d = depth.ptr<float>(y);
+        std::fill(d + x0, d + x1, 0.0f);
+    }
+
+    const std::vector<int> &bin = bins[tile];
+    for (size_t i = 0; i < bin.size(); i++)
+    {
+        const ScreenTriangle &t = triangles[bin[i]];
+        const cv::Point2f &p0 = t.p[0];
+        const cv::Point2f &p1 = t.p[1];
+        const cv::Point2f &p2 = t.p[2];
+
+        float area = (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x);
+        if (std::fabs(area) < 1e-6f)
+        {
+            continue;
+        }
+        float invArea = 1.0f / area;
+
+        int minX = (int)std::max((float)x0, std::floor(std::min(p0.x, std::min(p1.x, p2.x))));
+        int maxX = (int)std::min((float)(x1 - 1), std::ceil(std::max(p0.x, std::max(p1.x, p2.x))));
+        int minY = (int)std::max((float)y0, std::floor(std::min(p0.y, std::min(p1.y, p2.y))));
+        int maxY = (int)std::min((float)(y1 - 1), std::ceil(std::max(p0.y, std::max(p1.y, p2.y))));
+
+        // barycentric weights change by a constant step per pixel along a row
+        float dw0 = (p1.y - p2.y) * invArea;
+        float dw1 = (p2.y - p0.y) * invArea;
+        float dw2 = (p0.y - p1.y) * invArea;
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            float px = minX + 0.5f;
+            float py = y + 0.5f;
+            float w0 = ((p2.x - p1.x) * (py - p1.y) - (p2.y - p1.y) * (px - p1.x)) * invArea;
+            float w1 = ((p0.x - p2.x) * (py - p2.y) - (p0.y - p2.y) * (px - p2.x)) * invArea;
+            float w2 = ((p1.x - p0.x) * (py - p0.y) - (p1.y - p0.y) * (px - p0.x)) * invArea;
+
+            float *d = depth.ptr<float>(y);
+            cv::Vec3b *pixel = target.ptr<cv::Vec3b>(y);
+            for (int x = minX; x <= maxX; x++, w0 += dw0, w1 += dw1, w2 += dw2)
+            {
+                if (w0 < 0 || w1 < 0 || w2 < 0)
+                {
+                    continue;
+                }
+                float invZ = w0 * t.invZ[0] + w1 * t.invZ[1] + w2 * t.invZ[2];
+                if (invZ <= d[x])
+                {
+                    continue;
+                }
+                d[x] = invZ;
+                float shade = w0 * t.shade[0] + w1 * t.shade[1] + w2 * t.shade[2];
+                pixel[x] = cv::Vec3b(cv::saturate_cast<uchar>(t.color[0] * shade),
+                                     cv::saturate_cast<uchar>(t.color[1] * shade),
+                                     cv::saturate_cast<uchar>(t.color[2] * shade));
+            }
+        }
+    }
+}
+
+/*
+This function rasterizes all queued triangles. Only tiles with at least one triangle are processed and they run in parallel,
+each writing its own pixels of the frame and depth buffer.
+ */
+int Rasterizer::end()
+{
+    std::vector<int> busy;
+    for (size_t i = 0; i < bins.size(); i++)
+    {
+        if (!bins[i].empty())
+        {
+            busy.push_back((int)i);
+        }
+    }
+
+    cv::parallel_for_(cv::Range(0, (int)busy.size()), [&](const cv::Range &range)
+                      {
+        for (int i = range.start; i < range.end; i++)
+        {
+            rasterizeTile(busy[i]);
+        } });
+
+    drawnTriangles = (int)triangles.size();
+    target = cv::Mat();
+
+    return (0);
+}
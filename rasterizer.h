@@ -0,0 +1,66 @@
+/*
+Puja Chaudhury
+rasterizer.h
+A small CPU triangle rasterizer for drawing solid virtual objects into the video frame.
+Triangles from every mesh of a frame are projected, culled and binned into screen tiles; the tiles are then
+filled in parallel against a depth buffer and written straight onto the frame.
+*/
+
+#ifndef rasterizer_hpp
+#define rasterizer_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/calib3d.hpp>
+
+#include "mesh.h"
+
+class Rasterizer
+{
+public:
+    Rasterizer(int tileSize = 64);
+
+    int begin(cv::Mat &frame);
+    int addMesh(const MeshView &mesh, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans,
+                const MeshPlacement &placement = MeshPlacement());
+    int end();
+
+    // interpolate per-vertex lighting when the mesh has normals, otherwise light each face flat
+    bool smoothShading;
+
+    // direction towards the light in camera coordinates, and the light level of faces turned away from it
+    cv::Vec3f lightDir;
+    float ambient;
+
+    // triangles submitted, rejected as outside the view, back-facing or behind the camera, and drawn in the last frame
+    int submittedTriangles;
+    int culledTriangles;
+    int drawnTriangles;
+
+private:
+    struct ScreenTriangle
+    {
+        cv::Point2f p[3];
+        float invZ[3];
+        float shade[3];
+        cv::Vec3b color;
+    };
+
+    void rasterizeTile(int tile);
+
+    int tileSize;
+    int tilesX;
+    int tilesY;
+    cv::Mat target;
+    cv::Mat depth; // 1 / z of the closest surface, 0 where nothing was drawn
+    std::vector<ScreenTriangle> triangles;
+    std::vector<std::vector<int>> bins;
+
+    // per-mesh scratch buffers kept between frames
+    std::vector<cv::Point2f> projected;
+    std::vector<cv::Vec3f> cameraPoints;
+    std::vector<float> vertexShade;
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+Puja Chaudhury
+resolution.cpp
+Function implementations for converting frames, intrinsics and image points between resolutions.
+*/
+
+#include "resolution.h"
+
+/*
+This function returns the size detection runs at: processingHeight rows with the capture's aspect ratio.
+Frames are never enlarged, so a height of 0 or one at least the capture's keeps the capture size.
+ */
+cv::Size processingSize(cv::Size captureSize, int processingHeight)
+{
+    if (processingHeight <= 0 || processingHeight >= captureSize.height)
+    {
+        return (captureSize);
+    }
+    int width = cvRound((double)captureSize.width * processingHeight / captureSize.height);
+    return (cv::Size(width, processingHeight));
+}
+
+/*
+This function shrinks the frame to the given size with area averaging, which keeps thin edges and corners intact.
+When no resizing is needed, resized shares the frame's data instead of copying it.
+ */
+int resizeForProcessing(const cv::Mat &frame, cv::Size size, cv::Mat &resized)
+{
+    if (frame.size() == size)
+    {
+        resized = frame;
+        return (0);
+    }
+    cv::resize(frame, resized, size, 0, 0, cv::INTER_AREA);
+
+    return (0);
+}
+
+/*
+This function converts a double-precision camera matrix calibrated at one image size into the matrix for another size of the same sensor.
+Focal lengths scale with the image; the principal point is mapped through pixel centres, matching how cv::resize samples.
+Distortion coefficients act on normalized coordinates and stay the same.
+ */
+int scaleCameraMatrix(cv::Mat &camera_matrix, cv::Size from, cv::Size to)
+{
+    if (from == to || from.area() == 0 || to.area() == 0)
+    {
+        return (0);
+    }
+    double sx = (double)to.width / from.width;
+    double sy = (double)to.height / from.height;
+
+    camera_matrix.at<double>(0, 0) *= sx;
+    camera_matrix.at<double>(0, 1) *= sx;
+    camera_matrix.at<double>(0, 2) = (camera_matrix.at<double>(0, 2) + 0.5) * sx - 0.5;
+    camera_matrix.at<double>(1, 1) *= sy;
+    camera_matrix.at<double>(1, 2) = (camera_matrix.at<double>(1, 2) + 0.5) * sy - 0.5;
+
+    return (0);
+}
+
+/*
+This function moves image points found in an image of one size to the pixel positions they have in another, like the principal point above.
+ */
+int scalePoints(std::vector<cv::Point2f> &points, cv::Size from, cv::Size to)
+{
+    if (from == to || from.area() == 0)
+    {
+        return (0);
+    }
+    float sx = (float)to.width / from.width;
+    float sy = (float)to.height / from.height;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        points[i].x = (points[i].x + 0.5f) * sx - 0.5f;
+        points[i].y = (points[i].y + 0.5f) * sy - 0.5f;
+    }
+
+    return (0);
+}
@@ -0,0 +1,24 @@
+/*
+Puja Chaudhury
+resolution.h
+Running detection on a downscaled copy of the frame while pose, drawing and compositing stay at capture resolution.
+Intrinsics and detected points are converted between the two sizes so every stage works in consistent pixels.
+*/
+
+#ifndef resolution_hpp
+#define resolution_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+cv::Size processingSize(cv::Size captureSize, int processingHeight);
+
+int resizeForProcessing(const cv::Mat &frame, cv::Size size, cv::Mat &resized);
+
+int scaleCameraMatrix(cv::Mat &camera_matrix, cv::Size from, cv::Size to);
+
+int scalePoints(std::vector<cv::Point2f> &points, cv::Size from, cv::Size to);
+
+#endif
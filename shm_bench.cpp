@@ -0,0 +1,87 @@
+/*
+Puja Chaudhury
+
+This is a CPP program that measures publishing 1080p frames through shared memory. One thread publishes as fast as it
+can while a reader, on a mapping of its own as another process would have, copies out the newest frame and optionally
+spends extra time on each one. The publisher's rate should not depend on how slow the reader is.
+Usage: shm_bench [seconds] [reader delay ms] [slots]
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <opencv2/core.hpp>
+
+#include "shm_publisher.h"
+
+int main(int argc, char *argv[])
+{
+    double seconds = argc > 1 ? std::stod(argv[1]) : 5;
+    int readerDelayMs = argc > 2 ? std::stoi(argv[2]) : 0;
+    int slots = argc > 3 ? std::stoi(argv[3]) : 4;
+    std::string name = "/ar_frames_bench";
+
+    cv::Size frameSize(1920, 1080);
+    cv::Mat frame(frameSize, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+    cv::Mat rot = (cv::Mat_<double>(3, 1) << 2.6, 0.2, 0);
+    cv::Mat trans = (cv::Mat_<double>(3, 1) << -4, -1, 14);
+
+    ShmPublisher publisher;
+    if (publisher.open(name, frameSize, frame.type(), slots) != 0)
+    {
+        return (-1);
+    }
+
+    std::atomic<bool> running(true);
+    ShmReader reader;
+    if (reader.open(name) != 0)
+    {
+        printf("Unable to attach to %s\n", name.c_str());
+        return (-1);
+    }
+    std::thread consumer([&]()
+                         {
+        cv::Mat copy;
+        PoseRecord pose;
+        double timestamp;
+        uint64_t frameNumber;
+        while (running)
+        {
+            if (reader.read(copy, pose, timestamp, frameNumber) == 0 && readerDelayMs > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(readerDelayMs));
+            }
+        } });
+
+    double start = (double)cv::getTickCount();
+    double elapsed = 0;
+    double longestMs = 0;
+    while (elapsed < seconds)
+    {
+        double before = (double)cv::getTickCount();
+        publisher.publish(frame, elapsed, rot, trans, true);
+        double now = (double)cv::getTickCount();
+        longestMs = std::max(longestMs, (now - before) * 1000.0 / cv::getTickFrequency());
+        elapsed = (now - start) / cv::getTickFrequency();
+    }
+    running = false;
+    consumer.join();
+
+    double megabytes = publisher.publishedFrames * frame.total() * frame.elemSize() / (1024.0 * 1024.0);
+    std::cout << "Shared memory at " << frameSize.width << "x" << frameSize.height << ", " << slots << " slots, reader delay "
+              << readerDelayMs << " ms" << std::endl;
+    std::cout << "published: " << publisher.publishedFrames / elapsed << " frames/s, " << megabytes / elapsed
+              << " MB/s, slowest publish " << longestMs << " ms" << std::endl;
+    std::cout << "read: " << reader.readFrames / elapsed << " frames/s, " << reader.missedFrames << " skipped, "
+              << reader.tornFrames << " overwritten while being copied" << std::endl;
+
+    reader.close();
+    publisher.close();
+
+    return (0);
+}
@@ -0,0 +1,315 @@
+/*
+Puja Chaudhury
+shm_publisher.cpp
+Function implementations for publishing frames and poses through POSIX shared memory.
+*/
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shm_publisher.h"
+
+// the counters are shared between processes, which only works when they need no lock
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory counters must be lock-free");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared-memory counters must be lock-free");
+
+static const uint32_t SHM_MAGIC = 0x41524652; // "ARFR"
+static const uint32_t SHM_VERSION = 1;
+
+// slots and pixels start on cache-line boundaries
+static size_t align64(size_t n)
+{
+    return (n + 63) & ~(size_t)63;
+}
+
+static ShmSlot *slotAt(const ShmHeader *header, uint64_t index)
+{
+    char *base = (char *)header + align64(sizeof(ShmHeader));
+    return ((ShmSlot *)(base + index * header->slotBytes));
+}
+
+static uchar *pixelsOf(const ShmSlot *slot)
+{
+    return ((uchar *)slot + align64(sizeof(ShmSlot)));
+}
+
+ShmPublisher::ShmPublisher()
+    : publishedFrames(0),
+      refusedFrames(0),
+      header(NULL),
+      bytes(0)
+{
+}
+
+ShmPublisher::~ShmPublisher()
+{
+    close();
+}
+
+/*
+This function creates the shared-memory segment, named with a leading '/' as shm_open expects, with room for the given
+number of frames of the given size and type. A segment of the same name left behind by an earlier run is replaced.
+ */
+int ShmPublisher::open(std::string name, cv::Size frameSize, int type, int slots)
+{
+    close();
+    if (slots < 2)
+    {
+        slots = 2;
+    }
+
+    size_t frameBytes = (size_t)frameSize.area() * CV_ELEM_SIZE(type);
+    size_t slotBytes = align64(sizeof(ShmSlot)) + align64(frameBytes);
+    size_t total = align64(sizeof(ShmHeader)) + slots * slotBytes;
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        printf("Unable to create shared memory %s\n", name.c_str());
+        return (-1);
+    }
+    if (ftruncate(fd, (off_t)total) != 0)
+    {
+        printf("Unable to size shared memory %s to %zu bytes\n", name.c_str(), total);
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return (-1);
+    }
+    void *memory = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        printf("Unable to map shared memory %s\n", name.c_str());
+        shm_unlink(name.c_str());
+        return (-1);
+    }
+
+    // the segment starts out zeroed, so every slot's sequence says it has never been written
+    header = (ShmHeader *)memory;
+    header->magic = SHM_MAGIC;
+    header->version = SHM_VERSION;
+    header->slotCount = (uint32_t)slots;
+    header->slotBytes = slotBytes;
+    header->frameBytes = frameBytes;
+    header->published.store(0, std::memory_order_relaxed);
+    header->open.store(1, std::memory_order_release);
+
+    this->name = name;
+    bytes = total;
+
+    return (0);
+}
+
+/*
+This function marks the segment closed and removes its name. Readers still attached keep their mapping until they let go.
+ */
+void ShmPublisher::close()
+{
+    if (header == NULL)
+    {
+        return;
+    }
+    header->open.store(0, std::memory_order_release);
+    munmap(header, bytes);
+    shm_unlink(name.c_str());
+    header = NULL;
+    bytes = 0;
+}
+
+bool ShmPublisher::isOpen() const
+{
+    return (header != NULL);
+}
+
+/*
+This function writes a frame and its pose into the next slot, overwriting the oldest frame. The slot's sequence number
+is made odd before the copy and even again after it, and only then is the frame counted as published.
+ */
+int ShmPublisher::publish(const cv::Mat &frame, double timestamp, const cv::Mat &rot, const cv::Mat &trans, bool posed)
+{
+    if (header == NULL)
+    {
+        return (-1);
+    }
+    size_t rowBytes = frame.cols * frame.elemSize();
+    if (rowBytes * frame.rows > header->frameBytes)
+    {
+        refusedFrames++;
+        return (-1);
+    }
+
+    uint64_t n = header->published.load(std::memory_order_relaxed);
+    ShmSlot *slot = slotAt(header, n % header->slotCount);
+
+    slot->sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot->frameNumber = n;
+    slot->timestamp = timestamp;
+    slot->rows = frame.rows;
+    slot->cols = frame.cols;
+    slot->type = frame.type();
+    slot->pose.valid = posed && rot.total() == 3 && trans.total() == 3 ? 1 : 0;
+    for (int i = 0; i < 3; i++)
+    {
+        slot->pose.rvec[i] = slot->pose.valid ? rot.at<double>(i) : 0;
+        slot->pose.tvec[i] = slot->pose.valid ? trans.at<double>(i) : 0;
+    }
+
+    uchar *pixels = pixelsOf(slot);
+    if (frame.isContinuous())
+    {
+        memcpy(pixels, frame.data, rowBytes * frame.rows);
+    }
+    else
+    {
+        for (int y = 0; y < frame.rows; y++)
+        {
+            memcpy(pixels + y * rowBytes, frame.ptr(y), rowBytes);
+        }
+    }
+
+    slot->sequence.store(2 * n + 2, std::memory_order_release);
+    header->published.store(n + 1, std::memory_order_release);
+    publishedFrames++;
+
+    return (0);
+}
+
+ShmReader::ShmReader()
+    : readFrames(0),
+      missedFrames(0),
+      tornFrames(0),
+      header(NULL),
+      bytes(0),
+      lastFrame(0)
+{
+}
+
+ShmReader::~ShmReader()
+{
+    close();
+}
+
+/*
+This function attaches to a publisher's segment read-only. It fails while no publisher has the segment open.
+ */
+int ShmReader::open(std::string name)
+{
+    close();
+
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return (-1);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < align64(sizeof(ShmHeader)))
+    {
+        ::close(fd);
+        return (-1);
+    }
+    void *memory = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+    {
+        return (-1);
+    }
+
+    header = (const ShmHeader *)memory;
+    bytes = (size_t)info.st_size;
+    if (header->magic != SHM_MAGIC || header->version != SHM_VERSION || !header->open.load(std::memory_order_acquire) ||
+        align64(sizeof(ShmHeader)) + header->slotCount * header->slotBytes > bytes)
+    {
+        close();
+        return (-1);
+    }
+
+    // start from the newest frame already published
+    uint64_t published = header->published.load(std::memory_order_acquire);
+    lastFrame = published > 0 ? published - 1 : 0;
+
+    return (0);
+}
+
+void ShmReader::close()
+{
+    if (header == NULL)
+    {
+        return;
+    }
+    munmap((void *)header, bytes);
+    header = NULL;
+    bytes = 0;
+}
+
+bool ShmReader::isOpen() const
+{
+    return (header != NULL);
+}
+
+/*
+This function copies the newest frame and its pose out of the segment into frame, which keeps its buffer between calls.
+It returns 0 for a new frame, 1 when nothing new has been published, -1 when the publisher overwrote the slot while
+it was being copied, and -2 once the publisher has closed the segment.
+ */
+int ShmReader::read(cv::Mat &frame, PoseRecord &pose, double &timestamp, uint64_t &frameNumber)
+{
+    if (header == NULL || !header->open.load(std::memory_order_acquire))
+    {
+        return (-2);
+    }
+
+    uint64_t published = header->published.load(std::memory_order_acquire);
+    if (published == 0 || published == lastFrame)
+    {
+        return (1);
+    }
+
+    uint64_t n = published - 1;
+    const ShmSlot *slot = slotAt(header, n % header->slotCount);
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence != 2 * n + 2)
+    {
+        tornFrames++;
+        return (-1);
+    }
+
+    int rows = slot->rows;
+    int cols = slot->cols;
+    int type = slot->type;
+    size_t rowBytes = (size_t)cols * CV_ELEM_SIZE(type);
+    if (rows < 0 || cols < 0 || rowBytes * rows > header->frameBytes)
+    {
+        tornFrames++;
+        return (-1);
+    }
+    frame.create(rows, cols, type);
+    for (int y = 0; y < rows; y++)
+    {
+        memcpy(frame.ptr(y), pixelsOf(slot) + y * rowBytes, rowBytes);
+    }
+    pose = slot->pose;
+    timestamp = slot->timestamp;
+
+    // the copy only counts if the publisher did not start rewriting the slot meanwhile
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->sequence.load(std::memory_order_relaxed) != sequence)
+    {
+        tornFrames++;
+        return (-1);
+    }
+
+    missedFrames += published - lastFrame - 1;
+    lastFrame = published;
+    frameNumber = n;
+    readFrames++;
+
+    return (0);
+}
@@ -0,0 +1,105 @@
+/*
+Puja Chaudhury
+shm_publisher.h
+Publishing the AR output to other processes on the same host. Output frames and their poses are written into a ring
+of slots in a POSIX shared-memory segment. Readers map the same segment and copy straight out of it, with no system
+call per frame. Each slot carries a sequence number that is odd while the slot is being written. A reader checks it
+before and after copying and drops the frame when the slot changed underneath it. The publisher never waits for
+anyone, so a slow reader only misses frames and cannot hold up the video loop.
+*/
+
+#ifndef shm_publisher_hpp
+#define shm_publisher_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+// Pose of the target in the frame, as solvePnP returns it
+struct PoseRecord
+{
+    int32_t valid;
+    double rvec[3];
+    double tvec[3];
+};
+
+// Start of the segment. Sizes are fixed when the segment is created.
+struct ShmHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t _pad;
+    uint64_t slotBytes;  // size of one slot, including its ShmSlot header
+    uint64_t frameBytes; // largest frame a slot holds
+    std::atomic<uint64_t> published; // frames published so far; the newest is in slot (published - 1) % slotCount
+    std::atomic<uint32_t> open;      // cleared when the publisher closes, so readers know to attach again
+};
+
+// Start of each slot, followed by the frame's pixels
+struct ShmSlot
+{
+    std::atomic<uint64_t> sequence; // 2 * frame number + 2 once written, odd while being written
+    uint64_t frameNumber;
+    double timestamp;
+    int32_t rows;
+    int32_t cols;
+    int32_t type;
+    int32_t _pad;
+    PoseRecord pose;
+};
+
+class ShmPublisher
+{
+public:
+    ShmPublisher();
+    ~ShmPublisher();
+
+    int open(std::string name, cv::Size frameSize, int type, int slots = 4);
+    void close();
+    bool isOpen() const;
+
+    int publish(const cv::Mat &frame, double timestamp, const cv::Mat &rot, const cv::Mat &trans, bool posed);
+
+    // frames published, and frames refused because they did not fit a slot
+    uint64_t publishedFrames;
+    uint64_t refusedFrames;
+
+private:
+    ShmPublisher(const ShmPublisher &);
+    ShmPublisher &operator=(const ShmPublisher &);
+
+    std::string name;
+    ShmHeader *header;
+    size_t bytes;
+};
+
+class ShmReader
+{
+public:
+    ShmReader();
+    ~ShmReader();
+
+    int open(std::string name);
+    void close();
+    bool isOpen() const;
+
+    int read(cv::Mat &frame, PoseRecord &pose, double &timestamp, uint64_t &frameNumber);
+
+    // frames read, frames published while none of our reads picked them up, and reads spoilt by the publisher
+    uint64_t readFrames;
+    uint64_t missedFrames;
+    uint64_t tornFrames;
+
+private:
+    ShmReader(const ShmReader &);
+    ShmReader &operator=(const ShmReader &);
+
+    const ShmHeader *header;
+    size_t bytes;
+    uint64_t lastFrame;
+};
+
+#endif
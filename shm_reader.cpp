@@ -0,0 +1,71 @@
+/*
+Puja Chaudhury
+
+This is a CPP program that shows what an AR program publishes to shared memory (started with --publish <name>).
+It attaches to the segment, displays the newest frame with the target's pose, and attaches again whenever the
+publisher restarts. Frames the reader was too slow for are skipped, never queued.
+Usage: shm_reader [name]
+*/
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <opencv2/core.hpp>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "shm_publisher.h"
+
+int main(int argc, char *argv[])
+{
+    std::string name = argc > 1 ? argv[1] : "/ar_frames";
+
+    ShmReader reader;
+    cv::Mat frame;
+    cv::namedWindow("Published", 1);
+
+    while (true)
+    {
+        if (!reader.isOpen() && reader.open(name) != 0)
+        {
+            printf("Waiting for a publisher on %s\n", name.c_str());
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
+
+        PoseRecord pose;
+        double timestamp;
+        uint64_t frameNumber;
+        int status = reader.read(frame, pose, timestamp, frameNumber);
+        if (status == -2)
+        {
+            printf("Publisher closed %s\n", name.c_str());
+            reader.close();
+            continue;
+        }
+
+        if (status == 0)
+        {
+            if (pose.valid)
+            {
+                printf("frame %llu at %.3f s: rvec [%.4f %.4f %.4f] tvec [%.3f %.3f %.3f]\n", (unsigned long long)frameNumber, timestamp,
+                       pose.rvec[0], pose.rvec[1], pose.rvec[2], pose.tvec[0], pose.tvec[1], pose.tvec[2]);
+            }
+            cv::imshow("Published", frame);
+        }
+
+        // with nothing new the wait is short; imshow only repaints during waitKey anyway
+        char key = cv::waitKey(status == 0 ? 1 : 5);
+        if (key == 'q')
+        {
+            break;
+        }
+    }
+
+    printf("Read %llu frames, skipped %llu, %llu overwritten while being copied\n",
+           (unsigned long long)reader.readFrames, (unsigned long long)reader.missedFrames, (unsigned long long)reader.tornFrames);
+
+    return (0);
+}
@@ -0,0 +1,241 @@
+/*
+Puja Chaudhury
+synthetic_board.cpp
+Function implementations for rendering calibration targets with known ground truth.
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "synthetic_board.h"
+
+// grey level around the board, darker than the paper so the board's outline is visible
+static const int backgroundGrey = 90;
+
+// each output pixel averages supersample x supersample samples of the board
+static const int supersample = 2;
+
+ImagingConditions::ImagingConditions()
+    : blurSigma(0),
+      noiseSigma(0),
+      contrast(1),
+      brightness(0),
+      gradient(0)
+{
+}
+
+/*
+This function draws the printed target as a single-channel texture, white paper with black features.
+extent is the area of the board plane in board units that the texture covers, with y pointing up.
+ */
+int renderBoardTexture(BoardPattern pattern, const std::vector<cv::Vec3f> &points, float pixelsPerUnit, cv::Mat &texture, cv::Rect2f &extent)
+{
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        minX = std::min(minX, points[i][0]);
+        maxX = std::max(maxX, points[i][0]);
+        minY = std::min(minY, points[i][1]);
+        maxY = std::max(maxY, points[i][1]);
+    }
+
+    // the chessboard has a row of squares beyond its outer corners, and every target a white border
+    float margin = pattern == BoardPattern::Chessboard ? 2.0f : 1.5f;
+    extent = cv::Rect2f(minX - margin, minY - margin, maxX - minX + 2 * margin, maxY - minY + 2 * margin);
+    texture.create(cvRound(extent.height * pixelsPerUnit), cvRound(extent.width * pixelsPerUnit), CV_8UC1);
+    texture.setTo(cv::Scalar(255));
+
+    if (pattern == BoardPattern::Chessboard)
+    {
+        // square (a, b) covers x in [a, a + 1] and y in [b, b + 1]; corners are where four squares meet
+        for (int b = (int)minY - 1; b <= (int)maxY; b++)
+        {
+            for (int a = (int)minX - 1; a <= (int)maxX; a++)
+            {
+                if ((a + b) % 2 != 0)
+                {
+                    continue;
+                }
+                int u0 = cvRound((a - extent.x) * pixelsPerUnit);
+                int u1 = cvRound((a + 1 - extent.x) * pixelsPerUnit);
+                int v0 = cvRound((extent.y + extent.height - (b + 1)) * pixelsPerUnit);
+                int v1 = cvRound((extent.y + extent.height - b) * pixelsPerUnit);
+                cv::rectangle(texture, cv::Point(u0, v0), cv::Point(u1 - 1, v1 - 1), cv::Scalar(0), cv::FILLED);
+            }
+        }
+    }
+    else
+    {
+        // circles are drawn with 4 fractional bits so their centres land exactly; a board point maps to the texel
+        // coordinate renderPlane samples it at, half a texel before its edge offset, as OpenCV centres pixels on integers
+        const int shift = 4;
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            cv::Point center(cvRound(((points[i][0] - extent.x) * pixelsPerUnit - 0.5) * (1 << shift)),
+                             cvRound(((extent.y + extent.height - points[i][1]) * pixelsPerUnit - 0.5) * (1 << shift)));
+            cv::circle(texture, center, cvRound(0.4f * pixelsPerUnit * (1 << shift)), cv::Scalar(0), cv::FILLED, cv::LINE_AA, shift);
+        }
+    }
+
+    return (0);
+}
+
+/*
+This function renders the textured board plane z = 0 into a single-channel image as the camera sees it.
+Each supersampled pixel is traced back through the lens distortion to a ray, the ray is intersected with the board
+and the texture is sampled there; the samples are then averaged down to the output size.
+ */
+int renderPlane(const cv::Mat &texture, const cv::Rect2f &extent, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, cv::Size imageSize, cv::Mat &image)
+{
+    cv::Size size(imageSize.width * supersample, imageSize.height * supersample);
+    cv::Mat pixels(size.area(), 1, CV_32FC2);
+    cv::Vec2f *p = pixels.ptr<cv::Vec2f>();
+    for (int y = 0; y < size.height; y++)
+    {
+        for (int x = 0; x < size.width; x++)
+        {
+            *p++ = cv::Vec2f((x + 0.5f) / supersample - 0.5f, (y + 0.5f) / supersample - 0.5f);
+        }
+    }
+
+    cv::Mat rays;
+    cv::undistortPoints(pixels, rays, camera_matrix, dist_coeff, cv::noArray(), cv::noArray(),
+                        cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 20, 1e-7));
+
+    cv::Mat rotMat, R, t;
+    cv::Rodrigues(rot, rotMat);
+    rotMat.convertTo(R, CV_64F);
+    trans.convertTo(t, CV_64F);
+    const double *r = R.ptr<double>();
+    double t0 = t.at<double>(0), t1 = t.at<double>(1), t2 = t.at<double>(2);
+
+    // the board's normal in camera coordinates and its distance along it
+    double nt = r[2] * t0 + r[5] * t1 + r[8] * t2;
+    double pixelsPerUnit = texture.cols / extent.width;
+
+    cv::Mat mapX(size, CV_32FC1), mapY(size, CV_32FC1);
+    const cv::Vec2f *ray = rays.ptr<cv::Vec2f>();
+    float *mx = mapX.ptr<float>();
+    float *my = mapY.ptr<float>();
+    for (int i = 0; i < size.area(); i++)
+    {
+        double x = ray[i][0], y = ray[i][1];
+        double denom = r[2] * x + r[5] * y + r[8];
+        double s = denom != 0 ? nt / denom : -1;
+        if (s <= 0)
+        {
+            mx[i] = my[i] = -1e4f;
+            continue;
+        }
+
+        // back from camera to board coordinates with the transposed rotation
+        double c0 = s * x - t0, c1 = s * y - t1, c2 = s - t2;
+        double bx = r[0] * c0 + r[3] * c1 + r[6] * c2;
+        double by = r[1] * c0 + r[4] * c1 + r[7] * c2;
+        mx[i] = (float)((bx - extent.x) * pixelsPerUnit - 0.5);
+        my[i] = (float)((extent.y + extent.height - by) * pixelsPerUnit - 0.5);
+    }
+
+    cv::Mat sampled;
+    cv::remap(texture, sampled, mapX, mapY, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar(backgroundGrey));
+    cv::resize(sampled, image, imageSize, 0, 0, cv::INTER_AREA);
+
+    return (0);
+}
+
+/*
+This function turns a rendered board into a camera-like BGR frame: blur first, as the lens would, then lighting and sensor noise.
+ */
+int applyConditions(const cv::Mat &rendered, const ImagingConditions &conditions, cv::RNG &rng, cv::Mat &image)
+{
+    cv::Mat f;
+    rendered.convertTo(f, CV_32F);
+
+    if (conditions.blurSigma > 0)
+    {
+        cv::GaussianBlur(f, f, cv::Size(0, 0), conditions.blurSigma);
+    }
+
+    for (int y = 0; y < f.rows; y++)
+    {
+        float *row = f.ptr<float>(y);
+        for (int x = 0; x < f.cols; x++)
+        {
+            double ramp = conditions.gradient * ((x + 0.5) / f.cols - 0.5);
+            row[x] = (float)((row[x] - 128) * conditions.contrast + 128 + conditions.brightness + ramp);
+        }
+    }
+
+    if (conditions.noiseSigma > 0)
+    {
+        cv::Mat noise(f.size(), CV_32F);
+        rng.fill(noise, cv::RNG::NORMAL, 0, conditions.noiseSigma);
+        f += noise;
+    }
+
+    cv::Mat gray;
+    f.convertTo(gray, CV_8U);
+    cv::cvtColor(gray, image, cv::COLOR_GRAY2BGR);
+
+    return (0);
+}
+
+/*
+This function picks a random pose from which the whole board is visible: the camera looks at the board's centre
+from up to 40 degrees off its normal, rolled by up to 20 degrees, at a distance where the board fills roughly half the image.
+It returns -1 if no such pose was found.
+ */
+int randomBoardPose(const std::vector<cv::Vec3f> &points, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Size imageSize, cv::RNG &rng, cv::Mat &rot, cv::Mat &trans)
+{
+    cv::Vec3d center(0, 0, 0);
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        center += cv::Vec3d(points[i][0], points[i][1], points[i][2]);
+    }
+    center *= 1.0 / points.size();
+
+    double radius = 0;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        radius = std::max(radius, cv::norm(cv::Vec3d(points[i][0], points[i][1], points[i][2]) - center));
+    }
+    double fx = camera_matrix.at<double>(0, 0);
+
+    for (int attempt = 0; attempt < 100; attempt++)
+    {
+        double tilt = rng.uniform(0.0, 40.0) * CV_PI / 180;
+        double azimuth = rng.uniform(0.0, 2 * CV_PI);
+        double roll = rng.uniform(-20.0, 20.0) * CV_PI / 180;
+        double distance = 2 * radius * fx / (imageSize.width * rng.uniform(0.45, 0.8));
+
+        cv::Vec3d position = center + distance * cv::Vec3d(std::sin(tilt) * std::cos(azimuth), std::sin(tilt) * std::sin(azimuth), std::cos(tilt));
+
+        // camera axes in board coordinates: z towards the board's centre, y as close to down the board as possible
+        cv::Vec3d z = cv::normalize(center - position);
+        cv::Vec3d down(0, -1, 0);
+        cv::Vec3d y = cv::normalize(down - down.dot(z) * z);
+        cv::Vec3d x = y.cross(z);
+        cv::Vec3d xr = std::cos(roll) * x + std::sin(roll) * y;
+        cv::Vec3d yr = -std::sin(roll) * x + std::cos(roll) * y;
+
+        cv::Mat R = (cv::Mat_<double>(3, 3) << xr[0], xr[1], xr[2], yr[0], yr[1], yr[2], z[0], z[1], z[2]);
+        cv::Mat t = -R * cv::Mat(position);
+        cv::Rodrigues(R, rot);
+        trans = t;
+
+        std::vector<cv::Point2f> projected;
+        cv::projectPoints(points, rot, trans, camera_matrix, dist_coeff, projected);
+        bool inside = true;
+        for (size_t i = 0; i < projected.size() && inside; i++)
+        {
+            inside = projected[i].x > 20 && projected[i].y > 20 && projected[i].x < imageSize.width - 20 && projected[i].y < imageSize.height - 20;
+        }
+        if (inside)
+        {
+            return (0);
+        }
+    }
+
+    return (-1);
+}
@@ -0,0 +1,65 @@
+/*
+Puja Chaudhury
+synthetic_board.h
+Rendering the calibration targets under known intrinsics and poses, so detection and pose estimation can be checked
+against exact ground truth. Blur, noise, lighting and lens distortion are controlled by the caller.
+*/
+
+#ifndef synthetic_board_hpp
+#define synthetic_board_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/calib3d.hpp>
+
+#include "board.h"
+
+// Image degradations applied after the board is rendered
+struct ImagingConditions
+{
+    ImagingConditions();
+
+    double blurSigma;  // Gaussian blur in pixels, 0 for none
+    double noiseSigma; // additive Gaussian noise in grey levels
+    double contrast;   // scale of the black-to-white range around mid grey
+    double brightness; // grey level added everywhere
+    double gradient;   // grey-level change from the left to the right edge, like uneven lighting
+};
+
+int renderBoardTexture(BoardPattern pattern, const std::vector<cv::Vec3f> &points, float pixelsPerUnit, cv::Mat &texture, cv::Rect2f &extent);
+
+int renderPlane(const cv::Mat &texture, const cv::Rect2f &extent, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, cv::Size imageSize, cv::Mat &image);
+
+int applyConditions(const cv::Mat &rendered, const ImagingConditions &conditions, cv::RNG &rng, cv::Mat &image);
+
+int randomBoardPose(const std::vector<cv::Vec3f> &points, cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Size imageSize, cv::RNG &rng, cv::Mat &rot, cv::Mat &trans);
+
+/*
+This function renders the target described by Board into a BGR image as seen with the given intrinsics and pose,
+and returns the exact image positions of its feature points in the order the detectors report them.
+The board's texture is drawn once per target type and reused.
+ */
+template <typename Board>
+int renderSyntheticBoard(cv::Mat &camera_matrix, cv::Mat &dist_coeff, cv::Mat &rot, cv::Mat &trans, cv::Size imageSize, const ImagingConditions &conditions, cv::RNG &rng,
+                         cv::Mat &image, std::vector<cv::Point2f> &corners)
+{
+    static cv::Mat texture;
+    static cv::Rect2f extent;
+    std::vector<cv::Vec3f> points;
+    Board::objectPoints(points);
+    if (texture.empty())
+    {
+        renderBoardTexture(Board::pattern, points, 40, texture, extent);
+    }
+
+    cv::Mat rendered;
+    renderPlane(texture, extent, camera_matrix, dist_coeff, rot, trans, imageSize, rendered);
+    applyConditions(rendered, conditions, rng, image);
+    cv::projectPoints(points, rot, trans, camera_matrix, dist_coeff, corners);
+
+    return (0);
+}
+
+#endif
@@ -0,0 +1,419 @@
+/*
+Puja Chaudhury
+target_index.cpp
+Function implementations for writing, memory-mapping and searching the picture target index.
+*/
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "target_index.h"
+
+static const uint32_t targetIndexVersion = 1;
+
+/*
+This function makes the key a descriptor is filed under in one table, from the descriptor bits the table samples.
+ */
+static uint32_t hashKey(const uchar *descriptor, const uint32_t *bits, int keyBits)
+{
+    uint32_t key = 0;
+    for (int b = 0; b < keyBits; b++)
+    {
+        key |= (uint32_t)((descriptor[bits[b] >> 3] >> (bits[b] & 7)) & 1) << b;
+    }
+    return (key);
+}
+
+static uint64_t align8(uint64_t offset)
+{
+    return ((offset + 7) & ~(uint64_t)7);
+}
+
+/*
+This function lays out the header's offsets for the given counts and returns the size of the whole file.
+ */
+static uint64_t layoutIndex(TargetIndexHeader &h)
+{
+    uint64_t buckets = (uint64_t)h.numTables * ((1u << h.keyBits) + 1);
+    h.targetsOffset = align8(sizeof(TargetIndexHeader));
+    h.pointsOffset = align8(h.targetsOffset + (uint64_t)h.numTargets * sizeof(TargetIndexEntry));
+    h.ownersOffset = align8(h.pointsOffset + (uint64_t)h.numFeatures * sizeof(cv::Point2f));
+    h.bitsOffset = align8(h.ownersOffset + (uint64_t)h.numFeatures * sizeof(uint32_t));
+    h.bucketsOffset = align8(h.bitsOffset + (uint64_t)h.numTables * h.keyBits * sizeof(uint32_t));
+    h.entriesOffset = align8(h.bucketsOffset + buckets * sizeof(uint32_t));
+    h.descriptorsOffset = align8(h.entriesOffset + (uint64_t)h.numTables * h.numFeatures * sizeof(uint32_t));
+    h.namesOffset = align8(h.descriptorsOffset + (uint64_t)h.numFeatures * h.descriptorBytes);
+    return (h.namesOffset + h.namesBytes);
+}
+
+/*
+This function writes the index of a set of targets. Each table samples keyBits distinct bits of the descriptor, chosen
+at random with the given seed, and files every feature under its key; the features of a key are stored together so a
+lookup is one range of the entries array. Like the mesh files, it is written to a temporary name and renamed.
+ */
+int buildTargetIndex(const std::vector<ImageTarget> &targets, std::string filename, int numTables, int keyBits, uint64_t seed)
+{
+    TargetIndexHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "ARTI", 4);
+    h.version = targetIndexVersion;
+    h.numTargets = (uint32_t)targets.size();
+    h.numTables = (uint32_t)numTables;
+    h.keyBits = (uint32_t)keyBits;
+    h.descriptorBytes = 32;
+
+    for (size_t i = 0; i < targets.size(); i++)
+    {
+        if (targets[i].descriptors.type() != CV_8UC1 || targets[i].descriptors.cols != (int)h.descriptorBytes)
+        {
+            printf("%s does not have 32-byte ORB descriptors\n", targets[i].name.c_str());
+            return (-1);
+        }
+        h.numFeatures += (uint32_t)targets[i].keypoints.size();
+        h.namesBytes += (uint32_t)targets[i].name.size() + 1;
+    }
+    // by default the keys grow with the catalogue so a bucket holds about four features whatever its size,
+    // which keeps the comparisons per lookup roughly constant
+    if (keyBits <= 0)
+    {
+        keyBits = 8;
+        while (keyBits < 22 && (h.numFeatures >> (keyBits + 1)) >= 4)
+        {
+            keyBits++;
+        }
+        h.keyBits = (uint32_t)keyBits;
+    }
+    if (keyBits < 1 || keyBits > 24 || (uint64_t)h.descriptorBytes * 8 < (uint64_t)keyBits)
+    {
+        printf("Key length of %d bits is not supported\n", keyBits);
+        return (-1);
+    }
+
+    uint64_t fileSize = layoutIndex(h);
+    std::vector<uchar> file(fileSize, 0);
+    memcpy(file.data(), &h, sizeof(h));
+
+    TargetIndexEntry *entries = (TargetIndexEntry *)(file.data() + h.targetsOffset);
+    cv::Point2f *points = (cv::Point2f *)(file.data() + h.pointsOffset);
+    uint32_t *owners = (uint32_t *)(file.data() + h.ownersOffset);
+    uchar *descriptors = file.data() + h.descriptorsOffset;
+    char *names = (char *)(file.data() + h.namesOffset);
+
+    uint32_t feature = 0;
+    uint32_t nameOffset = 0;
+    for (size_t i = 0; i < targets.size(); i++)
+    {
+        const ImageTarget &t = targets[i];
+        entries[i].firstFeature = feature;
+        entries[i].numFeatures = (uint32_t)t.keypoints.size();
+        entries[i].width = (uint32_t)t.size.width;
+        entries[i].height = (uint32_t)t.size.height;
+        entries[i].unitsPerPixel = t.unitsPerPixel;
+        entries[i].nameOffset = nameOffset;
+        memcpy(names + nameOffset, t.name.c_str(), t.name.size() + 1);
+        nameOffset += (uint32_t)t.name.size() + 1;
+
+        for (size_t k = 0; k < t.keypoints.size(); k++, feature++)
+        {
+            points[feature] = t.keypoints[k].pt;
+            owners[feature] = (uint32_t)i;
+            memcpy(descriptors + (size_t)feature * h.descriptorBytes, t.descriptors.ptr((int)k), h.descriptorBytes);
+        }
+    }
+
+    // distinct random bits for every table
+    cv::RNG rng(seed);
+    uint32_t *bits = (uint32_t *)(file.data() + h.bitsOffset);
+    std::vector<uint32_t> order(h.descriptorBytes * 8);
+    for (int t = 0; t < numTables; t++)
+    {
+        for (size_t b = 0; b < order.size(); b++)
+        {
+            order[b] = (uint32_t)b;
+        }
+        for (int b = 0; b < keyBits; b++)
+        {
+            std::swap(order[b], order[b + rng.uniform(0, (int)order.size() - b)]);
+            bits[t * keyBits + b] = order[b];
+        }
+    }
+
+    // each table's features, counted per key and then placed in key order
+    uint32_t numKeys = 1u << keyBits;
+    uint32_t *buckets = (uint32_t *)(file.data() + h.bucketsOffset);
+    uint32_t *tableEntries = (uint32_t *)(file.data() + h.entriesOffset);
+    std::vector<uint32_t> keys(h.numFeatures);
+    for (int t = 0; t < numTables; t++)
+    {
+        uint32_t *bucket = buckets + (size_t)t * (numKeys + 1);
+        uint32_t *entry = tableEntries + (size_t)t * h.numFeatures;
+        for (uint32_t f = 0; f < h.numFeatures; f++)
+        {
+            keys[f] = hashKey(descriptors + (size_t)f * h.descriptorBytes, bits + t * keyBits, keyBits);
+            bucket[keys[f] + 1]++;
+        }
+        for (uint32_t k = 0; k < numKeys; k++)
+        {
+            bucket[k + 1] += bucket[k];
+        }
+        std::vector<uint32_t> next(bucket, bucket + numKeys);
+        for (uint32_t f = 0; f < h.numFeatures; f++)
+        {
+            entry[next[keys[f]]++] = f;
+        }
+    }
+
+    std::string tmpName = filename + ".tmp";
+    FILE *fp = fopen(tmpName.c_str(), "wb");
+    if (!fp)
+    {
+        printf("Unable to write target index %s\n", filename.c_str());
+        return (-1);
+    }
+    bool ok = fwrite(file.data(), 1, file.size(), fp) == file.size();
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(tmpName.c_str(), filename.c_str()) != 0)
+    {
+        printf("Unable to write target index %s\n", filename.c_str());
+        remove(tmpName.c_str());
+        return (-1);
+    }
+
+    return (0);
+}
+
+TargetIndex::TargetIndex()
+    : maxDistance(64),
+      matchRatio(0.8f),
+      minVotes(8),
+      comparisons(0),
+      data(NULL),
+      size(0)
+{
+}
+
+TargetIndex::~TargetIndex()
+{
+    close();
+}
+
+/*
+This function maps an index file read-only and checks that its header matches the file size.
+Only the pages a lookup touches are read from disk.
+ */
+int TargetIndex::open(std::string filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        printf("Unable to open target index %s\n", filename.c_str());
+        return (-1);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TargetIndexHeader))
+    {
+        ::close(fd);
+        printf("%s is not a target index\n", filename.c_str());
+        return (-1);
+    }
+    void *mapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        printf("Unable to map target index %s\n", filename.c_str());
+        return (-1);
+    }
+
+    TargetIndexHeader h = *(const TargetIndexHeader *)mapped;
+    TargetIndexHeader expected = h;
+    bool valid = memcmp(h.magic, "ARTI", 4) == 0 && h.version == targetIndexVersion && h.keyBits >= 1 && h.keyBits <= 24 &&
+                 h.descriptorBytes == 32;
+    if (!valid || layoutIndex(expected) != (uint64_t)st.st_size || memcmp(&expected, &h, sizeof(h)) != 0)
+    {
+        munmap(mapped, (size_t)st.st_size);
+        printf("%s is not a valid target index\n", filename.c_str());
+        return (-1);
+    }
+
+    data = mapped;
+    size = (size_t)st.st_size;
+    votes.assign(h.numTargets, 0);
+    targetMatches.assign(h.numTargets, std::vector<cv::DMatch>());
+    touched.clear();
+
+    return (0);
+}
+
+void TargetIndex::close()
+{
+    if (data != NULL)
+    {
+        munmap(data, size);
+        data = NULL;
+        size = 0;
+    }
+}
+
+bool TargetIndex::isOpen() const
+{
+    return (data != NULL);
+}
+
+const TargetIndexHeader &TargetIndex::header() const
+{
+    return (*(const TargetIndexHeader *)data);
+}
+
+const TargetIndexEntry &TargetIndex::entry(int target) const
+{
+    return (((const TargetIndexEntry *)((const uchar *)data + header().targetsOffset))[target]);
+}
+
+int TargetIndex::numTargets() const
+{
+    return (data != NULL ? (int)header().numTargets : 0);
+}
+
+std::string TargetIndex::name(int target) const
+{
+    return (std::string((const char *)data + header().namesOffset + entry(target).nameOffset));
+}
+
+/*
+This function returns where a target's feature lies on its picture, in picture pixels.
+ */
+cv::Point2f TargetIndex::point(int target, int feature) const
+{
+    const cv::Point2f *points = (const cv::Point2f *)((const uchar *)data + header().pointsOffset);
+    return (points[entry(target).firstFeature + feature]);
+}
+
+/*
+This function fills an ImageTarget from the index so a recognised target can be followed and matched on its own.
+Its descriptors point into the mapped file, so they are valid while the index is open.
+ */
+int TargetIndex::target(int index, ImageTarget &target) const
+{
+    if (data == NULL || index < 0 || index >= numTargets())
+    {
+        return (-1);
+    }
+
+    const TargetIndexEntry &e = entry(index);
+    target.name = name(index);
+    target.size = cv::Size((int)e.width, (int)e.height);
+    target.unitsPerPixel = e.unitsPerPixel;
+    target.keypoints.resize(e.numFeatures);
+    for (uint32_t k = 0; k < e.numFeatures; k++)
+    {
+        target.keypoints[k] = cv::KeyPoint(point(index, (int)k), 31);
+    }
+    const uchar *descriptors = (const uchar *)data + header().descriptorsOffset + (size_t)e.firstFeature * header().descriptorBytes;
+    target.descriptors = cv::Mat((int)e.numFeatures, (int)header().descriptorBytes, CV_8UC1, (void *)descriptors);
+
+    return (0);
+}
+
+/*
+This function finds the targets a frame's ORB descriptors most likely show. Each descriptor is looked up in every
+table and compared only with the catalogue features filed under the same key; its nearest one, if close enough and
+clearly closer than the runner-up, votes for the target it belongs to. The targets with at least minVotes votes are
+returned best first, with the matches that voted for them, ready for a homography check. It returns their number.
+ */
+int TargetIndex::query(const cv::Mat &descriptors, std::vector<TargetCandidate> &candidates, int maxCandidates)
+{
+    candidates.clear();
+    comparisons = 0;
+    if (data == NULL || descriptors.empty() || descriptors.cols != (int)header().descriptorBytes)
+    {
+        return (0);
+    }
+
+    const TargetIndexHeader &h = header();
+    const uchar *base = (const uchar *)data;
+    const uint32_t *bits = (const uint32_t *)(base + h.bitsOffset);
+    const uint32_t *buckets = (const uint32_t *)(base + h.bucketsOffset);
+    const uint32_t *tableEntries = (const uint32_t *)(base + h.entriesOffset);
+    const uint32_t *owners = (const uint32_t *)(base + h.ownersOffset);
+    const uchar *features = base + h.descriptorsOffset;
+    uint32_t numKeys = 1u << h.keyBits;
+
+    for (int q = 0; q < descriptors.rows; q++)
+    {
+        const uchar *d = descriptors.ptr(q);
+        int best = INT_MAX;
+        int second = INT_MAX;
+        int bestFeature = -1;
+        for (uint32_t t = 0; t < h.numTables; t++)
+        {
+            uint32_t key = hashKey(d, bits + t * h.keyBits, (int)h.keyBits);
+            const uint32_t *bucket = buckets + (size_t)t * (numKeys + 1);
+            const uint32_t *entry = tableEntries + (size_t)t * h.numFeatures;
+            for (uint32_t e = bucket[key]; e < bucket[key + 1]; e++)
+            {
+                int f = (int)entry[e];
+                if (f == bestFeature)
+                {
+                    continue;
+                }
+                int distance = cv::hal::normHamming(d, features + (size_t)f * h.descriptorBytes, (int)h.descriptorBytes);
+                comparisons++;
+                if (distance < best)
+                {
+                    second = best;
+                    best = distance;
+                    bestFeature = f;
+                }
+                else if (distance < second)
+                {
+                    second = distance;
+                }
+            }
+        }
+
+        if (bestFeature < 0 || best > maxDistance || (second != INT_MAX && best >= matchRatio * second))
+        {
+            continue;
+        }
+        int owner = (int)owners[bestFeature];
+        if (votes[owner] == 0)
+        {
+            touched.push_back(owner);
+        }
+        votes[owner]++;
+        targetMatches[owner].push_back(cv::DMatch(q, bestFeature - (int)entry(owner).firstFeature, (float)best));
+    }
+
+    for (size_t i = 0; i < touched.size(); i++)
+    {
+        int t = touched[i];
+        if (votes[t] >= minVotes)
+        {
+            candidates.push_back(TargetCandidate());
+            candidates.back().target = t;
+            candidates.back().votes = votes[t];
+            candidates.back().matches.swap(targetMatches[t]);
+        }
+        votes[t] = 0;
+        targetMatches[t].clear();
+    }
+    touched.clear();
+
+    std::sort(candidates.begin(), candidates.end(), [](const TargetCandidate &a, const TargetCandidate &b)
+              { return a.votes > b.votes; });
+    if ((int)candidates.size() > maxCandidates)
+    {
+        candidates.resize(maxCandidates);
+    }
+
+    return ((int)candidates.size());
+}
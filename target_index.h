@@ -0,0 +1,107 @@
+/*
+Puja Chaudhury
+target_index.h
+A catalogue of picture targets in one memory-mapped file, searched with locality-sensitive hashing of their ORB
+descriptors. Each hash table keys a descriptor by a fixed random subset of its bits, so a frame's descriptor is only
+compared with the few catalogue descriptors that share its key in some table, however many targets there are.
+Those comparisons vote for targets, and only the best voted candidates are checked geometrically.
+The file is written by build_target_index and mapped read-only at startup.
+*/
+
+#ifndef target_index_hpp
+#define target_index_hpp
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "image_target.h"
+
+// Layout of an index file: this header, then the arrays it gives the offsets of, in bytes from the start of the file
+struct TargetIndexHeader
+{
+    char magic[4]; // "ARTI"
+    uint32_t version;
+    uint32_t numTargets;
+    uint32_t numFeatures;
+    uint32_t numTables;
+    uint32_t keyBits;
+    uint32_t descriptorBytes;
+    uint32_t namesBytes;
+    uint64_t targetsOffset;     // TargetIndexEntry[numTargets]
+    uint64_t pointsOffset;      // cv::Point2f[numFeatures], picture pixels
+    uint64_t ownersOffset;      // uint32_t[numFeatures], the target each feature belongs to
+    uint64_t bitsOffset;        // uint32_t[numTables * keyBits], the descriptor bits each table's key is made of
+    uint64_t bucketsOffset;     // uint32_t[numTables * (2^keyBits + 1)], where each key's features start in entries
+    uint64_t entriesOffset;     // uint32_t[numTables * numFeatures], features sorted by key, table by table
+    uint64_t descriptorsOffset; // uint8_t[numFeatures * descriptorBytes]
+    uint64_t namesOffset;       // null-terminated names
+};
+
+struct TargetIndexEntry
+{
+    uint32_t firstFeature;
+    uint32_t numFeatures;
+    uint32_t width;
+    uint32_t height;
+    float unitsPerPixel;
+    uint32_t nameOffset;
+};
+
+// A target the index retrieved for a frame, with the matches that voted for it
+struct TargetCandidate
+{
+    int target;
+    int votes;
+    std::vector<cv::DMatch> matches; // queryIdx into the frame's descriptors, trainIdx into the target's features
+};
+
+int buildTargetIndex(const std::vector<ImageTarget> &targets, std::string filename, int numTables = 8, int keyBits = 0, uint64_t seed = 0x41525449);
+
+class TargetIndex
+{
+public:
+    TargetIndex();
+    ~TargetIndex();
+
+    int open(std::string filename);
+    void close();
+    bool isOpen() const;
+
+    int numTargets() const;
+    std::string name(int target) const;
+    cv::Point2f point(int target, int feature) const;
+    int target(int index, ImageTarget &target) const;
+
+    int query(const cv::Mat &descriptors, std::vector<TargetCandidate> &candidates, int maxCandidates = 3);
+
+    // a match counts when its Hamming distance is at most this, and clearly below the next best
+    int maxDistance;
+    float matchRatio;
+
+    // votes a target needs to become a candidate
+    int minVotes;
+
+    // descriptors compared in the last query, to see how much of the catalogue was touched
+    int comparisons;
+
+private:
+    TargetIndex(const TargetIndex &);
+    TargetIndex &operator=(const TargetIndex &);
+
+    const TargetIndexHeader &header() const;
+    const TargetIndexEntry &entry(int target) const;
+
+    void *data;
+    size_t size;
+
+    // per-target scratch for query(); only the targets a query voted for are cleared afterwards
+    std::vector<int> votes;
+    std::vector<std::vector<cv::DMatch>> targetMatches;
+    std::vector<int> touched;
+};
+
+#endif
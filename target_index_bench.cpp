@@ -0,0 +1,132 @@
+/*
+Puja Chaudhury
+
+This is a CPP program that measures how target recognition time grows with the size of the catalogue.
+For each catalogue size it builds an index of synthetic targets, maps it, and looks up frames that show one target:
+that target's descriptors with some bits flipped, mixed with descriptors of the background. Each lookup is timed
+against brute-force matching of the same frame with every descriptor of the catalogue.
+Usage: target_index_bench [largest catalogue] [features per target] [lookups]
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+
+#include "image_target.h"
+#include "target_index.h"
+
+/*
+This function makes a target with random ORB-sized descriptors at random places on a 640 x 480 picture.
+ */
+static void makeTarget(cv::RNG &rng, int number, int features, ImageTarget &target)
+{
+    target.name = "target" + std::to_string(number);
+    target.size = cv::Size(640, 480);
+    target.unitsPerPixel = 8.0f / 640;
+    target.keypoints.resize(features);
+    for (int k = 0; k < features; k++)
+    {
+        target.keypoints[k] = cv::KeyPoint(cv::Point2f(rng.uniform(0.f, 640.f), rng.uniform(0.f, 480.f)), 31);
+    }
+    target.descriptors.create(features, 32, CV_8UC1);
+    rng.fill(target.descriptors, cv::RNG::UNIFORM, 0, 256);
+}
+
+/*
+This function makes the descriptors of a frame showing the given target: part of its features seen again with a few
+bits changed, as the same corner gives a slightly different descriptor in every frame, and features of the background.
+ */
+static void makeFrame(cv::RNG &rng, const ImageTarget &target, int seen, int background, int flippedBits, cv::Mat &descriptors)
+{
+    descriptors.create(seen + background, 32, CV_8UC1);
+    for (int i = 0; i < seen; i++)
+    {
+        target.descriptors.row(rng.uniform(0, target.descriptors.rows)).copyTo(descriptors.row(i));
+        uchar *d = descriptors.ptr(i);
+        for (int b = 0; b < flippedBits; b++)
+        {
+            int bit = rng.uniform(0, 256);
+            d[bit >> 3] ^= (uchar)(1 << (bit & 7));
+        }
+    }
+    cv::Mat rest = descriptors.rowRange(seen, seen + background);
+    rng.fill(rest, cv::RNG::UNIFORM, 0, 256);
+}
+
+int main(int argc, char *argv[])
+{
+    int largest = argc > 1 ? std::stoi(argv[1]) : 1000;
+    int features = argc > 2 ? std::stoi(argv[2]) : 500;
+    int lookups = argc > 3 ? std::stoi(argv[3]) : 50;
+    std::string indexName = "target_index_bench.idx";
+
+    cv::RNG rng(12345);
+    std::vector<ImageTarget> targets;
+    cv::Ptr<cv::DescriptorMatcher> matcher = cv::BFMatcher::create(cv::NORM_HAMMING);
+
+    printf("%8s %10s %12s %12s %10s %14s %12s\n", "targets", "features", "index ms", "compared", "correct", "brute force ms", "correct");
+    const int sizes[] = {1, 10, 50, 100, 200, 500, 1000, 2000, 5000};
+    for (int s = 0; s < 9 && sizes[s] <= largest; s++)
+    {
+        int size = sizes[s];
+        while ((int)targets.size() < size)
+        {
+            targets.push_back(ImageTarget());
+            makeTarget(rng, (int)targets.size() - 1, features, targets.back());
+        }
+
+        TargetIndex index;
+        if (buildTargetIndex(targets, indexName) != 0 || index.open(indexName) != 0)
+        {
+            return (-1);
+        }
+
+        // the whole catalogue in one matrix, for brute force; each row's target is its row divided by features
+        cv::Mat catalogue;
+        for (int t = 0; t < size; t++)
+        {
+            catalogue.push_back(targets[t].descriptors);
+        }
+
+        double indexMs = 0, bruteMs = 0;
+        long compared = 0;
+        int indexCorrect = 0, bruteCorrect = 0;
+        for (int l = 0; l < lookups; l++)
+        {
+            int shown = rng.uniform(0, size);
+            cv::Mat frame;
+            makeFrame(rng, targets[shown], features / 2, features / 2, 20, frame);
+
+            double start = (double)cv::getTickCount();
+            std::vector<TargetCandidate> candidates;
+            index.query(frame, candidates, 1);
+            indexMs += ((double)cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+            compared += index.comparisons;
+            indexCorrect += !candidates.empty() && candidates[0].target == shown ? 1 : 0;
+
+            start = (double)cv::getTickCount();
+            std::vector<std::vector<cv::DMatch>> matches;
+            matcher->knnMatch(frame, catalogue, matches, 2);
+            std::vector<int> votes(size, 0);
+            for (size_t i = 0; i < matches.size(); i++)
+            {
+                if (matches[i].size() == 2 && matches[i][0].distance < 0.8f * matches[i][1].distance)
+                {
+                    votes[matches[i][0].trainIdx / features]++;
+                }
+            }
+            bruteMs += ((double)cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+            bruteCorrect += std::max_element(votes.begin(), votes.end()) - votes.begin() == shown ? 1 : 0;
+        }
+
+        printf("%8d %10d %12.3f %12ld %9.0f%% %14.3f %11.0f%%\n", size, size * features, indexMs / lookups, compared / lookups,
+               100.0 * indexCorrect / lookups, bruteMs / lookups, 100.0 * bruteCorrect / lookups);
+    }
+
+    remove(indexName.c_str());
+    return (0);
+}
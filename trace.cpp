@@ -0,0 +1,250 @@
+/*
+Puja Chaudhury
+trace.cpp
+Function implementations for recording per-thread timeline events and writing them as Chrome trace JSON.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <unistd.h>
+
+#include "trace.h"
+
+struct TraceEvent
+{
+    const char *name;
+    int64_t time; // nanoseconds since traceStart
+    int64_t frame;
+    char phase;   // 'B' or 'E'
+};
+
+// The events of one thread. Only that thread writes events and count; other threads read up to count.
+struct TraceBuffer
+{
+    std::vector<TraceEvent> events;
+    std::atomic<size_t> count;
+    std::atomic<uint64_t> dropped;
+    std::atomic<const char *> name;
+    int tid;
+};
+
+// buffers are taken from this table without a lock and live as long as the process, so a late event never writes freed memory
+static const int maxThreads = 256;
+static std::atomic<TraceBuffer *> buffers[maxThreads];
+static std::atomic<int> numBuffers(0);
+
+static std::atomic<bool> tracing(false);
+static std::atomic<size_t> capacity(1 << 18);
+static std::atomic<int64_t> startTime(0);
+
+static thread_local TraceBuffer *threadBuffer = NULL;
+static thread_local bool threadUntraced = false;
+static thread_local const char *threadName = NULL;
+static thread_local int64_t threadFrame = -1;
+
+static int64_t now()
+{
+    return (std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/*
+This function returns the calling thread's buffer, taking a slot of the table the first time it is called on a thread,
+or NULL when every slot is taken.
+ */
+static TraceBuffer *localBuffer()
+{
+    if (threadBuffer != NULL || threadUntraced)
+    {
+        return (threadBuffer);
+    }
+
+    int slot = numBuffers.fetch_add(1);
+    if (slot >= maxThreads)
+    {
+        threadUntraced = true;
+        return (NULL);
+    }
+    TraceBuffer *buffer = new TraceBuffer();
+    buffer->events.resize(capacity.load());
+    buffer->count.store(0);
+    buffer->dropped.store(0);
+    buffer->name.store(threadName);
+    buffer->tid = slot + 1;
+    buffers[slot].store(buffer, std::memory_order_release);
+    threadBuffer = buffer;
+    return (buffer);
+}
+
+static void record(const char *name, int64_t frame, char phase)
+{
+    if (!tracing.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    TraceBuffer *buffer = localBuffer();
+    if (buffer == NULL)
+    {
+        return;
+    }
+
+    size_t n = buffer->count.load(std::memory_order_relaxed);
+    if (n >= buffer->events.size())
+    {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    TraceEvent &event = buffer->events[n];
+    event.name = name;
+    event.time = now() - startTime.load(std::memory_order_relaxed);
+    event.frame = frame >= 0 ? frame : threadFrame;
+    event.phase = phase;
+    buffer->count.store(n + 1, std::memory_order_release);
+}
+
+/*
+This function clears what earlier runs recorded and starts recording. Threads that trace for the first time get a
+buffer of eventsPerThread events; once it is full, further events of that thread are counted as dropped.
+It should be called before the threads being traced start recording, as their counts are reset.
+ */
+void traceStart(size_t eventsPerThread)
+{
+    capacity.store(eventsPerThread > 0 ? eventsPerThread : 1);
+    int n = std::min(numBuffers.load(), maxThreads);
+    for (int i = 0; i < n; i++)
+    {
+        TraceBuffer *buffer = buffers[i].load(std::memory_order_acquire);
+        if (buffer != NULL)
+        {
+            buffer->count.store(0);
+            buffer->dropped.store(0);
+        }
+    }
+    startTime.store(now());
+    tracing.store(true);
+}
+
+void traceStop()
+{
+    tracing.store(false);
+}
+
+bool traceEnabled()
+{
+    return (tracing.load(std::memory_order_relaxed));
+}
+
+/*
+This function names the calling thread in the timeline. It may be called before tracing starts.
+ */
+void traceThreadName(const char *name)
+{
+    threadName = name;
+    if (threadBuffer != NULL)
+    {
+        threadBuffer->name.store(name, std::memory_order_relaxed);
+    }
+}
+
+/*
+This function sets the frame the calling thread's events belong to when they are not given one.
+ */
+void traceFrame(int64_t frame)
+{
+    threadFrame = frame;
+}
+
+/*
+This function returns the frame set with traceFrame() on the calling thread, so work handed to another thread can
+be traced as part of the frame that queued it.
+ */
+int64_t traceCurrentFrame()
+{
+    return (threadFrame);
+}
+
+void traceBegin(const char *name, int64_t frame)
+{
+    record(name, frame, 'B');
+}
+
+void traceEnd(const char *name, int64_t frame)
+{
+    record(name, frame, 'E');
+}
+
+TraceScope::TraceScope(const char *name, int64_t frame)
+    : name(name),
+      frame(frame)
+{
+    traceBegin(name, frame);
+}
+
+TraceScope::~TraceScope()
+{
+    traceEnd(name, frame);
+}
+
+/*
+This function writes every recorded event to a Chrome trace JSON file, with a thread_name entry for each named thread.
+Each thread's events are read up to the count it last published, so it can be called while other threads still record.
+ */
+int traceWrite(std::string filename)
+{
+    FILE *fp = fopen(filename.c_str(), "w");
+    if (fp == NULL)
+    {
+        printf("Unable to open trace file %s\n", filename.c_str());
+        return (-1);
+    }
+
+    int pid = (int)getpid();
+    size_t written = 0;
+    uint64_t dropped = 0;
+    int n = std::min(numBuffers.load(), maxThreads);
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"ar\"}}", pid);
+    for (int i = 0; i < n; i++)
+    {
+        TraceBuffer *buffer = buffers[i].load(std::memory_order_acquire);
+        if (buffer == NULL)
+        {
+            continue;
+        }
+        const char *name = buffer->name.load(std::memory_order_relaxed);
+        if (name != NULL)
+        {
+            fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", pid, buffer->tid, name);
+        }
+
+        size_t count = buffer->count.load(std::memory_order_acquire);
+        for (size_t e = 0; e < count; e++)
+        {
+            const TraceEvent &event = buffer->events[e];
+            fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"frame\":%lld}}",
+                    event.name, event.phase, event.time / 1000.0, pid, buffer->tid, (long long)event.frame);
+        }
+        written += count;
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    fprintf(fp, "\n]}\n");
+    bool failed = ferror(fp) != 0;
+    fclose(fp);
+    if (failed)
+    {
+        printf("Unable to write trace file %s\n", filename.c_str());
+        return (-1);
+    }
+
+    printf("Wrote %d trace events from %d threads to %s", (int)written, n, filename.c_str());
+    if (dropped > 0)
+    {
+        printf(", %llu dropped on full buffers", (unsigned long long)dropped);
+    }
+    printf("\n");
+
+    return (0);
+}
@@ -0,0 +1,43 @@
+/*
+Puja Chaudhury
+trace.h
+A timeline of what every thread did in every frame, written as Chrome trace JSON to open in Perfetto or chrome://tracing.
+Each thread records begin and end events into a fixed buffer of its own, so recording takes no lock and never waits
+for another thread; only the thread that owns a buffer writes to it, and publishes each event with a release store of
+its count. While tracing is off, every call costs one relaxed load. Event names are not copied, so they must be string
+literals or otherwise outlive the trace.
+*/
+
+#ifndef trace_hpp
+#define trace_hpp
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+void traceStart(size_t eventsPerThread = 1 << 18);
+void traceStop();
+bool traceEnabled();
+
+void traceThreadName(const char *name);
+void traceFrame(int64_t frame);
+int64_t traceCurrentFrame();
+
+void traceBegin(const char *name, int64_t frame = -1);
+void traceEnd(const char *name, int64_t frame = -1);
+
+int traceWrite(std::string filename);
+
+// Traces the enclosing block as one event
+class TraceScope
+{
+public:
+    TraceScope(const char *name, int64_t frame = -1);
+    ~TraceScope();
+
+private:
+    const char *name;
+    int64_t frame;
+};
+
+#endif
@@ -0,0 +1,212 @@
+/*
+Puja Chaudhury
+
+This is a CPP program that places virtual objects on whichever calibration target is in view, chessboard or circle grid,
+without choosing the target beforehand. All target detectors run concurrently on each frame until one target has been
+seen steadily; then only that target is tracked, with its own saved calibration, until it leaves the view.
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "calibration.h"
+#include "3D_projection.h"
+#include "multi_target.h"
+#include "buffer_pool.h"
+#include "circle_tracker.h"
+#include "frame_loop.h"
+#include "overlay_layer.h"
+#include "yuv_source.h"
+
+int main(int argc, char *argv[])
+{
+    // The same options as the single-target programs, described in frame_loop.h
+    FrameLoop loop;
+    if (loop.open(argc, argv) != 0)
+    {
+        return (-1);
+    }
+    cv::Mat &videoFrame = loop.videoFrame;
+
+    // Every target the program can recognise, with the scene drawn on it; the first registered wins ties.
+    // They are registered in the order of their POSE_TARGET ids, so a detector's index is its id in the pose stream
+    MultiTargetDetector targets;
+    std::vector<TargetScene *> scenes;
+    targets.add(makeTargetDetector<ChessboardTarget>("chessboard", "chessboard_intrinsics.csv"));
+    scenes.push_back(&chessboardScene());
+    TargetDetector circleGrid = makeTargetDetector<CircleGridTarget>("circle grid", "circlegrid_intrinsics.csv");
+    circleGrid.find = &findCircleGridTracked;
+    targets.add(circleGrid);
+    scenes.push_back(&circleGridScene());
+
+    cv::Mat outputFrame;
+
+    // Intrinsics of the current target, loaded when a target is locked
+    double camMat[] = {1, 0, (double)loop.captureSize.width / 2, 0, 1, (double)loop.captureSize.height / 2, 0, 0, 1};
+    cv::Mat cameraMat(cv::Size(3, 3), CV_64FC1, &camMat);
+    cv::Mat distCoeff = cv::Mat::zeros(1, 5, CV_64F);
+    bool calibrated = false;
+    int calibratedTarget = -1;
+
+    // Calibration views collected for the locked target
+    std::vector<std::vector<cv::Vec3f>> points_list;
+    std::vector<std::vector<cv::Point2f>> corners_list;
+
+    cv::Mat rot, trans;
+    bool showAxes = true;
+    bool showObject = true;
+    bool solidObjects = false;
+    MeshPlacement modelPlacement;
+
+    OverlayDrawList overlay;
+    OverlayLayer overlayLayer;
+
+    // a YUV frame is converted to BGR once, for drawing and display; detection reads its luma instead
+    while (loop.read())
+    {
+        std::vector<cv::Point2f> corners;
+        int target = targets.detect(loop.format == PIXEL_BGR ? videoFrame : loop.luma(), loop.detectionSize, corners);
+
+        // a newly locked target brings its own calibration, scene and model placement
+        if (targets.locked() >= 0 && targets.locked() != calibratedTarget)
+        {
+            calibratedTarget = targets.locked();
+            const TargetDetector &locked = targets.detectors[calibratedTarget];
+            calibrated = loadCalibration(locked.calibrationFile, cameraMat, distCoeff, videoFrame.size()) == 0;
+            if (!calibrated)
+            {
+                printf("No calibration for the %s yet: press 's' on 5 views, then 'c' to save %s\n", locked.name.c_str(), locked.calibrationFile.c_str());
+            }
+            points_list.clear();
+            corners_list.clear();
+
+            if (!loop.model.empty())
+            {
+                std::vector<cv::Vec3f> boardPoints;
+                locked.objectPoints(boardPoints);
+                cv::Scalar center = cv::mean(boardPoints);
+                modelPlacement = fitToBoard(loop.model.view(cv::Vec3b(200, 200, 200)), cv::Point3f((float)center[0], (float)center[1], 0), 4);
+            }
+        }
+
+        videoFrame.copyTo(outputFrame);
+        std::vector<cv::Vec3f> points;
+        if (target >= 0)
+        {
+            targets.detectors[target].objectPoints(points);
+        }
+
+        bool posed = target >= 0 && target == calibratedTarget && calibrated && (showAxes || showObject);
+        if (posed)
+        {
+            calculateCameraPosition(points, corners, cameraMat, distCoeff, rot, trans);
+
+            // the layer is drawn again only when the pose, the target or what is shown has changed
+            int scene = (showAxes ? 1 : 0) | (showObject ? 2 : 0) | (solidObjects ? 4 : 0) | (target << 3);
+            if (overlayLayer.needsRender(cameraMat, distCoeff, rot, trans, outputFrame.size(), scene))
+            {
+                cv::Mat &canvas = overlayLayer.beginRender();
+                overlay.begin(canvas);
+                if (showAxes)
+                {
+                    draw3dAxes(overlay, cameraMat, distCoeff, rot, trans, *scenes[target]);
+                }
+                if (showObject)
+                {
+                    if (!loop.model.empty())
+                    {
+                        drawModel(canvas, loop.model.view(cv::Vec3b(200, 200, 200)), modelPlacement, cameraMat, distCoeff, rot, trans);
+                    }
+                    else if (solidObjects)
+                    {
+                        drawSolidObject(canvas, cameraMat, distCoeff, rot, trans, *scenes[target]);
+                    }
+                    else
+                    {
+                        draw3dObject(overlay, cameraMat, distCoeff, rot, trans, *scenes[target]);
+                    }
+                }
+                overlay.end();
+                overlayLayer.endRender();
+            }
+            overlayLayer.composite(outputFrame);
+        }
+        else if (target >= 0)
+        {
+            cv::drawChessboardCorners(outputFrame, targets.detectors[target].patternSize, corners, true);
+        }
+
+        std::string status = targets.locked() >= 0 ? "tracking the " + targets.detectors[targets.locked()].name : "searching for a target";
+        cv::putText(outputFrame, status, cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 255, 255), 2);
+
+        // the pose goes out before the frame is shown, so subscribers are not held up by the display
+        loop.publishPose(points, corners, cameraMat, distCoeff, rot, trans, std::max(target, 0), posed);
+        loop.show(outputFrame, rot, trans, posed);
+
+        // 'v' records the output to a video file and 'k' saves a snapshot of it
+        char key = loop.waitKey();
+        loop.handleKey(key, outputFrame);
+        if (key == 'q')
+        {
+            break;
+        }
+        // press 'x' or 'd' to toggle the axes or the virtual objects, 'f' for solid objects
+        else if (key == 'x')
+        {
+            showAxes = !showAxes;
+        }
+        else if (key == 'd')
+        {
+            showObject = !showObject;
+        }
+        else if (key == 'f')
+        {
+            solidObjects = !solidObjects;
+        }
+        // press 'u' to release the locked target and run every detector again
+        else if (key == 'u')
+        {
+            targets.unlock();
+            calibratedTarget = -1;
+            printf("Looking for every target\n");
+        }
+        // press 's' to keep the current view of the locked target for calibration; 5 views calibrate the camera
+        else if (key == 's' && target >= 0 && target == targets.locked())
+        {
+            corners_list.push_back(corners);
+            points_list.push_back(points);
+            printf("Calibration view %d of the %s saved\n", (int)corners_list.size(), targets.detectors[target].name.c_str());
+            if (corners_list.size() >= 5)
+            {
+                float reprojErr = computeCameraParameters(points_list, corners_list, videoFrame.size(), cameraMat, distCoeff);
+                calibrated = true;
+                std::cout << "Calibrated camera matrix:" << std::endl
+                          << cameraMat << std::endl;
+                std::cout << "Re-projection error: " << reprojErr << std::endl;
+            }
+        }
+        // press 'c' to save the current calibration to the locked target's calibration file, where it is loaded from
+        else if (key == 'c' && calibrated && calibratedTarget >= 0)
+        {
+            const TargetDetector &locked = targets.detectors[calibratedTarget];
+            if (storeCalibrationData(cameraMat, distCoeff, videoFrame.size(), locked.calibrationFile) == 0)
+            {
+                printf("Calibration of the %s saved to %s\n", locked.name.c_str(), locked.calibrationFile.c_str());
+            }
+        }
+    }
+
+    targets.printStats();
+    circleGridTracker().printStats();
+
+    overlayLayer.printStats();
+    loop.close();
+
+    return (0);
+}
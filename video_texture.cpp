@@ -0,0 +1,182 @@
+/*
+Puja Chaudhury
+video_texture.cpp
+Function implementations for video textures decoded on a background thread.
+*/
+
+#include <algorithm>
+#include <cctype>
+
+#include "video_texture.h"
+
+VideoTexture::VideoTexture(int capacity)
+    : droppedFrames(0),
+      repeatedFrames(0),
+      frameInterval(1.0 / 30),
+      loop(true),
+      ring(std::max(2, capacity)),
+      head(0),
+      count(0),
+      running(false)
+{
+}
+
+VideoTexture::~VideoTexture()
+{
+    close();
+}
+
+/*
+This function opens a clip and starts decoding it in the background. A looping clip starts over when it ends,
+otherwise its last frame stays on the target.
+ */
+int VideoTexture::open(std::string filename, bool loop)
+{
+    close();
+
+    if (!capture.open(filename))
+    {
+        printf("Unable to open video %s\n", filename.c_str());
+        return (-1);
+    }
+
+    double fps = capture.get(cv::CAP_PROP_FPS);
+    frameInterval = fps > 0 && fps < 240 ? 1.0 / fps : 1.0 / 30;
+    this->loop = loop;
+    droppedFrames = 0;
+    repeatedFrames = 0;
+
+    running = true;
+    decoder = std::thread(&VideoTexture::decode, this);
+
+    return (0);
+}
+
+/*
+This function stops the decoder thread and releases the clip.
+ */
+void VideoTexture::close()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+    }
+    spaceFree.notify_all();
+    if (decoder.joinable())
+    {
+        decoder.join();
+    }
+    capture.release();
+    head = 0;
+    count = 0;
+}
+
+bool VideoTexture::isOpen() const
+{
+    return (capture.isOpened());
+}
+
+/*
+This function runs on the decoder thread. It decodes straight into the next free slot of the ring, whose buffer is
+reused from the last time round, and waits whenever the ring is full.
+ */
+void VideoTexture::decode()
+{
+    long frameIndex = 0;
+    while (true)
+    {
+        size_t slot;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            spaceFree.wait(guard, [this]
+                           { return !running || count < ring.size(); });
+            if (!running)
+            {
+                return;
+            }
+            slot = (head + count) % ring.size();
+        }
+
+        Slot &s = ring[slot];
+        if (!capture.read(s.image))
+        {
+            if (!loop || frameIndex == 0 || !capture.set(cv::CAP_PROP_POS_FRAMES, 0) || !capture.read(s.image))
+            {
+                return;
+            }
+        }
+        s.time = frameIndex * frameInterval;
+        s.shown = false;
+        frameIndex++;
+
+        std::lock_guard<std::mutex> guard(lock);
+        count++;
+    }
+}
+
+/*
+This function returns the clip frame to show at the given time in seconds since playback started, or NULL before
+the first frame is decoded. Frames that are already out of date are dropped; when the next frame is not due or not
+decoded yet the current one is shown again. changed is set when the frame differs from the last call's, so the caller
+only needs to upload it then. The frame stays valid until the next call.
+ */
+const cv::Mat *VideoTexture::frameAt(double seconds, bool &changed)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    changed = false;
+    if (count == 0)
+    {
+        return (NULL);
+    }
+
+    size_t dropped = 0;
+    while (count >= 2 && ring[(head + 1) % ring.size()].time <= seconds)
+    {
+        droppedFrames += ring[head].shown ? 0 : 1;
+        head = (head + 1) % ring.size();
+        count--;
+        dropped++;
+    }
+    if (dropped > 0)
+    {
+        spaceFree.notify_one();
+    }
+
+    Slot &current = ring[head];
+    if (current.shown)
+    {
+        repeatedFrames++;
+    }
+    else
+    {
+        current.shown = true;
+        changed = true;
+    }
+
+    return (&current.image);
+}
+
+/*
+This function tells video clips from still images by their file extension.
+ */
+bool isVideoFile(std::string filename)
+{
+    static const char *extensions[] = {".mp4", ".m4v", ".mov", ".avi", ".mkv", ".webm", ".mpg", ".mpeg", ".wmv"};
+
+    size_t dot = filename.find_last_of('.');
+    if (dot == std::string::npos)
+    {
+        return (false);
+    }
+    std::string extension = filename.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                   { return (char)std::tolower(c); });
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+    {
+        if (extension == extensions[i])
+        {
+            return (true);
+        }
+    }
+    return (false);
+}
@@ -0,0 +1,66 @@
+/*
+Puja Chaudhury
+video_texture.h
+A video clip used as a texture on the target. A background thread decodes ahead into a small ring of frames,
+and each output frame picks the clip frame due at its timestamp, dropping or repeating clip frames to stay in time.
+*/
+
+#ifndef video_texture_hpp
+#define video_texture_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+class VideoTexture
+{
+public:
+    VideoTexture(int capacity = 4);
+    ~VideoTexture();
+
+    int open(std::string filename, bool loop = true);
+    void close();
+    bool isOpen() const;
+
+    const cv::Mat *frameAt(double seconds, bool &changed);
+
+    // clip frames skipped because a later one was already due, and output frames that showed the same clip frame again
+    int droppedFrames;
+    int repeatedFrames;
+
+private:
+    VideoTexture(const VideoTexture &);
+    VideoTexture &operator=(const VideoTexture &);
+
+    struct Slot
+    {
+        cv::Mat image;
+        double time; // presentation time in seconds from the start of playback
+        bool shown;
+    };
+
+    void decode();
+
+    cv::VideoCapture capture;
+    double frameInterval;
+    bool loop;
+
+    // slots head .. head + count - 1 hold decoded frames and belong to the reader, the rest belong to the decoder
+    std::vector<Slot> ring;
+    size_t head;
+    size_t count;
+    std::mutex lock;
+    std::condition_variable spaceFree;
+    std::thread decoder;
+    std::atomic<bool> running;
+};
+
+bool isVideoFile(std::string filename);
+
+#endif
@@ -0,0 +1,339 @@
+/*
+Puja Chaudhury
+yuv_source.cpp
+Function implementations for YUV frame sources and for splitting YUV frames into luma and BGR.
+*/
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include "yuv_source.h"
+
+/*
+This function tells how a captured frame is laid out, given what its source was asked to deliver. A source that
+ignored the request and converted to BGR anyway is recognised by its 3 channels. A raw camera buffer that arrives as
+one flat row is given its frame shape, without copying.
+ */
+int frameFormat(cv::Mat &frame, int sourceFormat, cv::Size captureSize)
+{
+    if (frame.channels() == 3)
+    {
+        return (PIXEL_BGR);
+    }
+    if (sourceFormat == PIXEL_YUYV && frame.rows == 1 && frame.isContinuous() &&
+        frame.total() * frame.elemSize() == (size_t)captureSize.area() * 2)
+    {
+        frame = frame.reshape(2, captureSize.height);
+    }
+    if (frame.channels() == 2)
+    {
+        return (PIXEL_YUYV);
+    }
+    return (sourceFormat == PIXEL_I420 || sourceFormat == PIXEL_NV12 ? sourceFormat : PIXEL_GRAY);
+}
+
+/*
+This function returns the size of the image a frame holds, which for the planar layouts is not the cv::Mat's size.
+ */
+cv::Size frameSize(const cv::Mat &frame, int format)
+{
+    if (format == PIXEL_I420 || format == PIXEL_NV12)
+    {
+        return (cv::Size(frame.cols, frame.rows * 2 / 3));
+    }
+    return (frame.size());
+}
+
+/*
+This function gives the luma of a frame for detection. For the planar layouts luma is a view of the frame's first
+plane and nothing is copied; packed YUYV has its Y channel extracted, and BGR is converted to grey as before.
+ */
+int lumaPlane(const cv::Mat &frame, int format, cv::Mat &luma)
+{
+    switch (format)
+    {
+    case PIXEL_I420:
+    case PIXEL_NV12:
+        luma = frame.rowRange(0, frame.rows * 2 / 3);
+        return (0);
+    case PIXEL_GRAY:
+        luma = frame;
+        return (0);
+    case PIXEL_YUYV:
+        cv::extractChannel(frame, luma, 0);
+        return (0);
+    case PIXEL_BGR:
+        cv::cvtColor(frame, luma, cv::COLOR_BGR2GRAY);
+        return (0);
+    }
+    return (-1);
+}
+
+/*
+This function converts a frame to the BGR image that is drawn on and shown, in one step from its own layout.
+ */
+int convertToBGR(const cv::Mat &frame, int format, cv::Mat &bgr)
+{
+    switch (format)
+    {
+    case PIXEL_I420:
+        cv::cvtColor(frame, bgr, cv::COLOR_YUV2BGR_I420);
+        return (0);
+    case PIXEL_NV12:
+        cv::cvtColor(frame, bgr, cv::COLOR_YUV2BGR_NV12);
+        return (0);
+    case PIXEL_YUYV:
+        cv::cvtColor(frame, bgr, cv::COLOR_YUV2BGR_YUYV);
+        return (0);
+    case PIXEL_GRAY:
+        cv::cvtColor(frame, bgr, cv::COLOR_GRAY2BGR);
+        return (0);
+    case PIXEL_BGR:
+        frame.copyTo(bgr);
+        return (0);
+    }
+    return (-1);
+}
+
+/*
+This function tells whether a video file should be read by YuvFileCapture rather than cv::VideoCapture.
+ */
+bool isYuvFile(std::string filename)
+{
+    size_t dot = filename.find_last_of('.');
+    if (dot == std::string::npos)
+    {
+        return (false);
+    }
+    std::string extension = filename.substr(dot + 1);
+    for (size_t i = 0; i < extension.size(); i++)
+    {
+        extension[i] = (char)tolower(extension[i]);
+    }
+    return (extension == "y4m" || extension == "nv12");
+}
+
+/*
+This function asks an opened camera for its YUYV frames as they are, instead of converted to BGR.
+It returns the layout the camera will deliver: PIXEL_YUYV when the backend agreed, PIXEL_BGR otherwise.
+ */
+int openRawCamera(cv::VideoCapture &capture)
+{
+    capture.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('Y', 'U', 'Y', 'V'));
+    if (!capture.set(cv::CAP_PROP_CONVERT_RGB, 0) || capture.get(cv::CAP_PROP_CONVERT_RGB) != 0)
+    {
+        return (PIXEL_BGR);
+    }
+    return (PIXEL_YUYV);
+}
+
+/*
+This function opens a .y4m file, whose header gives the size, frame rate and layout, or a headerless .nv12 file of the given size.
+Y4M files must be 4:2:0 or monochrome.
+ */
+YuvFileCapture::YuvFileCapture(std::string filename, cv::Size rawSize, double rawFps)
+    : format(PIXEL_I420),
+      file(NULL),
+      size(rawSize),
+      fps(rawFps),
+      frameBytes(0),
+      y4m(false),
+      grabbed(false)
+{
+    file = fopen(filename.c_str(), "rb");
+    if (file == NULL)
+    {
+        printf("Unable to open %s\n", filename.c_str());
+        return;
+    }
+
+    std::string extension = filename.substr(filename.find_last_of('.') + 1);
+    y4m = extension == "y4m" || extension == "Y4M";
+    if (y4m)
+    {
+        if (readHeader() != 0)
+        {
+            printf("%s is not an 8-bit 4:2:0 or monochrome YUV4MPEG2 file\n", filename.c_str());
+            release();
+            return;
+        }
+    }
+    else
+    {
+        format = PIXEL_NV12;
+        if (size.area() == 0)
+        {
+            printf("The size of the raw NV12 file %s must be given\n", filename.c_str());
+            release();
+            return;
+        }
+    }
+
+    frameBytes = format == PIXEL_GRAY ? (size_t)size.area() : (size_t)size.area() * 3 / 2;
+}
+
+YuvFileCapture::~YuvFileCapture()
+{
+    release();
+}
+
+/*
+This function reads the stream header, "YUV4MPEG2" followed by space-separated parameters on one line.
+ */
+int YuvFileCapture::readHeader()
+{
+    char line[512];
+    if (fgets(line, sizeof(line), file) == NULL || strncmp(line, "YUV4MPEG2 ", 10) != 0)
+    {
+        return (-1);
+    }
+
+    fps = 30;
+    for (char *token = strtok(line + 10, " \n"); token != NULL; token = strtok(NULL, " \n"))
+    {
+        int num, den;
+        switch (token[0])
+        {
+        case 'W':
+            size.width = atoi(token + 1);
+            break;
+        case 'H':
+            size.height = atoi(token + 1);
+            break;
+        case 'F':
+            if (sscanf(token + 1, "%d:%d", &num, &den) == 2 && num > 0 && den > 0)
+            {
+                fps = (double)num / den;
+            }
+            break;
+        case 'C':
+            // 8-bit 4:2:0 in any chroma siting (C420jpeg, C420paldv, C420mpeg2); C420p10, C420p12 and other deeper
+            // formats store 16-bit samples and are not supported
+            if (strncmp(token + 1, "420", 3) == 0 && !(token[4] == 'p' && isdigit((unsigned char)token[5])))
+            {
+                format = PIXEL_I420;
+            }
+            else if (strcmp(token + 1, "mono") == 0)
+            {
+                format = PIXEL_GRAY;
+            }
+            else
+            {
+                return (-1);
+            }
+            break;
+        }
+    }
+
+    return (size.area() > 0 && size.width % 2 == 0 && size.height % 2 == 0 ? 0 : -1);
+}
+
+bool YuvFileCapture::isOpened() const
+{
+    return (file != NULL);
+}
+
+/*
+This function moves to the next frame, reading its FRAME line in a Y4M file. The pixels are only read by retrieve(),
+straight into the caller's buffer, and skipped if the frame is grabbed past.
+ */
+bool YuvFileCapture::grab()
+{
+    if (file == NULL)
+    {
+        return (false);
+    }
+    if (grabbed && fseek(file, (long)frameBytes, SEEK_CUR) != 0)
+    {
+        return (false);
+    }
+    grabbed = false;
+
+    if (y4m)
+    {
+        char tag[6];
+        if (fread(tag, 1, 5, file) != 5 || strncmp(tag, "FRAME", 5) != 0)
+        {
+            return (false);
+        }
+        int c;
+        while ((c = fgetc(file)) != '\n')
+        {
+            if (c == EOF)
+            {
+                return (false);
+            }
+        }
+    }
+    else
+    {
+        int c = fgetc(file);
+        if (c == EOF)
+        {
+            return (false);
+        }
+        ungetc(c, file);
+    }
+
+    grabbed = true;
+    return (true);
+}
+
+/*
+This function reads the grabbed frame's pixels as one single-channel cv::Mat, (rows * 3 / 2) x cols for the 4:2:0 layouts.
+ */
+bool YuvFileCapture::retrieve(cv::OutputArray image, int flag)
+{
+    if (!grabbed)
+    {
+        return (false);
+    }
+    grabbed = false;
+
+    image.create(format == PIXEL_GRAY ? size.height : size.height * 3 / 2, size.width, CV_8UC1);
+    cv::Mat frame = image.getMat();
+    return (fread(frame.data, 1, frameBytes, file) == frameBytes);
+}
+
+bool YuvFileCapture::read(cv::OutputArray image)
+{
+    if (!grab() || !retrieve(image))
+    {
+        image.release();
+        return (false);
+    }
+    return (true);
+}
+
+double YuvFileCapture::get(int propId) const
+{
+    switch (propId)
+    {
+    case cv::CAP_PROP_FPS:
+        return (fps);
+    case cv::CAP_PROP_FRAME_WIDTH:
+        return (size.width);
+    case cv::CAP_PROP_FRAME_HEIGHT:
+        return (size.height);
+    }
+    return (0);
+}
+
+/*
+The file's size and rate are fixed, so nothing can be set.
+ */
+bool YuvFileCapture::set(int propId, double value)
+{
+    return (false);
+}
+
+void YuvFileCapture::release()
+{
+    if (file != NULL)
+    {
+        fclose(file);
+        file = NULL;
+    }
+    grabbed = false;
+}
@@ -0,0 +1,72 @@
+/*
+Puja Chaudhury
+yuv_source.h
+Frames in the YUV layouts cameras and decoders produce. A raw source hands its frames to the loop unconverted;
+detection runs on the luma plane, which needs no conversion at all for planar layouts. Only the frame that is drawn
+on and shown is converted to BGR, once. Y4M files and raw NV12 files are read by YuvFileCapture, and cameras
+that can deliver YUYV are asked for it with openRawCamera.
+*/
+
+#ifndef yuv_source_hpp
+#define yuv_source_hpp
+
+#include <cstdio>
+#include <string>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+// How the pixels of a captured frame are laid out
+enum PixelFormat
+{
+    PIXEL_BGR,  // 3 channels, what cv::VideoCapture normally delivers
+    PIXEL_GRAY, // luma only
+    PIXEL_I420, // planar Y, then U and V at quarter size, in one (rows * 3 / 2) x cols single-channel cv::Mat
+    PIXEL_NV12, // planar Y, then interleaved UV at quarter size, laid out like I420
+    PIXEL_YUYV  // packed 4:2:2, one 2-channel cv::Mat of the frame's size
+};
+
+int frameFormat(cv::Mat &frame, int sourceFormat, cv::Size captureSize);
+
+cv::Size frameSize(const cv::Mat &frame, int format);
+
+int lumaPlane(const cv::Mat &frame, int format, cv::Mat &luma);
+
+int convertToBGR(const cv::Mat &frame, int format, cv::Mat &bgr);
+
+bool isYuvFile(std::string filename);
+
+int openRawCamera(cv::VideoCapture &capture);
+
+// A YUV4MPEG2 (.y4m) file, or a headerless NV12 file of a given size, read as a video source.
+// It stands in for cv::VideoCapture wherever a source is read with grab() and retrieve().
+class YuvFileCapture : public cv::VideoCapture
+{
+public:
+    YuvFileCapture(std::string filename, cv::Size rawSize = cv::Size(), double rawFps = 30);
+    ~YuvFileCapture();
+
+    bool isOpened() const override;
+    bool grab() override;
+    bool retrieve(cv::OutputArray image, int flag = 0) override;
+    bool read(cv::OutputArray image) override;
+    double get(int propId) const override;
+    bool set(int propId, double value) override;
+    void release() override;
+
+    // layout of the frames retrieve() delivers
+    int format;
+
+private:
+    int readHeader();
+
+    FILE *file;
+    cv::Size size;
+    double fps;
+    size_t frameBytes;
+    bool y4m;
+    bool grabbed; // a frame's header has been read but not its pixels
+};
+
+#endif